@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Prevent the compiler from discarding a value computed inside a benchmark loop
+ * @param value Value to keep
+ */
+template <typename T>
+inline void cgvDoNotOptimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const T* sink;
+	sink = &value;
+#endif
+}
+
+/**
+ * cgvBenchmark runs the microbenchmarks and writes one JSON object per line to stdout, so that the results
+ * can be collected and compared over time by other tools.
+ */
+class cgvBenchmark {
+	double min_time = 0.2; ///< Minimum time (seconds) measured for each benchmark
+	unsigned int max_boxes = 1000000; ///< Largest scene size that is measured
+	std::string filter; ///< Only the benchmarks whose name contains this string are run
+
+public:
+	cgvBenchmark() = default;
+
+	/**
+	 * Read the options of the command line: --min-time <seconds>, --max-boxes <n> and --filter <substring>
+	 * @param argc Number of parameters of the command line
+	 * @param argv Parameters of the command line
+	 * @retval false if the command line is not valid
+	 */
+	bool parse_args(int argc, char** argv) {
+		for (int i = 1; i < argc; ++i) {
+			if (!strcmp(argv[i], "--min-time") && (i + 1 < argc)) {
+				min_time = atof(argv[++i]);
+			} else if (!strcmp(argv[i], "--max-boxes") && (i + 1 < argc)) {
+				max_boxes = (unsigned int) strtoul(argv[++i], nullptr, 10);
+			} else if (!strcmp(argv[i], "--filter") && (i + 1 < argc)) {
+				filter = argv[++i];
+			} else {
+				fprintf(stderr, "usage: %s [--min-time <seconds>] [--max-boxes <n>] [--filter <substring>]\n", argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @retval The scene sizes to be measured, from 3 boxes up to max_boxes
+	 */
+	std::vector<unsigned int> scene_sizes() const {
+		std::vector<unsigned int> sizes;
+		for (unsigned int n : {3u, 1000u, 10000u, 100000u, 1000000u}) {
+			if (n <= max_boxes) sizes.push_back(n);
+		}
+		return sizes;
+	}
+
+	/**
+	 * @param name Name of a benchmark
+	 * @retval true if the benchmark has to be run according to the filter
+	 */
+	bool enabled(const std::string& name) const {
+		return filter.empty() || (name.find(filter) != std::string::npos);
+	}
+
+	/**
+	 * Write a record with information about the environment (e.g. the OpenGL renderer)
+	 * @param key Name of the field
+	 * @param value Value of the field
+	 */
+	void info(const std::string& key, const std::string& value) const {
+		printf("{\"type\":\"info\",\"key\":\"%s\",\"value\":\"%s\"}\n", key.c_str(), value.c_str());
+		fflush(stdout);
+	}
+
+	/**
+	 * Write a record with a value measured by a benchmark that is not a time (e.g. number of OpenGL calls)
+	 * @param name Name of the counter
+	 * @param boxes Number of boxes of the scene (0 if not applicable)
+	 * @param value Value of the counter
+	 */
+	void counter(const std::string& name, unsigned int boxes, double value) const {
+		if (!enabled(name)) return;
+		printf("{\"type\":\"counter\",\"name\":\"%s\",\"boxes\":%u,\"value\":%.3f}\n", name.c_str(), boxes, value);
+		fflush(stdout);
+	}
+
+	/**
+	 * Measure a benchmark. After one warm-up iteration, the number of iterations is doubled until the measured time
+	 * reaches min_time.
+	 * @param name Name of the benchmark
+	 * @param boxes Number of boxes of the scene used by the benchmark (0 if not applicable)
+	 * @param body Function body(iterations) that runs the measured code the given number of times
+	 * @post A JSON record with the time per iteration (and per box) is written to stdout
+	 */
+	template <typename F>
+	void run(const std::string& name, unsigned int boxes, F body) const {
+		if (!enabled(name)) return;
+
+		body(1); // warm up: first use of the driver state, caches, etc.
+
+		unsigned long iterations = 1;
+		double seconds = 0;
+		for (;;) {
+			auto start = std::chrono::steady_clock::now();
+			body(iterations);
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if ((seconds >= min_time) || (iterations >= (1ul << 40))) break;
+			iterations *= 2;
+		}
+
+		double ns = seconds * 1e9 / iterations;
+		printf("{\"type\":\"benchmark\",\"name\":\"%s\",\"boxes\":%u,\"iterations\":%lu,\"ns_per_iteration\":%.3f,\"ns_per_box\":%.3f}\n",
+		       name.c_str(), boxes, iterations, ns, boxes ? ns / boxes : 0.0);
+		fflush(stdout);
+	}
+};
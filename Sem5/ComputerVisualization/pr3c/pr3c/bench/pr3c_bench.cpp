@@ -0,0 +1,952 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cgvBenchmark.h"
+#include "cgvHeadlessContext.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+#include "cgvSceneGenerator.h"
+#include "cgvShaderRenderer.h"
+#include "cgvSnapshot.h"
+#include "cgvSceneStreamer.h"
+#include "cgvPagedScene.h"
+#include "cgvSceneDiff.h"
+#include "cgvUpdateReceiver.h"
+#include "cgvFrameSink.h"
+#include "cgvSequenceExporter.h"
+#include "cgvViewList.h"
+#include "cgvInterface.h"
+
+
+/**
+ * Benchmarks of the operations of cgvPoint3D and cgvPoint4D
+ */
+static void bench_points(const cgvBenchmark& bench) {
+	bench.run("point3d/construct_copy", 0, [](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			cgvPoint3D p((float) i, 2.0f, 3.0f);
+			cgvPoint3D q(p);
+			cgvDoNotOptimize(q);
+		}
+	});
+	bench.run("point3d/assign_set", 0, [](unsigned long n) {
+		cgvPoint3D p, q;
+		for (unsigned long i = 0; i < n; ++i) {
+			p.set((float) i, 1.0f, 2.0f);
+			q = p;
+			cgvDoNotOptimize(q);
+		}
+	});
+	bench.run("point3d/compare", 0, [](unsigned long n) {
+		cgvPoint3D p(1, 2, 3), q(1, 2, 3.5f);
+		bool equal = false;
+		for (unsigned long i = 0; i < n; ++i) {
+			q[Z] = (float) (i & 1) * 3.0f;
+			equal ^= (p == q) ^ (p != q);
+			cgvDoNotOptimize(equal);
+		}
+	});
+	bench.run("point4d/construct_from_3d", 0, [](unsigned long n) {
+		cgvPoint3D p(1, 2, 3);
+		for (unsigned long i = 0; i < n; ++i) {
+			p[X] = (float) i;
+			cgvPoint4D q(p);
+			cgvDoNotOptimize(q);
+		}
+	});
+}
+
+/**
+ * Benchmarks of cgvCamera::apply, for parallel and perspective cameras
+ */
+static void bench_camera(const cgvBenchmark& bench) {
+	cgvCamera camera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+
+	camera.setParallelParameters(5, 5, 0.1, 200);
+	bench.run("camera/apply_parallel", 0, [&camera](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) camera.apply();
+		glFinish();
+	});
+
+	camera.setPerspParameters(60, 1, 0.1, 200);
+	bench.run("camera/apply_perspective", 0, [&camera](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) camera.apply();
+		glFinish();
+	});
+}
+
+/**
+ * Benchmarks of the frames read back after rendering the default scene: synchronously to the CPU, and published in a
+ * ring of frames in shared memory through the pixel buffers
+ * @param bench The benchmark runner
+ * @param context The headless context where the scene is rendered
+ */
+static void bench_frames(const cgvBenchmark& bench, cgvHeadlessContext& context) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+	cgvCamera camera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(5, 5, 0.1, 200);
+	scene->set_camera(&camera);
+	const int width = context.get_width(), height = context.get_height();
+
+	std::vector<GLubyte> pixels((size_t) width * height * 4);
+	bench.run("frames/render_read_pixels", 0, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		}
+		cgvDoNotOptimize(pixels[0]);
+	});
+
+	cgvFrameSink sink;
+	if (!sink.create("pr3c_bench_frames", (uint32_t) width, (uint32_t) height)) return;
+	bench.run("frames/render_shared_memory", 0, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+			sink.capture(width, height);
+		}
+		glFinish();
+	});
+	sink.finish();
+	bench.counter("frames/published", 0, (double) sink.get_num_published());
+	bench.counter("frames/dropped", 0, (double) sink.get_num_dropped());
+
+	// the last frame is published without rendering another one, once it has been read back
+	const unsigned long published = sink.get_num_published();
+	sink.capture(width, height);
+	glFinish();
+	sink.publish_ready();
+	bench.counter("frames/published_when_idle", 0, (double) (sink.get_num_published() - published));
+}
+
+/**
+ * Benchmarks of the export of a sequence of images of the default scene: the encoding of a frame in the calling
+ * thread, and the frames rendered while the previous ones are read back and encoded by the workers
+ * @param bench The benchmark runner
+ * @param context The headless context where the scene is rendered
+ */
+static void bench_export(const cgvBenchmark& bench, cgvHeadlessContext& context) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+	cgvCamera camera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(5, 5, 0.1, 200);
+	scene->set_camera(&camera);
+	const uint32_t width = (uint32_t) context.get_width(), height = (uint32_t) context.get_height();
+	const std::string pattern = "pr3c_bench_export_%02u.png";
+	const uint32_t n_files = 16; // the files are overwritten
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	camera.apply();
+	scene->render(CGV_DISPLAY);
+	std::vector<uint8_t> pixels((size_t) width * height * 4), rows, file;
+	glReadPixels(0, 0, (GLsizei) width, (GLsizei) height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	imageFormat format;
+	if (!cgvSequenceExporter::parse_pattern(pattern, format)) return;
+	bench.run("export/encode_png", 0, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) cgvSequenceExporter::encode(format, width, height, pixels.data(), rows, file);
+		cgvDoNotOptimize(file.size());
+	});
+	bench.counter("export/png_bytes", 0, (double) file.size());
+
+	cgvSequenceExporter exporter;
+	bench.run("export/render_png_sequence", 0, [&](unsigned long n) {
+		exporter.start(pattern, width, height);
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+			exporter.capture((uint32_t) (i % n_files));
+		}
+		exporter.finish();
+	});
+	bench.counter("export/stalls", 0, (double) exporter.get_num_stalls());
+	bench.counter("export/threads", 0, (double) exporter.get_num_threads());
+
+	char name[64];
+	for (uint32_t f = 0; f < n_files; ++f) {
+		snprintf(name, sizeof(name), pattern.c_str(), f);
+		remove(name);
+	}
+}
+
+/**
+ * Benchmarks of several independent renderers in parallel threads: each thread creates a cgvInterface, which
+ * generates a grid in its own headless context and renders the hashes of a turntable of it. The time of an iteration
+ * is the time of the slowest instance
+ * @param bench The benchmark runner
+ */
+static void bench_instances(const cgvBenchmark& bench) {
+	const unsigned int n_boxes = 1000;
+	const std::string boxes = std::to_string(n_boxes);
+	const uint32_t n_views = 16;
+	for (unsigned int n_instances : {1u, 2u, 4u}) {
+		unsigned long n_failed = 0;
+		bench.run("renderers/render_views_" + std::to_string(n_instances), n_boxes, [&](unsigned long n) {
+			for (unsigned long i = 0; i < n; ++i) {
+				std::vector<std::thread> threads;
+				std::atomic<unsigned long> failed{0};
+				for (unsigned int t = 0; t < n_instances; ++t) {
+					threads.emplace_back([&]() {
+						const char *args[] = {"pr3c_bench", "--layout", "grid", "--boxes", boxes.c_str(),
+						                      "--export-frames", "16", "--export-size", "250x250"};
+						cgvInterface ui;
+						if (!ui.parse_args(9, (char **) args) || !ui.render_views() ||
+						    (ui.get_view_hashes().size() != n_views)) {
+							++failed;
+						}
+					});
+				}
+				for (std::thread& thread : threads) thread.join();
+				n_failed += failed;
+			}
+		});
+		bench.counter("renderers/failed_" + std::to_string(n_instances), n_boxes, (double) n_failed);
+	}
+}
+
+/**
+ * Benchmarks of the generation of scenes with every layout
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_generator(const cgvBenchmark& bench, unsigned int n_boxes) {
+	const char* names[] = {"tower", "grid", "clusters", "dense"};
+	const sceneLayout layouts[] = {CGV_LAYOUT_TOWER, CGV_LAYOUT_GRID, CGV_LAYOUT_CLUSTERS, CGV_LAYOUT_DENSE_STACK};
+
+	cgvScene3D scene;
+	for (int l = 0; l < 4; ++l) {
+		cgvSceneGenerator generator(layouts[l], n_boxes, 1);
+		bench.run(std::string("generator/") + names[l], n_boxes, [&](unsigned long n) {
+			for (unsigned long i = 0; i < n; ++i) generator.generate(scene);
+			cgvDoNotOptimize(scene.get_num_boxes());
+		});
+	}
+}
+
+/**
+ * Benchmarks of the save and the load of a snapshot of a grid of boxes, with its camera, at once and in the background
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_snapshot(const cgvBenchmark& bench, unsigned int n_boxes) {
+	const std::string path = "pr3c_bench.cgvsnap";
+	cgvScene3D scene;
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(scene);
+	cgvCamera camera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	cgvSnapshot snapshot;
+	if (!snapshot.save(path, scene, &camera)) return;
+
+	bench.run("snapshot/save", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) snapshot.save(path, scene, &camera);
+	});
+	bench.run("snapshot/load", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) snapshot.load(path, scene, &camera);
+		cgvDoNotOptimize(scene.get_num_boxes());
+	});
+	bench.counter("snapshot/bytes", n_boxes, (double) snapshot.get_num_bytes());
+
+	// the first chunk is available to the first frame, whatever the size of the snapshot
+	cgvSceneStreamer streamer;
+	bench.run("snapshot/stream_first_chunk", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			streamer.start(path, scene, &camera);
+			while (!streamer.update(scene) && streamer.is_loading()) std::this_thread::yield();
+			streamer.stop();
+		}
+		cgvDoNotOptimize(scene.get_num_boxes());
+	});
+	bench.run("snapshot/stream", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			streamer.start(path, scene, &camera);
+			while (streamer.is_loading()) {
+				if (!streamer.update(scene)) std::this_thread::yield();
+			}
+		}
+		cgvDoNotOptimize(scene.get_num_boxes());
+	});
+	remove(path.c_str());
+}
+
+/**
+ * Benchmarks of the reload of a snapshot: the scene alternates between two snapshots where one box of each thousand
+ * has been moved
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes
+ */
+static void bench_reload(const cgvBenchmark& bench, unsigned int n_boxes) {
+	const std::string paths[2] = {"pr3c_bench_a.cgvsnap", "pr3c_bench_b.cgvsnap"};
+	cgvScene3D scene, edited;
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(scene);
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(edited);
+	for (uint32_t i = 0; i < n_boxes; i += 1000) {
+		cgvPoint3D position = edited.get_positions()[i];
+		position[Y] += 2;
+		edited.move_box(i, position, edited.get_rotations()[i]);
+	}
+	cgvSnapshot snapshot;
+	if (!snapshot.save(paths[0], scene, nullptr) || !snapshot.save(paths[1], edited, nullptr)) return;
+
+	cgvSceneDiff diff;
+	unsigned long reloads = 0;
+	bench.run("reload/diff_apply", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i, ++reloads) {
+			snapshot.open(paths[(reloads + 1) % 2]);
+			diff.compute(scene, snapshot);
+			snapshot.close();
+			diff.apply(scene);
+		}
+		cgvDoNotOptimize(scene.get_num_boxes());
+	});
+	bench.counter("reload/modified", n_boxes, (double) diff.get_num_modified());
+	remove(paths[0].c_str());
+	remove(paths[1].c_str());
+}
+
+/**
+ * Benchmarks of the updates of the transformation of the boxes received through a FIFO: each iteration writes a
+ * frame of updates (the same box is updated several times when the scene has less boxes) and applies them
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes
+ */
+static void bench_ingest(const cgvBenchmark& bench, unsigned int n_boxes) {
+#ifndef _WIN32
+	const unsigned int n_updates = 65536;
+	const std::string path = "pr3c_bench.fifo";
+	cgvScene3D scene;
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(scene);
+	std::vector<cgvTransformUpdate> updates(n_updates);
+	for (unsigned int k = 0; k < n_updates; ++k) {
+		updates[k] = {k % n_boxes + 1, {(float) k, 0, 0}, {(float) (k % 360), 0}};
+	}
+
+	unlink(path.c_str());
+	cgvUpdateReceiver receiver;
+	if ((mkfifo(path.c_str(), 0600) != 0) || !receiver.start(path)) return;
+	const int fd = open(path.c_str(), O_WRONLY);
+	if (fd >= 0) {
+		bench.run("ingest/fifo_65536_updates", n_boxes, [&](unsigned long n) {
+			for (unsigned long i = 0; i < n; ++i) {
+				const unsigned long target = receiver.get_num_received() + n_updates;
+				const char *bytes = (const char *) updates.data();
+				for (size_t left = updates.size() * sizeof(cgvTransformUpdate); left > 0;) {
+					const ssize_t written = write(fd, bytes, left);
+					if (written <= 0) return;
+					bytes += written;
+					left -= (size_t) written;
+				}
+				while (receiver.get_num_received() < target) std::this_thread::yield();
+				receiver.apply(scene);
+			}
+			cgvDoNotOptimize(scene.get_num_boxes());
+		});
+		bench.counter("ingest/applied", n_boxes, (double) receiver.get_num_applied());
+		close(fd);
+	}
+	receiver.stop();
+	unlink(path.c_str());
+#endif
+}
+
+/**
+ * Benchmarks of a page file: a camera moves across the scene, with a memory budget of a quarter of the boxes
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes
+ */
+static void bench_paging(const cgvBenchmark& bench, unsigned int n_boxes) {
+	const std::string path = "pr3c_bench.cgvpage";
+	cgvScene3D scene;
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(scene);
+	if (!cgvPagedScene::write(path, scene)) return;
+
+	cgvPagedScene pager;
+	const unsigned int budget = std::max(n_boxes / 4, cgvPagedScene::PAGE_SIZE);
+	if (!pager.open(path, (uint64_t) budget * scene.get_bytes_per_box())) return;
+	cgvPoint3D min, max;
+	pager.get_bounds(min, max);
+	const float radius = std::max(5.0f, (max[X] - min[X]) / 8);
+
+	// 32 frames from one side of the scene to the other one
+	bench.run("paging/walk", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			for (int frame = 0; frame < 32; ++frame) {
+				const float x = min[X] + (max[X] - min[X]) * frame / 31;
+				cgvCamera camera(cgvPoint3D(x, max[Y] + 10, max[Z] + 10), cgvPoint3D(x, 0, 0), cgvPoint3D(0, 1.0, 0));
+				camera.setParallelParameters(radius, radius, 0.1, 4 * (max[Z] - min[Z] + max[Y] - min[Y] + 20));
+				pager.update(scene, camera);
+			}
+		}
+		cgvDoNotOptimize(scene.get_num_boxes());
+	});
+	bench.counter("paging/resident_boxes", n_boxes, (double) pager.get_num_resident_boxes());
+	bench.counter("paging/page_loads", n_boxes, (double) pager.get_num_page_loads());
+	bench.counter("paging/boxes_copied", n_boxes, (double) pager.get_num_boxes_copied());
+	pager.close();
+	remove(path.c_str());
+}
+
+/**
+ * Benchmarks of the sort of the render queue, with random depths and materials
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes
+ */
+static void bench_render_queue(const cgvBenchmark& bench, unsigned int n_boxes) {
+	cgvRenderQueue queue;
+	std::vector<uint64_t> keys;
+	uint32_t seed = 12345;
+	for (uint32_t i = 0; i < n_boxes; ++i) {
+		seed = seed * 1664525u + 1013904223u; // linear congruential generator
+		uint32_t depth = seed >> (32 - cgvRenderQueue::DEPTH_BITS);
+		queueMaterial material = (seed & 0xF) ? CGV_MATERIAL_UNSELECTED : CGV_MATERIAL_SELECTED;
+		keys.push_back(cgvRenderQueue::make_key(CGV_DISPLAY, material, depth, i));
+	}
+
+	bench.run("queue/fill_sort", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			queue.clear();
+			for (uint64_t key : keys) queue.push(key);
+			queue.sort();
+		}
+		cgvDoNotOptimize(queue.get_keys()[0]);
+	});
+}
+
+/**
+ * Benchmarks of the rendering of the scene (display and selection mode) and of the selection of a box
+ * @param bench The benchmark runner
+ * @param context The headless context where the scene is rendered
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_scene(const cgvBenchmark& bench, cgvHeadlessContext& context, unsigned int n_boxes) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D(n_boxes));
+
+	cgvCamera camera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(5, 5, 0.1, 200);
+	scene->set_camera(&camera);
+	cgvGLState& state = scene->get_gl_state();
+
+	bench.run("scene/render_display", n_boxes, [&](unsigned long n) {
+		state.enable(GL_LIGHTING);
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+		}
+		glFinish();
+	});
+
+	// OpenGL state changes of one frame, with and without the render queue
+	for (bool sorted : {true, false}) {
+		scene->set_render_queue(sorted);
+		state.reset_counters();
+		camera.apply();
+		scene->render(CGV_DISPLAY);
+		std::string suffix = sorted ? "" : "_unsorted";
+		bench.counter("state/display_issued" + suffix, n_boxes, (double) state.get_total_issued());
+		bench.counter("state/display_skipped" + suffix, n_boxes, (double) state.get_total_skipped());
+	}
+
+	scene->set_render_queue(false);
+	bench.run("scene/render_display_unsorted", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+		}
+		glFinish();
+	});
+	scene->set_render_queue(true);
+
+	// no box has been rotated: all of them are in the static batch
+	scene->set_static_batching(true);
+	bench.run("scene/render_display_batched", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+		}
+		glFinish();
+	});
+	bench.counter("batch/static_boxes", n_boxes, (double) scene->get_static_batch().get_num_static());
+	bench.counter("batch/drawn_chunks", n_boxes, (double) scene->get_static_batch().get_num_drawn_chunks());
+
+	// the first box is selected and rotated in every frame: it leaves the batch, the rest of the boxes stay there
+	GLubyte first_box[3], no_box[3] = {0, 0, 0};
+	cgvBox::id_to_color(1, first_box);
+	scene->assignSelection(first_box);
+	bench.run("scene/render_display_batched_rotating", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			scene->updateRotation(1, 0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+		}
+		glFinish();
+	});
+	bench.counter("batch/dynamic_boxes", n_boxes, (double) scene->get_static_batch().get_num_dynamic());
+	scene->assignSelection(no_box);
+	scene->set_static_batching(false);
+
+	bench.run("scene/render_select", n_boxes, [&](unsigned long n) {
+		state.disable(GL_LIGHTING);
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_SELECT);
+		}
+		glFinish();
+		state.enable(GL_LIGHTING);
+	});
+
+	// the same frames with the geometry of the boxes instead of their proxies
+	scene->set_select_proxy(false);
+	bench.run("scene/render_select_boxes", n_boxes, [&](unsigned long n) {
+		state.disable(GL_LIGHTING);
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_SELECT);
+		}
+		glFinish();
+		state.enable(GL_LIGHTING);
+	});
+	scene->set_select_proxy(true);
+
+	state.reset_counters();
+	state.disable(GL_LIGHTING);
+	camera.apply();
+	scene->render(CGV_SELECT);
+	state.enable(GL_LIGHTING);
+	bench.counter("state/select_issued", n_boxes, (double) state.get_total_issued());
+	bench.counter("state/select_skipped", n_boxes, (double) state.get_total_skipped());
+
+	// the same steps of cgvInterface when the user clicks: selection rendering, read back of the pixel and selection
+	bench.run("picking/click", n_boxes, [&](unsigned long n) {
+		GLubyte pixel[3];
+		state.disable(GL_LIGHTING);
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(context.get_width() / 2, context.get_height() / 2, 1, 1);
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_SELECT);
+			glReadPixels(context.get_width() / 2, context.get_height() / 2, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+			scene->assignSelection(pixel);
+		}
+		glDisable(GL_SCISSOR_TEST);
+		state.enable(GL_LIGHTING);
+	});
+
+	bench.run("picking/assign_selection", n_boxes, [&](unsigned long n) {
+		GLubyte c[3] = {0, 0, 0};
+		for (unsigned long i = 0; i < n; ++i) {
+			unsigned int id = (unsigned int) (i % n_boxes) + 1;
+			c[0] = (id >> 16) & 0xFF;
+			c[1] = (id >> 8) & 0xFF;
+			c[2] = id & 0xFF;
+			scene->assignSelection(c);
+		}
+		cgvDoNotOptimize(scene->return_isAnyBoxSelected());
+	});
+
+	bench.run("scene/update_rotation", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) scene->updateRotation(1, 1);
+	});
+}
+
+/**
+ * Benchmarks of the rendering of a grid of boxes (a cube of boxes in the large scenes) with occlusion culling: with
+ * queries, once the visibility has settled, and in the CPU
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_occlusion(const cgvBenchmark& bench, unsigned int n_boxes) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(*scene);
+
+	// the whole scene is seen from a corner
+	float extent = 1;
+	for (const cgvPoint3D& p : scene->get_positions()) {
+		for (int i = X; i <= Z; ++i) extent = std::max(extent, std::abs(p[i]) + 2);
+	}
+	cgvCamera camera(cgvPoint3D(extent * 2, extent * 1.5f, extent * 2.5f), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(extent * 1.8f, extent * 1.8f, 0.1, extent * 8);
+	scene->set_camera(&camera);
+	scene->get_gl_state().enable(GL_LIGHTING);
+
+	auto frame = [&]() {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		camera.apply();
+		scene->render(CGV_DISPLAY);
+	};
+
+	bench.run("scene/render_display_grid", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) frame();
+		glFinish();
+	});
+
+	scene->set_occlusion_culling(true);
+	for (int i = 0; (i < 100) && ((i < 2) || scene->get_occlusion().needs_another_frame()); ++i) {
+		frame();
+		glFinish();
+	}
+	bench.run("scene/render_display_occlusion", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) frame();
+		glFinish();
+	});
+
+	unsigned int visible = 0;
+	for (uint32_t i = 0; i < n_boxes; ++i) visible += scene->get_occlusion().is_visible(i) ? 1 : 0;
+	bench.counter("occlusion/submitted_boxes", n_boxes, (double) visible);
+	bench.counter("occlusion/queries", n_boxes, (double) scene->get_occlusion().get_num_queries());
+	scene->set_occlusion_culling(false);
+
+	scene->set_software_culling(true);
+	const cgvSoftwareOccluder& software = scene->get_software_occlusion();
+	bench.run("scene/render_display_software_culling", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) frame();
+		glFinish();
+	});
+	bench.run("occlusion/software_cull", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) scene->get_software_occlusion().cull(*scene, camera);
+	});
+	bench.counter("occlusion/software_occluders", n_boxes, (double) software.get_num_occluders());
+	bench.counter("occlusion/software_occluded", n_boxes, (double) software.get_num_occluded());
+	bench.counter("occlusion/software_outside", n_boxes, (double) software.get_num_outside());
+	bench.counter("occlusion/software_workers", n_boxes, (double) software.get_num_workers());
+}
+
+/**
+ * Benchmarks of the rendering of a grid of boxes seen by a wide perspective camera from one of its corners, with and
+ * without impostors for the distant boxes
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_impostors(const cgvBenchmark& bench, unsigned int n_boxes) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(*scene);
+
+	cgvPoint3D min, max;
+	scene->get_bounds(min, max);
+	cgvCamera camera(cgvPoint3D(max[X] + 2, max[Y] + 8, max[Z] + 2), min, cgvPoint3D(0, 1.0, 0));
+	camera.setPerspParameters(70, 1, 0.5, 4 * (max[X] - min[X] + max[Z] - min[Z]) + 20);
+	scene->set_camera(&camera);
+	scene->get_gl_state().enable(GL_LIGHTING);
+
+	auto frame = [&]() {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		camera.apply();
+		scene->render(CGV_DISPLAY);
+	};
+
+	bench.run("scene/render_display_wide", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) frame();
+		glFinish();
+	});
+
+	scene->set_impostors(true);
+	bench.run("scene/render_display_impostors", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) frame();
+		glFinish();
+	});
+	bench.counter("lod/impostors", n_boxes, (double) scene->get_impostor_renderer().get_num_impostors());
+	bench.counter("lod/atlas_cells", n_boxes, (double) scene->get_impostor_renderer().get_num_rendered_cells());
+}
+
+/**
+ * Benchmarks of the frames rendered while the user rotates a selected box of a grid seen from a corner, with and
+ * without the cache of the static layer
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_layers(const cgvBenchmark& bench, unsigned int n_boxes) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(*scene);
+
+	float extent = 1;
+	for (const cgvPoint3D& p : scene->get_positions()) {
+		for (int i = X; i <= Z; ++i) extent = std::max(extent, std::abs(p[i]) + 2);
+	}
+	cgvCamera camera(cgvPoint3D(extent * 2, extent * 1.5f, extent * 2.5f), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(extent * 1.8f, extent * 1.8f, 0.1, extent * 8);
+	scene->set_camera(&camera);
+	scene->get_gl_state().enable(GL_LIGHTING);
+
+	GLubyte selected[3];
+	cgvBox::id_to_color(n_boxes / 2 + 1, selected);
+	scene->assignSelection(selected);
+
+	auto drag = [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			scene->updateRotation(1, 0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+		}
+		glFinish();
+	};
+
+	bench.run("scene/render_display_drag", n_boxes, drag);
+
+	// the static layer is rendered in the first frame; the measured frames only copy it
+	scene->set_layer_caching(true);
+	drag(1);
+	bench.run("scene/render_display_drag_cached", n_boxes, drag);
+	bench.counter("layers/static_renders", n_boxes, (double) scene->get_layer_cache().get_num_static_renders());
+
+	// a box that is not selected is only rotated (a reload or a received update): the static layer is rendered again
+	const unsigned long static_renders = scene->get_layer_cache().get_num_static_renders();
+	const uint32_t other = (n_boxes / 2 + 1) % n_boxes;
+	const std::array<GLfloat, 2> turned = {scene->get_rotations()[other][0] + 90, scene->get_rotations()[other][1]};
+	scene->move_box(other, scene->get_positions()[other], turned);
+	drag(1);
+	bench.counter("layers/static_renders_unselected_rotation", n_boxes,
+	              (double) (scene->get_layer_cache().get_num_static_renders() - static_renders));
+}
+
+/**
+ * Benchmarks of the frames rendered while the user clicks alternately on two boxes of a grid seen from a corner, with
+ * and without the redraw of only the dirty region
+ * @param bench The benchmark runner
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_dirty_region(const cgvBenchmark& bench, unsigned int n_boxes) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(*scene);
+
+	float extent = 1;
+	for (const cgvPoint3D& p : scene->get_positions()) {
+		for (int i = X; i <= Z; ++i) extent = std::max(extent, std::abs(p[i]) + 2);
+	}
+	cgvCamera camera(cgvPoint3D(extent * 2, extent * 1.5f, extent * 2.5f), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(extent * 1.8f, extent * 1.8f, 0.1, extent * 8);
+	scene->set_camera(&camera);
+	scene->get_gl_state().enable(GL_LIGHTING);
+
+	GLubyte selected[2][3];
+	cgvBox::id_to_color(n_boxes / 2 + 1, selected[0]);
+	cgvBox::id_to_color(n_boxes / 2 + 2, selected[1]);
+
+	auto toggle = [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			scene->assignSelection(selected[i % 2]);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+		}
+		glFinish();
+	};
+
+	bench.run("scene/render_display_select_toggle", n_boxes, toggle);
+
+	// the whole frame is rendered in the first frame; the measured frames only redraw the two boxes
+	scene->set_partial_redraw(true);
+	toggle(1);
+	bench.run("scene/render_display_select_toggle_partial", n_boxes, toggle);
+	bench.counter("dirty/pixels", n_boxes, (double) scene->get_dirty_region().get_num_pixels());
+	bench.counter("dirty/redrawn_boxes", n_boxes, (double) scene->get_dirty_region().get_num_redrawn());
+}
+
+/**
+ * Benchmarks of the views of a turntable around a grid rendered in a batch: the scene generated again for each view,
+ * and generated once with only the camera changed between the views, hashed by the workers of cgvSequenceExporter
+ * @param bench The benchmark runner
+ * @param context The headless context where the scene is rendered
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_views(const cgvBenchmark& bench, cgvHeadlessContext& context, unsigned int n_boxes) {
+	const uint32_t width = (uint32_t) context.get_width(), height = (uint32_t) context.get_height();
+	cgvCamera camera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(5, 5, 0.1, 200);
+	cgvViewList views;
+	views.turntable(camera, 36);
+
+	cgvSequenceExporter exporter;
+	bench.run("views/load_per_view_hash", n_boxes, [&](unsigned long n) {
+		exporter.start("", width, height);
+		for (unsigned long i = 0; i < n; ++i) {
+			std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+			cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(*scene);
+			camera = views.get_views()[i % views.get_num_views()];
+			scene->set_camera(&camera);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+			exporter.capture((uint32_t) i);
+		}
+		exporter.finish();
+	});
+
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D());
+	cgvSceneGenerator(CGV_LAYOUT_GRID, n_boxes, 1).generate(*scene);
+	scene->set_camera(&camera);
+	bench.run("views/batch_hash", n_boxes, [&](unsigned long n) {
+		exporter.start("", width, height);
+		for (unsigned long i = 0; i < n; ++i) {
+			camera = views.get_views()[i % views.get_num_views()];
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera.apply();
+			scene->render(CGV_DISPLAY);
+			exporter.capture((uint32_t) i);
+		}
+		exporter.finish();
+	});
+	bench.counter("views/stalls", n_boxes, (double) exporter.get_num_stalls());
+}
+
+/**
+ * Benchmarks of the rendering of the scene with the core profile renderer
+ * @param bench The benchmark runner
+ * @param context The headless core profile context where the scene is rendered
+ * @param renderer The renderer, initialized in the context
+ * @param n_boxes Number of boxes of the scene
+ */
+static void bench_core_scene(const cgvBenchmark& bench, cgvHeadlessContext& context, cgvShaderRenderer& renderer,
+                             unsigned int n_boxes) {
+	std::unique_ptr<cgvScene3D> scene(new cgvScene3D(n_boxes));
+
+	cgvCamera camera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
+	camera.setParallelParameters(5, 5, 0.1, 200);
+
+	for (RenderMode mode : {CGV_DISPLAY, CGV_SELECT}) {
+		std::string name = (mode == CGV_DISPLAY) ? "core/render_display" : "core/render_select";
+		bench.run(name, n_boxes, [&](unsigned long n) {
+			for (unsigned long i = 0; i < n; ++i) {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				renderer.render(*scene, camera, mode);
+			}
+			glFinish();
+		});
+	}
+
+	if (renderer.supports_gpu_culling()) {
+		renderer.set_gpu_culling(true);
+		bench.run("core/render_display_gpu_culling", n_boxes, [&](unsigned long n) {
+			for (unsigned long i = 0; i < n; ++i) {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				renderer.render(*scene, camera, CGV_DISPLAY);
+			}
+			glFinish();
+		});
+		bench.counter("core/visible_boxes", n_boxes, (double) renderer.read_num_visible());
+		renderer.set_gpu_culling(false);
+	}
+
+	// a selected box rotates in every frame: only its instance is written in the ring
+	GLubyte first[3];
+	cgvBox::id_to_color(1, first);
+	scene->assignSelection(first);
+	unsigned long waits = renderer.get_ring().get_num_waits();
+	bench.run("core/rotate_selected", n_boxes, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) {
+			scene->updateRotation(1, 0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			renderer.render(*scene, camera, CGV_DISPLAY);
+		}
+		glFinish();
+	});
+	bench.counter("core/instances_written", n_boxes, (double) renderer.get_instances_written());
+	bench.counter("core/ring_waits", n_boxes, (double) (renderer.get_ring().get_num_waits() - waits));
+
+	bench.run("core/picking_click", n_boxes, [&](unsigned long n) {
+		GLubyte pixel[3];
+		for (unsigned long i = 0; i < n; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			renderer.render(*scene, camera, CGV_SELECT);
+			glReadPixels(context.get_width() / 2, context.get_height() / 2, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+			scene->assignSelection(pixel);
+		}
+	});
+}
+
+
+int main(int argc, char** argv) {
+	cgvBenchmark bench;
+	if (!bench.parse_args(argc, argv)) return EXIT_FAILURE;
+
+	bench_points(bench);
+	for (unsigned int n_boxes : bench.scene_sizes()) {
+		bench_generator(bench, n_boxes);
+		bench_snapshot(bench, n_boxes);
+		bench_paging(bench, n_boxes);
+		bench_reload(bench, n_boxes);
+		bench_ingest(bench, n_boxes);
+		bench_render_queue(bench, n_boxes);
+	}
+
+	cgvHeadlessContext context;
+	if (!context.create(500, 500)) {
+		fprintf(stderr, "The benchmarks that require OpenGL are skipped\n");
+		return EXIT_SUCCESS;
+	}
+	bench.info("gl_renderer", (const char*) glGetString(GL_RENDERER));
+	bench.info("gl_version", (const char*) glGetString(GL_VERSION));
+
+	// same OpenGL state as cgvInterface::configure_environment
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(1.0, 1.0, 1.0, 0.0);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_NORMALIZE);
+
+	bench_camera(bench);
+	bench_frames(bench, context);
+	bench_export(bench, context);
+	bench_instances(bench);
+
+	for (unsigned int n_boxes : bench.scene_sizes()) {
+		bench_scene(bench, context, n_boxes);
+		bench_occlusion(bench, n_boxes);
+		bench_impostors(bench, n_boxes);
+		bench_layers(bench, n_boxes);
+		bench_dirty_region(bench, n_boxes);
+		bench_views(bench, context, n_boxes);
+	}
+	context.destroy();
+
+	// the same scenes with the core profile renderer
+	cgvHeadlessContext core_context;
+	cgvShaderRenderer renderer;
+	if (!core_context.create(500, 500, true) || !renderer.init()) {
+		fprintf(stderr, "The benchmarks of the core profile renderer are skipped\n");
+		return EXIT_SUCCESS;
+	}
+	bench.info("gl_core_version", (const char*) glGetString(GL_VERSION));
+
+	// startup of the renderer: compilation of the shaders or load of the binaries of a previous execution
+	bench.run("core/init_compile", 0, [&](unsigned long n) {
+		for (unsigned long i = 0; i < n; ++i) renderer.init();
+		glFinish();
+	});
+	cgvProgramCache cache;
+	if (cache.is_enabled()) {
+		bench.info("shader_cache", cache.get_directory());
+		renderer.init(&cache); // it stores the binaries if they were not in the cache
+		bench.run("core/init_cached", 0, [&](unsigned long n) {
+			for (unsigned long i = 0; i < n; ++i) renderer.init(&cache);
+			glFinish();
+		});
+		bench.counter("core/programs_loaded", 0, (double) cache.get_num_loaded());
+		bench.counter("core/programs_compiled", 0, (double) cache.get_num_compiled());
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(1.0, 1.0, 1.0, 0.0);
+
+	for (unsigned int n_boxes : bench.scene_sizes()) {
+		bench_core_scene(bench, core_context, renderer, n_boxes);
+	}
+
+	return EXIT_SUCCESS;
+}
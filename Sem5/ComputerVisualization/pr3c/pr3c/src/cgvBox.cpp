@@ -1,6 +1,35 @@
-#include "cgvBox.h"
+#include <algorithm>
 
+#include "cgvBox.h"
 
+// Geometry of a unit cube centered at the origin: 6 faces as quads (CCW seen from outside) with their normals.
+// It replaces glutSolidCube(1), which can only be called once GLUT has created a window.
+static const GLfloat cube_vertices[24][3] = {
+	{ 0.5f,-0.5f,-0.5f}, { 0.5f, 0.5f,-0.5f}, { 0.5f, 0.5f, 0.5f}, { 0.5f,-0.5f, 0.5f}, // +X
+	{-0.5f,-0.5f,-0.5f}, {-0.5f,-0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f,-0.5f}, // -X
+	{-0.5f, 0.5f,-0.5f}, {-0.5f, 0.5f, 0.5f}, { 0.5f, 0.5f, 0.5f}, { 0.5f, 0.5f,-0.5f}, // +Y
+	{-0.5f,-0.5f,-0.5f}, { 0.5f,-0.5f,-0.5f}, { 0.5f,-0.5f, 0.5f}, {-0.5f,-0.5f, 0.5f}, // -Y
+	{-0.5f,-0.5f, 0.5f}, { 0.5f,-0.5f, 0.5f}, { 0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}, // +Z
+	{-0.5f,-0.5f,-0.5f}, {-0.5f, 0.5f,-0.5f}, { 0.5f, 0.5f,-0.5f}, { 0.5f,-0.5f,-0.5f}  // -Z
+};
+
+static const GLfloat cube_normals[24][3] = {
+	{ 1, 0, 0}, { 1, 0, 0}, { 1, 0, 0}, { 1, 0, 0},
+	{-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0},
+	{ 0, 1, 0}, { 0, 1, 0}, { 0, 1, 0}, { 0, 1, 0},
+	{ 0,-1, 0}, { 0,-1, 0}, { 0,-1, 0}, { 0,-1, 0},
+	{ 0, 0, 1}, { 0, 0, 1}, { 0, 0, 1}, { 0, 0, 1},
+	{ 0, 0,-1}, { 0, 0,-1}, { 0, 0,-1}, { 0, 0,-1}
+};
+
+// Materials of the box
+const GLfloat cgvBox::color_piece[4] = { 0,0.25,0,1.0 };
+const GLfloat cgvBox::color_piece_top[4] = { 0,0.3,0,1.0 };
+const GLfloat cgvBox::selected_color[4] = { 1,1,0,1.0 };
+
+// Transformation of the unit cube for each piece of the box
+const GLfloat cgvBox::part_scale[2][3] = { { 1.1f,1,2 }, { 1.15f,0.2f,2.05f } };
+const GLfloat cgvBox::part_offset[2][3] = { { 0,0,0 }, { 0,0.4f,0 } };
 
 /**
  * Parametrized constructor
@@ -28,69 +57,68 @@ cgvBox::cgvBox(GLubyte _color_as_ID[3]) {
 	}
 }
 
+/**
+ * Parametrized constructor
+ * @param id Numerical identifier of the box, encoded in the color as 0xRRGGBB
+ * @pre It is assumed that 0 < id < 0xFFFFFF (the background color of the window is white)
+ * @post Create a new instance of the box with the RGB color of the identifier
+ */
+cgvBox::cgvBox(GLuint id) {
+	id_to_color(id, color_as_ID);
+}
+
 /**
  * Method to render the box
  * @param mode It can be CGV_DISPLAY (normal rendering) or CGV_SELECT and render with the color_as_ID to use the color buffer technique
+ * @param state OpenGL state used to drop redundant changes of material and color
  * @pre It is assumed that the parameters are valid
  * @post If mode=CGV_DISPLAY->(normal rendering) if CGV_SELECT render with the color_as_ID to use the color buffer technique
  */
-void cgvBox::render(RenderMode mode) {
-
-	GLfloat color_piece[] = { 0,0.25,0 };
-	GLfloat color_piece_top[] = { 0,0.3,0 };
-
-	GLfloat selected_color[] = { 1,1,0,1.0 };
-
+void cgvBox::render(RenderMode mode, cgvGLState &state) {
 
 	// TODO: Section A. Add the required code to render in selection mode. Use glColor instead of glMaterial.
 	// TODO: Section A. Add the required code to render the selected box as yellow (selected_color).
 
-
 	if (mode == CGV_SELECT) {
-		// Render with the unique color ID for selection
-		glColor3ubv(color_as_ID);
+		render_as<CGV_SELECT, false>(state);
+	} else if (selected) {
+		render_as<CGV_DISPLAY, true>(state);
 	} else {
-		// Normal rendering
-		if (selected) {
-			glMaterialfv(GL_FRONT, GL_EMISSION, selected_color);
-			glColor4f(selected_color[0],selected_color[1],selected_color[2],selected_color[3]); // Yellow color for selected box
-		} else {
-			glMaterialfv(GL_FRONT, GL_EMISSION, color_piece);
-			glColor3f(color_piece[0],color_piece[1],color_piece[2]); // Green for unselected box
-		}
+		render_as<CGV_DISPLAY, false>(state);
 	}
+}
 
-	glPushMatrix();
-
-	glScalef(1.1, 1, 2);
-	glutSolidCube(1);
-
-	glPopMatrix();
-
-	//glMaterialfv(GL_FRONT, GL_EMISSION, color_piece_top);
-
+/**
+ * Method to set the material and color of one piece of the box
+ * @param mode CGV_DISPLAY (material of the piece, yellow if the box is selected) or CGV_SELECT (color_as_ID)
+ * @param part CGV_BOX_BODY or CGV_BOX_TOP
+ * @param state OpenGL state used to drop redundant changes of material and color
+ */
+void cgvBox::apply_material(RenderMode mode, boxPart part, cgvGLState &state) const {
 	if (mode == CGV_SELECT) {
-		// Render with the unique color ID for selection
-		glColor3ubv(color_as_ID);
+		apply_material_as<CGV_SELECT, false>(part, state);
+	} else if (selected) {
+		apply_material_as<CGV_DISPLAY, true>(part, state);
 	} else {
-		// Normal rendering
-		if (selected) {
-			glMaterialfv(GL_FRONT, GL_EMISSION, selected_color);
-			glColor4f(selected_color[0],selected_color[1],selected_color[2],selected_color[3]); // Yellow color for selected box
-		} else {
-			glMaterialfv(GL_FRONT, GL_EMISSION, color_piece_top);
-			glColor3f(color_piece_top[0],color_piece_top[1],color_piece_top[2]); // Green for unselected box
-		}
+		apply_material_as<CGV_DISPLAY, false>(part, state);
 	}
+}
 
+/**
+ * Method to render the geometry of one piece of the box, with the current material
+ * @param part CGV_BOX_BODY (1.1 x 1 x 2 cube) or CGV_BOX_TOP (1.15 x 0.2 x 2.05 piece on top of the body)
+ * @param state OpenGL state, used to enable the vertex arrays of the cube
+ */
+void cgvBox::draw_part(boxPart part, cgvGLState &state) {
 	glPushMatrix();
-	glTranslatef(0, 0.4, 0);
-	glScalef(1.15, 0.2, 2.05);
 
-	glutSolidCube(1);
+	if (part == CGV_BOX_TOP) {
+		glTranslatef(part_offset[part][0], part_offset[part][1], part_offset[part][2]);
+	}
+	glScalef(part_scale[part][0], part_scale[part][1], part_scale[part][2]);
+	draw_unit_cube(state);
 
 	glPopMatrix();
-
 }
 
 /**
@@ -103,3 +131,104 @@ void cgvBox::select(GLubyte c[3]) {
 	selected = (color_as_ID[0] == c[0] && color_as_ID[1] == c[1] && color_as_ID[2] == c[2]);
 }
 
+
+/**
+ * Method to render a cube of side 1 centered at the origin, with normals
+ * @param state OpenGL state, used to enable the vertex arrays of the cube only when they are not already enabled
+ * @post The cube is rendered with the current material, color and modelview matrix. The vertex and normal arrays
+ * remain enabled
+ */
+void cgvBox::draw_unit_cube(cgvGLState &state) {
+	state.vertex_arrays(cube_vertices, cube_normals);
+
+	glDrawArrays(GL_QUADS, 0, 24);
+}
+
+/**
+ * Build the geometry of a whole box (body and top piece) as an indexed list of triangles, in the coordinates of the box
+ * @param vertices Output vertices, 7 floats each: position (3), normal (3) and piece (0: body, 1: top)
+ * @param indices Output indices, 3 per triangle
+ * @post The geometry is the same one rendered by draw_part for both pieces. The previous content of the vectors is
+ * replaced
+ */
+void cgvBox::build_mesh(std::vector<GLfloat> &vertices, std::vector<GLuint> &indices) {
+	vertices.clear();
+	indices.clear();
+
+	for (int part = CGV_BOX_BODY; part <= CGV_BOX_TOP; ++part) {
+		GLuint first = (GLuint) (vertices.size() / 7);
+		for (int v = 0; v < 24; ++v) {
+			for (int c = 0; c < 3; ++c) {
+				vertices.push_back(cube_vertices[v][c] * part_scale[part][c] + part_offset[part][c]);
+			}
+			// the scale is positive and axis-aligned: the normals of the faces do not change
+			vertices.insert(vertices.end(), cube_normals[v], cube_normals[v] + 3);
+			vertices.push_back((GLfloat) part);
+		}
+		// every quad is split in two triangles with the same orientation
+		for (GLuint q = first; q < first + 24; q += 4) {
+			GLuint quad[6] = { q, q + 1, q + 2, q, q + 2, q + 3 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+/**
+ * Build the proxy of a box: a single closed surface with the outline of the body and the top piece together, without
+ * the faces hidden inside it. It covers exactly the same pixels as the box, with 16 vertices instead of 48
+ * @param vertices Output vertices (PROXY_VERTICES), in the coordinates of the box
+ * @param indices Output indices of the triangles (PROXY_INDICES), CCW seen from outside
+ * @pre The top piece is wider than the body, and it contains the top face of the body
+ */
+void cgvBox::build_proxy(GLfloat vertices[][3], GLushort indices[]) {
+	// corners of each level in XZ, CCW seen from below
+	static const GLfloat corner[4][2] = { {-0.5f,-0.5f}, {0.5f,-0.5f}, {0.5f,0.5f}, {-0.5f,0.5f} };
+	const GLfloat top_bottom = part_offset[CGV_BOX_TOP][1] - part_scale[CGV_BOX_TOP][1] / 2;
+
+	// 4 levels: bottom of the body, body and top piece where they meet, and top of the top piece
+	const GLfloat level_y[4] = { part_offset[CGV_BOX_BODY][1] - part_scale[CGV_BOX_BODY][1] / 2, top_bottom, top_bottom,
+	                             part_offset[CGV_BOX_TOP][1] + part_scale[CGV_BOX_TOP][1] / 2 };
+	for (int level = 0; level < 4; ++level) {
+		const int part = (level < 2) ? CGV_BOX_BODY : CGV_BOX_TOP;
+		for (int k = 0; k < 4; ++k) {
+			vertices[4 * level + k][0] = corner[k][0] * part_scale[part][0] + part_offset[part][0];
+			vertices[4 * level + k][1] = level_y[level];
+			vertices[4 * level + k][2] = corner[k][1] * part_scale[part][2] + part_offset[part][2];
+		}
+	}
+
+	// bottom faces of both pieces, sides of the body (up to the top piece), sides and top face of the top piece
+	GLushort quads[11][4] = { {0, 1, 2, 3}, {8, 9, 10, 11}, {15, 14, 13, 12} };
+	for (GLushort k = 0; k < 4; ++k) {
+		GLushort next = (k + 1) % 4;
+		GLushort body[4] = { next, k, (GLushort) (4 + k), (GLushort) (4 + next) };
+		std::copy(body, body + 4, quads[3 + k]);
+		for (GLushort &v: body) v += 8;
+		std::copy(body, body + 4, quads[7 + k]);
+	}
+	for (int q = 0; q < 11; ++q) {
+		GLushort triangles[6] = { quads[q][0], quads[q][1], quads[q][2], quads[q][0], quads[q][2], quads[q][3] };
+		std::copy(triangles, triangles + 6, indices + 6 * q);
+	}
+}
+
+/**
+ * Encode a numerical identifier as an RGB color
+ * @param id Identifier of a box
+ * @param c Output RGB color, 0xRRGGBB
+ * @pre It is assumed that id fits in 24 bits
+ */
+void cgvBox::id_to_color(GLuint id, GLubyte c[3]) {
+	c[0] = (id >> 16) & 0xFF;
+	c[1] = (id >> 8) & 0xFF;
+	c[2] = id & 0xFF;
+}
+
+/**
+ * Decode an RGB color as a numerical identifier
+ * @param c RGB color with three components
+ * @return The identifier 0xRRGGBB
+ */
+GLuint cgvBox::color_to_id(const GLubyte c[3]) {
+	return ((GLuint) c[0] << 16) | ((GLuint) c[1] << 8) | (GLuint) c[2];
+}
@@ -8,6 +8,10 @@
 #include <GL/glut.h>
 #endif
 
+#include <vector>
+
+#include "cgvGLState.h"
+
 /**
  * Modes of rendering
  */
@@ -16,6 +20,15 @@ typedef enum {
     CGV_SELECT ///< The scene is rendered in selection mode to calculate the selected object with the color buffer technique
 } RenderMode;
 
+/**
+ * Pieces of a box
+ */
+typedef enum {
+    CGV_BOX_BODY, ///< Main cube of the box
+    CGV_BOX_TOP, ///< Thin piece on top of the body
+    CGV_NUM_BOX_PARTS
+} boxPart;
+
 
 /**
  * The instances of this class are 3D boxes. They are prepared to use the color buffer technique. 
@@ -25,17 +38,103 @@ class cgvBox {
 	GLubyte color_as_ID[3]={0,0,0}; ///< RGB color used as an identifier
 	bool selected=false; ///< Indicate whether the box is selected or not
 
+	static const GLfloat color_piece[4]; ///< Emission of the body of a non-selected box
+	static const GLfloat color_piece_top[4]; ///< Emission of the top piece of a non-selected box
+	static const GLfloat selected_color[4]; ///< Emission of a selected box
+
+	static const GLfloat part_scale[2][3]; ///< Scale of the unit cube for each piece
+	static const GLfloat part_offset[2][3]; ///< Translation of each piece
+
+	friend class cgvSnapshot; // the snapshots store the boxes with this layout
+	friend class cgvPagedScene; // and so do the page files
+
 public:
 	cgvBox() = default; 
 	cgvBox(GLubyte _r, GLubyte _g, GLubyte _b);
 	cgvBox(GLubyte _color_as_ID[3]);
+	explicit cgvBox(GLuint id);
 	~cgvBox() = default; 
 
-	void render(RenderMode mode);
+	void render(RenderMode mode, cgvGLState &state);
+	void apply_material(RenderMode mode, boxPart part, cgvGLState &state) const;
+	static void draw_part(boxPart part, cgvGLState &state);
+
+	// Versions of the methods above resolved at compile time for a mode and a selection state
+	template <RenderMode mode, bool is_selected>
+	void render_as(cgvGLState &state) const;
+	template <RenderMode mode, bool is_selected>
+	void apply_material_as(boxPart part, cgvGLState &state) const;
 
 	void select(GLubyte c[3]); 
 
 	bool isSelected() const { return selected; }
 
+	GLuint get_id() const { return color_to_id(color_as_ID); }
+
+	static void id_to_color(GLuint id, GLubyte c[3]);
+	static GLuint color_to_id(const GLubyte c[3]);
+
+	static void draw_unit_cube(cgvGLState &state);
+	static void build_mesh(std::vector<GLfloat> &vertices, std::vector<GLuint> &indices);
+	static void build_proxy(GLfloat vertices[][3], GLushort indices[]);
+
+	static const int PROXY_VERTICES = 16; ///< Vertices of the proxy of a box, see build_proxy
+	static const int PROXY_INDICES = 66; ///< Indices of the triangles of the proxy of a box
+
+	/**
+	 * @param part CGV_BOX_BODY, CGV_BOX_TOP or CGV_NUM_BOX_PARTS (selected box)
+	 * @return Emission of the piece of a box (4 components)
+	 */
+	static const GLfloat *get_emission(int part) {
+		return (part == CGV_BOX_BODY) ? color_piece : ((part == CGV_BOX_TOP) ? color_piece_top : selected_color);
+	}
+
+	/**
+	 * @return Radius of a sphere centered at the origin that contains the box (body and top piece), whatever its rotation
+	 */
+	static float bounding_radius() { return 1.2772f; }
+
 };
 
+
+/**
+ * Method to render the box, specialized at compile time
+ * @tparam mode CGV_DISPLAY or CGV_SELECT
+ * @tparam is_selected Selection state of the box (only used in CGV_DISPLAY mode)
+ * @param state OpenGL state used to drop redundant changes of material and color
+ * @pre It is assumed that is_selected == isSelected() in CGV_DISPLAY mode
+ * @post The same result as render(mode, state). When both pieces use the same color (selection mode or selected
+ * box), the color is only set once
+ */
+template <RenderMode mode, bool is_selected>
+void cgvBox::render_as(cgvGLState &state) const {
+	apply_material_as<mode, is_selected>(CGV_BOX_BODY, state);
+	draw_part(CGV_BOX_BODY, state);
+
+	if ((mode == CGV_DISPLAY) && !is_selected) {
+		apply_material_as<mode, is_selected>(CGV_BOX_TOP, state);
+	}
+	draw_part(CGV_BOX_TOP, state);
+}
+
+/**
+ * Method to set the material and color of one piece of the box, specialized at compile time
+ * @tparam mode CGV_DISPLAY (material of the piece, yellow if the box is selected) or CGV_SELECT (color_as_ID)
+ * @tparam is_selected Selection state of the box (only used in CGV_DISPLAY mode)
+ * @param part CGV_BOX_BODY or CGV_BOX_TOP
+ * @param state OpenGL state used to drop redundant changes of material and color
+ */
+template <RenderMode mode, bool is_selected>
+void cgvBox::apply_material_as(boxPart part, cgvGLState &state) const {
+	if (mode == CGV_SELECT) {
+		// Render with the unique color ID for selection
+		state.color3ubv(color_as_ID);
+	} else if (is_selected) {
+		state.material_emission(GL_FRONT, selected_color);
+		state.color4f(selected_color[0],selected_color[1],selected_color[2],selected_color[3]); // Yellow color for selected box
+	} else {
+		const GLfloat *color = (part == CGV_BOX_BODY) ? color_piece : color_piece_top;
+		state.material_emission(GL_FRONT, color);
+		state.color3f(color[0],color[1],color[2]); // Green for unselected box
+	}
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+
+#include "cgvBufferRing.h"
+#include "cgvGLState.h"
+
+/**
+ * Destructor. The buffer is released
+ * @pre The context where create() was called must be current
+ */
+cgvBufferRing::~cgvBufferRing() {
+	destroy();
+}
+
+/**
+ * Create the buffer with all its segments
+ * @param _segment_size Minimum size in bytes of each segment
+ * @param allow_persistent false to use glBufferSubData even if the persistent mapping is available
+ * @retval true if the buffer has been created, false otherwise (the reason is written to stderr)
+ * @pre An OpenGL 3.3 (or later) context is current
+ * @post The content of the segments is undefined. The first frame uses segment 0. The size of the segments is a
+ * multiple of SEGMENT_ALIGNMENT, so that any of them can also be bound as a shader storage buffer
+ */
+bool cgvBufferRing::create(size_t _segment_size, bool allow_persistent) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	destroy();
+	if (_segment_size == 0) _segment_size = 1;
+	segment_size = (_segment_size + SEGMENT_ALIGNMENT - 1) / SEGMENT_ALIGNMENT * SEGMENT_ALIGNMENT;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	if (allow_persistent && cgvGLState::supports(4, 4, "GL_ARB_buffer_storage")) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		n_segments = MAX_SEGMENTS;
+		glBufferStorage(GL_ARRAY_BUFFER, n_segments * segment_size, nullptr, flags);
+		mapped = (GLubyte *) glMapBufferRange(GL_ARRAY_BUFFER, 0, n_segments * segment_size, flags);
+		if (!mapped) {
+			fprintf(stderr, "cgvBufferRing: unable to map the buffer, glBufferSubData is used\n");
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		}
+	}
+	if (!mapped) {
+		n_segments = 1;
+		glBufferData(GL_ARRAY_BUFFER, segment_size, nullptr, GL_DYNAMIC_DRAW);
+		copy.resize(segment_size);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "cgvBufferRing: unable to create a buffer of %lu bytes\n",
+		        (unsigned long) (n_segments * segment_size));
+		destroy();
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Release the buffer and the fences
+ */
+void cgvBufferRing::destroy() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	for (GLsync &fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	if (buffer) glDeleteBuffers(1, &buffer);
+#endif
+	buffer = 0;
+	mapped = nullptr;
+	copy.clear();
+	segment_size = 0;
+	n_segments = 0;
+	current = 0;
+}
+
+/**
+ * Start writing the segment of the current frame
+ * @return Pointer to the memory of the segment (get_segment_size() bytes). It keeps the content written the last
+ * time that the same segment was used
+ * @post With persistent mapping, the CPU only waits if the GPU is still reading the segment, that is, if it is more
+ * than MAX_SEGMENTS - 1 frames behind
+ */
+GLubyte *cgvBufferRing::begin_segment() {
+	written_begin = segment_size;
+	written_end = 0;
+	if (!mapped) return copy.data();
+
+#ifdef CGV_HAVE_CORE_PROFILE
+	GLsync &fence = fences[current];
+	if (fence) {
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if ((result == GL_TIMEOUT_EXPIRED) || (result == GL_WAIT_FAILED)) {
+			++n_waits;
+			// the commands must be flushed, otherwise the fence could never be signaled
+			GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+			while ((result == GL_TIMEOUT_EXPIRED) || (result == GL_WAIT_FAILED)) {
+				result = glClientWaitSync(fence, flags, 1000000000); // 1 second
+				if (result == GL_WAIT_FAILED) break;
+				flags = 0;
+			}
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+#endif
+	return mapped + current * segment_size;
+}
+
+/**
+ * Indicate that a range of the current segment has been written
+ * @param offset First byte written, from the beginning of the segment
+ * @param size Number of bytes written
+ * @post Without persistent mapping, the union of the ranges is uploaded by flush()
+ */
+void cgvBufferRing::written(size_t offset, size_t size) {
+	if (offset < written_begin) written_begin = offset;
+	if (offset + size > written_end) written_end = offset + size;
+}
+
+/**
+ * Make the content written in the current segment visible to OpenGL
+ * @pre It must be called after writing the segment and before the draw calls that read it
+ * @post With persistent coherent mapping nothing has to be done. Otherwise the written range is uploaded
+ */
+void cgvBufferRing::flush() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (!mapped && (written_begin < written_end)) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, written_begin, written_end - written_begin, copy.data() + written_begin);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+#endif
+	written_begin = segment_size;
+	written_end = 0;
+}
+
+/**
+ * Finish the frame that uses the current segment
+ * @pre The draw calls that read the segment have already been issued
+ * @post A fence protects the segment until those draw calls finish. The next frame uses the next segment
+ */
+void cgvBufferRing::end_segment() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (mapped) {
+		fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		current = (current + 1) % n_segments;
+	}
+#endif
+}
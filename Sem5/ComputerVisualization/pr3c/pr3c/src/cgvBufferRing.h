@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+/**
+ * cgvBufferRing is a buffer object split in several segments that are written by the CPU and read by OpenGL in turns,
+ * one segment per frame. With OpenGL 4.4 or ARB_buffer_storage the buffer is mapped persistently and coherently:
+ * the CPU writes directly into the memory read by the GPU, and a fence per segment guarantees that a segment is not
+ * written while a previous frame is still reading it. Otherwise there is only one segment, written in a copy in the
+ * CPU and uploaded with glBufferSubData.
+ */
+class cgvBufferRing {
+public:
+	static const int MAX_SEGMENTS = 3; ///< Number of segments of the persistent buffer (triple buffering)
+	static const size_t SEGMENT_ALIGNMENT = 256; ///< The size of the segments is a multiple of this value
+
+private:
+	GLuint buffer = 0; ///< Buffer object
+	size_t segment_size = 0; ///< Size in bytes of each segment
+	int n_segments = 0; ///< Number of segments: MAX_SEGMENTS (persistent mapping) or 1 (glBufferSubData)
+	int current = 0; ///< Segment of the current frame
+
+	GLubyte *mapped = nullptr; ///< Persistent mapping of the whole buffer (nullptr without persistent mapping)
+	GLsync fences[MAX_SEGMENTS] = {}; ///< Fence inserted after the last frame that read each segment
+	std::vector<GLubyte> copy; ///< Copy of the segment in the CPU, without persistent mapping
+
+	size_t written_begin = 0, written_end = 0; ///< Range of the current segment written in this frame (copy only)
+
+	unsigned long n_waits = 0; ///< Number of times that the CPU had to wait for the GPU to release a segment
+
+public:
+	cgvBufferRing() = default;
+	~cgvBufferRing();
+
+	cgvBufferRing(const cgvBufferRing&) = delete;
+	cgvBufferRing& operator=(const cgvBufferRing&) = delete;
+
+	bool create(size_t _segment_size, bool allow_persistent = true);
+	void destroy();
+
+	GLubyte *begin_segment();
+	void written(size_t offset, size_t size);
+	void flush();
+	void end_segment();
+
+	GLuint get_buffer() const { return buffer; };
+	size_t get_segment_size() const { return segment_size; };
+	int get_num_segments() const { return n_segments; };
+	int get_current_segment() const { return current; };
+	GLintptr get_segment_offset() const { return (GLintptr) (current * segment_size); };
+	bool is_persistent() const { return mapped != nullptr; };
+	unsigned long get_num_waits() const { return n_waits; };
+};
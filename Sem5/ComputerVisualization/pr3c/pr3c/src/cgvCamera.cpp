@@ -43,6 +43,7 @@ void cgvCamera::setCameraParameters(cgvPoint3D _PV, cgvPoint3D _rp, cgvPoint3D _
 	PV = _PV;
 	rp = _rp;
 	up = _up;
+	++revision;
 }
 
 /**
@@ -52,7 +53,7 @@ void cgvCamera::setCameraParameters(cgvPoint3D _PV, cgvPoint3D _rp, cgvPoint3D _
  * @param _up up vector
  * @return The attributes corresponding to the camera parameters 
  */
-void cgvCamera::getCameraParameters(cgvPoint3D& _PV, cgvPoint3D& _rp, cgvPoint3D& _up) {
+void cgvCamera::getCameraParameters(cgvPoint3D& _PV, cgvPoint3D& _rp, cgvPoint3D& _up) const {
 	_PV = PV;
 	_rp = rp;
 	_up = up;
@@ -78,7 +79,7 @@ void cgvCamera::setParallelParameters(double _xwhalfdistance, double _ywhalfdist
 	ywmax = _ywhalfdistance;
 	znear = _znear;
 	zfar = _zfar;
-
+	++revision;
 }
 
 /**
@@ -92,7 +93,7 @@ void cgvCamera::setParallelParameters(double _xwhalfdistance, double _ywhalfdist
  * @return The attributes corresponding to the parallel camera parameters 
  */
 void cgvCamera::getParallelParameters(double& _xwmin, double& _xwmax, double& _ywmin, double& _ywmax, 
-										double& _znear, double& _zfar)
+										double& _znear, double& _zfar) const
 {
 	_xwmin = xwmin;
 	_xwmax = xwmax;
@@ -119,7 +120,7 @@ void cgvCamera::setPerspParameters(double _fovy, double _aspect, double _znear,
 	aspect = _aspect;
 	znear = _znear;
 	zfar = _zfar;
-
+	++revision;
 }
 
 /**
@@ -130,7 +131,7 @@ void cgvCamera::setPerspParameters(double _fovy, double _aspect, double _znear,
  * @param _zfar  Far plane
  * @return The perspective camera parameters. 
  */
-void cgvCamera::getPerspParameters(double& _fovy, double& _aspect, double& _znear, double& _zfar) {
+void cgvCamera::getPerspParameters(double& _fovy, double& _aspect, double& _znear, double& _zfar) const {
 
 	_fovy = fovy; 
 	_aspect = aspect; 
@@ -161,6 +162,89 @@ void cgvCamera::apply() {
 	gluLookAt(PV[X],PV[Y],PV[Z], rp[X],rp[Y],rp[Z], up[X],up[Y],up[Z]);
 }
 
+/**
+ * Compute the view matrix of the camera, the same one that gluLookAt applies in apply()
+ * @param m Output matrix, column-major order (m[12], m[13], m[14] is the translation)
+ * @pre It is assumed that the up vector is not parallel to the direction of view
+ */
+void cgvCamera::get_view_matrix(float m[16]) const {
+	float f[3] = { rp[X] - PV[X], rp[Y] - PV[Y], rp[Z] - PV[Z] };
+	float len = sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+	for (float& v : f) v /= len;
+
+	// s = f x up
+	float s[3] = { f[1] * up[Z] - f[2] * up[Y], f[2] * up[X] - f[0] * up[Z], f[0] * up[Y] - f[1] * up[X] };
+	len = sqrtf(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+	for (float& v : s) v /= len;
+
+	// u = s x f
+	float u[3] = { s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0] };
+
+	for (int i = 0; i < 3; ++i) {
+		m[i * 4 + 0] = s[i];
+		m[i * 4 + 1] = u[i];
+		m[i * 4 + 2] = -f[i];
+		m[i * 4 + 3] = 0;
+	}
+	m[12] = -(s[0] * PV[X] + s[1] * PV[Y] + s[2] * PV[Z]);
+	m[13] = -(u[0] * PV[X] + u[1] * PV[Y] + u[2] * PV[Z]);
+	m[14] = (f[0] * PV[X] + f[1] * PV[Y] + f[2] * PV[Z]);
+	m[15] = 1;
+}
+
+/**
+ * Compute the projection matrix of the camera, the same one that glOrtho or gluPerspective apply in apply()
+ * @param m Output matrix, column-major order
+ */
+void cgvCamera::get_projection_matrix(float m[16]) const {
+	for (int i = 0; i < 16; ++i) m[i] = 0;
+
+	if (camType == CGV_PARALLEL) {
+		m[0] = (float) (2 / (xwmax - xwmin));
+		m[5] = (float) (2 / (ywmax - ywmin));
+		m[10] = (float) (-2 / (zfar - znear));
+		m[12] = (float) (-(xwmax + xwmin) / (xwmax - xwmin));
+		m[13] = (float) (-(ywmax + ywmin) / (ywmax - ywmin));
+		m[14] = (float) (-(zfar + znear) / (zfar - znear));
+		m[15] = 1;
+	} else {
+		double f = 1 / tan(fovy * 3.14159265358979323846 / 360); // cotangent of half of the field of view
+		m[0] = (float) (f / aspect);
+		m[5] = (float) f;
+		m[10] = (float) ((zfar + znear) / (znear - zfar));
+		m[11] = -1;
+		m[14] = (float) (2 * zfar * znear / (znear - zfar));
+	}
+}
+
+/**
+ * Compute the planes of the view volume of the camera, in world coordinates
+ * @param planes Output planes (a, b, c, d): left, right, bottom, top, near and far. A point p is inside the view
+ * volume if a*p[X] + b*p[Y] + c*p[Z] + d >= 0 for every plane
+ * @post (a, b, c) is unit length, so that the value is the signed distance from the point to the plane
+ */
+void cgvCamera::get_frustum_planes(float planes[6][4]) const {
+	float view[16], projection[16], m[16];
+	get_view_matrix(view);
+	get_projection_matrix(projection);
+	for (int c = 0; c < 4; ++c) {
+		for (int r = 0; r < 4; ++r) {
+			m[c * 4 + r] = projection[r] * view[c * 4] + projection[4 + r] * view[c * 4 + 1] +
+			               projection[8 + r] * view[c * 4 + 2] + projection[12 + r] * view[c * 4 + 3];
+		}
+	}
+
+	// row 3 of the matrix plus or minus rows 0 (x), 1 (y) and 2 (z)
+	for (int p = 0; p < 6; ++p) {
+		const int row = p / 2;
+		const float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+		for (int c = 0; c < 4; ++c) planes[p][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+
+		float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		for (int c = 0; c < 4; ++c) planes[p][c] /= len;
+	}
+}
+
 /**
  * Assignment operator
  * @param cam Camera to be assigned
@@ -168,6 +252,8 @@ void cgvCamera::apply() {
  * @post Update the camera parameters according to the parameter (camera)
  */
 cgvCamera &cgvCamera::operator=(const cgvCamera &cam) {
+	this->camType = cam.camType;
+
 	this->xwmin = cam.xwmin; 
 	this->xwmax = cam.xwmax; 
 	this->ywmin = cam.ywmin;
@@ -176,11 +262,17 @@ cgvCamera &cgvCamera::operator=(const cgvCamera &cam) {
 	this->znear = cam.znear; 
 	this->zfar = cam.zfar; 
 
+	this->fovy = cam.fovy;
+	this->aspect = cam.aspect;
+
 	this->PV = cam.PV;
 
 	this->rp = cam.rp;
 
 	this->up = cam.up; 
+
+	// it is a different camera: the revision cannot match any value of the previous one
+	this->revision = ((this->revision > cam.revision) ? this->revision : cam.revision) + 1;
 	return *this; 
 }
 
@@ -47,6 +47,8 @@ class cgvCamera {
 		// up vector 
 		cgvPoint3D up = {0,1,0}; ///< Up vector
 
+		unsigned long revision = 1; ///< It is incremented every time a parameter changes
+
 
 		// Methods
 
@@ -57,6 +59,7 @@ class cgvCamera {
 
 		// Other constructor
 		cgvCamera(cgvPoint3D _PV, cgvPoint3D _rp, cgvPoint3D _up);	
+		cgvCamera(const cgvCamera &cam) = default; // the copy is the same camera: it keeps the revision
 		
 		// State
 		/**
@@ -64,22 +67,33 @@ class cgvCamera {
 		 */
 		bool isParallel() const { return (camType == CGV_PARALLEL); }
 
+		/**
+		 * @retval Number that changes every time the parameters of the camera change (never 0)
+		 */
+		unsigned long get_revision() const { return revision; }
+
 		// Methods
 		// Defining the camera parameters
 		void setCameraParameters(cgvPoint3D _PV, cgvPoint3D _rp, cgvPoint3D _up);
-		void getCameraParameters(cgvPoint3D& _PV, cgvPoint3D& _rp, cgvPoint3D& _up);
+		void getCameraParameters(cgvPoint3D& _PV, cgvPoint3D& _rp, cgvPoint3D& _up) const;
 
 		// Defining the projection
 		void setParallelParameters(double _xwhalfdistance, double _ywhalfdistance,
 			double _znear, double _zfar);
 		void getParallelParameters(double& _xwmin, double& _xwmax, double& _ywmin, double& _ywmax,
-			double& _znear, double& _zfar);
+			double& _znear, double& _zfar) const;
 
 		void setPerspParameters(double _fovy, double _aspect, double _znear, double _zfar);
-		void getPerspParameters(double& _fovy, double& _aspect, double& _znear, double& _zfar);
+		void getPerspParameters(double& _fovy, double& _aspect, double& _znear, double& _zfar) const;
 
 		// Apply the camera
 		void apply(); // apply the view and projection transformations to the object of the scene. 
+
+		// Matrices of the camera computed in the CPU (column-major order, as OpenGL)
+		void get_view_matrix(float m[16]) const;
+		void get_projection_matrix(float m[16]) const;
+		void get_frustum_planes(float planes[6][4]) const;
+		void get_depth_range(double& _znear, double& _zfar) const { _znear = znear; _zfar = zfar; }
 		                    
 		cgvCamera &operator=(const cgvCamera &cam);
 
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cmath>
+
+#include "cgvDirtyRegion.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+/**
+ * Store the state of a scene that has just been drawn completely
+ * @param scene The scene
+ * @param camera Camera of the frame
+ * @pre The viewport of the frame has been set
+ * @post The rectangle of every box is computed for the view of the camera, and the dirty region is empty
+ */
+void cgvDirtyRegion::reset(const cgvScene3D &scene, const cgvCamera &camera) {
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	width = viewport[2];
+	height = viewport[3];
+
+	float view[16], projection[16], m[16];
+	camera.get_view_matrix(view);
+	camera.get_projection_matrix(projection);
+	for (int c = 0; c < 4; ++c) {
+		for (int r = 0; r < 4; ++r) {
+			m[c * 4 + r] = projection[r] * view[c * 4] + projection[4 + r] * view[c * 4 + 1] +
+			               projection[8 + r] * view[c * 4 + 2] + projection[12 + r] * view[c * 4 + 3];
+		}
+	}
+
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	const uint32_t n_boxes = scene.get_num_boxes();
+	const float radius = cgvBox::bounding_radius();
+	box_rects.resize(n_boxes);
+	drawn_selected.resize(n_boxes);
+	drawn_angles.resize(n_boxes);
+	in_region.assign(n_boxes, 0);
+	for (uint32_t i = 0; i < n_boxes; ++i) {
+		drawn_selected[i] = scene.get_boxes()[i].isSelected();
+		drawn_angles[i] = rotations[i][0];
+
+		// projection of the corners of the bounding box of the bounding sphere
+		float x0 = (float) width, y0 = (float) height, x1 = 0, y1 = 0;
+		bool behind = false;
+		for (int k = 0; k < 8; ++k) {
+			const float p[3] = { positions[i][X] + ((k & 1) ? radius : -radius),
+			                     positions[i][Y] + ((k & 2) ? radius : -radius),
+			                     positions[i][Z] + ((k & 4) ? radius : -radius) };
+			float clip[4];
+			for (int r = 0; r < 4; ++r) clip[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+			behind = (clip[3] <= 0);
+			if (behind) break;
+			const float x = (clip[0] / clip[3] + 1) * 0.5f * width, y = (clip[1] / clip[3] + 1) * 0.5f * height;
+			x0 = std::min(x0, x);
+			x1 = std::max(x1, x);
+			y0 = std::min(y0, y);
+			y1 = std::max(y1, y);
+		}
+		// one more pixel on each side for the rasterization of the edges
+		rect &r = box_rects[i];
+		if (behind) {
+			r = {0, 0, width, height};
+		} else {
+			r.x0 = std::max(0, (GLint) std::floor(x0) - 1);
+			r.y0 = std::max(0, (GLint) std::floor(y0) - 1);
+			r.x1 = std::min(width, (GLint) std::ceil(x1) + 1);
+			r.y1 = std::min(height, (GLint) std::ceil(y1) + 1);
+		}
+	}
+
+	box_changes = scene.get_num_box_changes();
+	region = {0, 0, 0, 0};
+	n_changed = n_redrawn = 0;
+}
+
+/**
+ * Find the dirty region: the boxes whose selection or rotation has changed since they were drawn
+ * @param scene The scene, with the same boxes and view of the last reset
+ * @retval true if the dirty region is not empty. Then is_in_region tells the boxes that must be redrawn in it
+ * @post The boxes are considered drawn with their current state
+ */
+bool cgvDirtyRegion::update(const cgvScene3D &scene) {
+	n_changed = n_redrawn = 0;
+	region = {0, 0, 0, 0};
+	if (scene.get_num_box_changes() == box_changes) return false;
+	box_changes = scene.get_num_box_changes();
+
+	const vector<cgvBox> &boxes = scene.get_boxes();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	const uint32_t n_boxes = (uint32_t) boxes.size();
+	rect dirty = {width, height, 0, 0};
+	for (uint32_t i = 0; i < n_boxes; ++i) {
+		if ((boxes[i].isSelected() == (bool) drawn_selected[i]) && (rotations[i][0] == drawn_angles[i])) continue;
+		drawn_selected[i] = boxes[i].isSelected();
+		drawn_angles[i] = rotations[i][0];
+		const rect &r = box_rects[i];
+		if ((r.x0 >= r.x1) || (r.y0 >= r.y1)) continue;
+		dirty = {std::min(dirty.x0, r.x0), std::min(dirty.y0, r.y0), std::max(dirty.x1, r.x1), std::max(dirty.y1, r.y1)};
+		++n_changed;
+	}
+	if ((dirty.x0 >= dirty.x1) || (dirty.y0 >= dirty.y1)) return false;
+
+	region = dirty;
+	for (uint32_t i = 0; i < n_boxes; ++i) {
+		const rect &r = box_rects[i];
+		in_region[i] = (r.x0 < dirty.x1) && (dirty.x0 < r.x1) && (r.y0 < dirty.y1) && (dirty.y0 < r.y1);
+		n_redrawn += in_region[i];
+	}
+	return true;
+}
+
+/**
+ * @param rectangle Output dirty region of the last update: x, y, width and height in pixels, relative to the viewport
+ */
+void cgvDirtyRegion::get_region(GLint rectangle[4]) const {
+	rectangle[0] = region.x0;
+	rectangle[1] = region.y0;
+	rectangle[2] = region.x1 - region.x0;
+	rectangle[3] = region.y1 - region.y0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "cgvBox.h"
+
+class cgvScene3D;
+class cgvCamera;
+
+/**
+ * cgvDirtyRegion finds the part of the window that must be redrawn when only the appearance of some boxes changes
+ * (selection or rotation), with the view and the rest of the scene unchanged. It keeps the rectangle of the window
+ * covered by each box (its bounding sphere, so it does not change when the box rotates around its center) and the
+ * state of the boxes when the window was drawn. The dirty region is the bounding rectangle of the boxes that changed,
+ * and the boxes to redraw are the ones that overlap it.
+ */
+class cgvDirtyRegion {
+	/**
+	 * Rectangle of the window, in pixels: [x0, x1) x [y0, y1)
+	 */
+	struct rect {
+		GLint x0, y0, x1, y1;
+	};
+
+	std::vector<rect> box_rects; ///< Rectangle of each box
+	std::vector<uint8_t> drawn_selected; ///< Selection state of each box when it was drawn
+	std::vector<GLfloat> drawn_angles; ///< Rotation of each box when it was drawn
+	std::vector<uint8_t> in_region; ///< Whether each box overlaps the dirty region
+	unsigned long box_changes = 0; ///< Number of changes of the boxes of the scene when they were drawn
+
+	GLint width = 0, height = 0; ///< Size of the viewport
+	rect region = {0, 0, 0, 0}; ///< Dirty region of the last update
+
+	unsigned long n_changed = 0; ///< Boxes that changed in the last update
+	unsigned long n_redrawn = 0; ///< Boxes that overlap the dirty region of the last update
+
+public:
+	cgvDirtyRegion() = default;
+	~cgvDirtyRegion() = default;
+
+	void reset(const cgvScene3D &scene, const cgvCamera &camera);
+	bool update(const cgvScene3D &scene);
+
+	/**
+	 * @param i Index of a box
+	 * @retval true if the box must be redrawn in the dirty region of the last update
+	 */
+	bool is_in_region(uint32_t i) const { return (i < in_region.size()) && in_region[i]; };
+	void get_region(GLint rectangle[4]) const;
+
+	unsigned long get_num_changed() const { return n_changed; };
+	unsigned long get_num_redrawn() const { return n_redrawn; };
+	/**
+	 * @retval Memory of the rectangle of a box and of the state it was drawn with
+	 */
+	static uint32_t get_bytes_per_box() { return (uint32_t) (sizeof(rect) + 2 * sizeof(uint8_t) + sizeof(GLfloat)); };
+	/**
+	 * @retval Pixels of the dirty region of the last update
+	 */
+	unsigned long get_num_pixels() const {
+		return (unsigned long) (region.x1 - region.x0) * (unsigned long) (region.y1 - region.y0);
+	};
+};
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "cgvFileWatcher.h"
+
+/**
+ * Destructor. The file is no longer watched
+ */
+cgvFileWatcher::~cgvFileWatcher() {
+	stop();
+}
+
+/**
+ * Start watching a file
+ * @param _path Path of the file. It does not need to exist yet
+ * @retval true if the file can be watched. Otherwise, the reason is written to stderr
+ * @post changed() is false until the file is written after this call
+ */
+bool cgvFileWatcher::watch(const std::string &_path) {
+	stop();
+	const size_t slash = _path.find_last_of("/\\");
+	name = (slash == std::string::npos) ? _path : _path.substr(slash + 1);
+	if (name.empty()) {
+		fprintf(stderr, "cgvFileWatcher: %s is not a file\n", _path.c_str());
+		return false;
+	}
+	path = _path;
+
+#ifdef __linux__
+	const std::string directory = (slash == std::string::npos) ? "." : ((slash == 0) ? "/" : _path.substr(0, slash));
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if ((fd >= 0) && (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)) {
+		close(fd);
+		fd = -1;
+	}
+	if (fd >= 0) return true;
+	fprintf(stderr, "cgvFileWatcher: unable to watch %s, it is polled\n", directory.c_str());
+#endif
+	changed(); // current state of the file
+	return true;
+}
+
+/**
+ * Stop watching the file
+ */
+void cgvFileWatcher::stop() {
+#ifdef __linux__
+	if (fd >= 0) close(fd);
+#endif
+	fd = -1;
+	path.clear();
+	name.clear();
+	modified = size = -1;
+}
+
+/**
+ * Check whether the file has been written
+ * @retval true if the file has been written (or replaced) since the last check
+ * @post The events of inotify are consumed. Several writes between two checks are reported once
+ */
+bool cgvFileWatcher::changed() {
+	if (path.empty()) return false;
+
+#ifdef __linux__
+	if (fd >= 0) {
+		bool written = false;
+		alignas(struct inotify_event) char events[4096];
+		for (;;) {
+			const ssize_t length = read(fd, events, sizeof(events));
+			if (length <= 0) break;
+			for (ssize_t offset = 0; offset < length;) {
+				const struct inotify_event *event = (const struct inotify_event *) (events + offset);
+				if ((event->len > 0) && (name == event->name)) written = true;
+				offset += sizeof(struct inotify_event) + event->len;
+			}
+		}
+		return written;
+	}
+#endif
+
+	struct stat status;
+	const int64_t _modified = (stat(path.c_str(), &status) == 0) ? (int64_t) status.st_mtime : -1;
+	const int64_t _size = (_modified >= 0) ? (int64_t) status.st_size : -1;
+	const bool written = (_modified >= 0) && ((_modified != modified) || (_size != size));
+	modified = _modified;
+	size = _size;
+	return written;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * cgvFileWatcher tells when a file has been written. On Linux the directory of the file is watched with inotify, so
+ * the file is also detected when it is replaced by a rename (as cgvSnapshot::save does); elsewhere the modification
+ * time and size of the file are compared in every check. Checking never blocks.
+ */
+class cgvFileWatcher {
+private:
+	std::string path; ///< Watched file
+	std::string name; ///< Name of the file, without its directory
+	int fd = -1; ///< inotify instance (-1: the file is polled)
+	int64_t modified = -1; ///< Modification time of the file in the last check (polling)
+	int64_t size = -1; ///< Size of the file in the last check (polling)
+
+public:
+	cgvFileWatcher() = default;
+	~cgvFileWatcher();
+
+	cgvFileWatcher(const cgvFileWatcher&) = delete;
+	cgvFileWatcher& operator=(const cgvFileWatcher&) = delete;
+
+	bool watch(const std::string &_path);
+	void stop();
+	bool changed();
+
+	bool is_watching() const { return !path.empty(); };
+};
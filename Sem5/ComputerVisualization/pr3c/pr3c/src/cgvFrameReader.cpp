@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cgvFrameReader.h"
+
+/**
+ * Destructor. The shared memory is closed
+ */
+cgvFrameReader::~cgvFrameReader() {
+	close();
+}
+
+/**
+ * Open the ring of frames of a cgvFrameSink
+ * @param _name Name of the shared memory (a "/" is added at the beginning if it does not have it)
+ * @retval true if the ring has been opened, false otherwise (the reason is written to stderr)
+ */
+bool cgvFrameReader::open(const std::string &_name) {
+	close();
+#ifdef _WIN32
+	fprintf(stderr, "cgvFrameReader: the frames can not be shared in Windows (%s)\n", _name.c_str());
+	return false;
+#else
+	name = (!_name.empty() && (_name[0] == '/')) ? _name : "/" + _name;
+	const int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+	struct stat status;
+	void *mapping = MAP_FAILED;
+	if ((fd < 0) || (fstat(fd, &status) != 0) || (status.st_size < (off_t) sizeof(cgvFrameRingHeader)) ||
+	    ((mapping = mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+		fprintf(stderr, "cgvFrameReader: unable to open the shared memory %s (%s)\n", name.c_str(),
+		        (fd < 0) ? strerror(errno) : "it is not a ring of frames");
+		if (fd >= 0) ::close(fd);
+		name.clear();
+		return false;
+	}
+	::close(fd);
+	memory = (const uint8_t *) mapping;
+	size = (size_t) status.st_size;
+
+	const cgvFrameRingHeader *ring = (const cgvFrameRingHeader *) memory;
+	const bool valid = (memcmp(ring->magic, "CGVFRAME", sizeof(ring->magic)) == 0);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!valid || (ring->version != cgvFrameSink::VERSION) || (ring->n_slots == 0) ||
+	    (ring->stride < ring->width * 4) ||
+	    (ring->slot_size < sizeof(cgvFrameSlot) + (uint64_t) ring->stride * ring->height) ||
+	    (ring->slot_offset + ring->n_slots * ring->slot_size > size)) {
+		fprintf(stderr, "cgvFrameReader: %s is not a ring of frames of version %u\n", name.c_str(),
+		        cgvFrameSink::VERSION);
+		close();
+		return false;
+	}
+	header = ring;
+	return true;
+#endif
+}
+
+/**
+ * Close the ring
+ */
+void cgvFrameReader::close() {
+#ifndef _WIN32
+	if (memory) munmap((void *) memory, size);
+#endif
+	memory = nullptr;
+	header = nullptr;
+	size = 0;
+	name.clear();
+}
+
+/**
+ * Acquire the last frame published
+ * @param view The frame
+ * @retval true if a frame has been acquired; false if no frame has been published yet, or if the writer kept
+ * overwriting the last one during MAX_ATTEMPTS attempts
+ * @post The pixels are read in place: validate tells whether they were overwritten while they were being read
+ */
+bool cgvFrameReader::acquire(cgvFrameView &view) const {
+	if (!header) return false;
+	for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+		const uint64_t published = header->published.load(std::memory_order_acquire);
+		if (published == 0) return false;
+
+		const cgvFrameSlot *slot = (const cgvFrameSlot *) (memory + header->slot_offset +
+		                                                   ((published - 1) % header->n_slots) * header->slot_size);
+		view.sequence = slot->sequence.load(std::memory_order_acquire);
+		if (view.sequence & 1) continue;
+		view.slot = slot;
+		view.pixels = (const uint8_t *) slot + sizeof(cgvFrameSlot);
+		view.width = (slot->width < header->width) ? slot->width : header->width;
+		view.height = (slot->height < header->height) ? slot->height : header->height;
+		view.stride = header->stride;
+		view.frame = slot->frame;
+		view.time = slot->time;
+		if (validate(view)) return true;
+	}
+	return false;
+}
+
+/**
+ * @param view Frame acquired
+ * @retval true if the frame has not been overwritten since it was acquired, so everything read from it is valid
+ */
+bool cgvFrameReader::validate(const cgvFrameView &view) const {
+	if (!view.slot) return false;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return view.slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+/**
+ * Copy the last frame published
+ * @param view The frame (its pixels are the ones of the ring, not the copy)
+ * @param pixels Copy of the pixels of the frame, height rows of stride bytes
+ * @retval true if a frame has been copied without being overwritten
+ */
+bool cgvFrameReader::read(cgvFrameView &view, std::vector<uint8_t> &pixels) const {
+	for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+		if (!acquire(view)) return false;
+		pixels.assign(view.pixels, view.pixels + (size_t) view.stride * view.height);
+		if (validate(view)) return true;
+	}
+	return false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cgvFrameSink.h"
+
+/**
+ * Frame of a ring, read in place
+ */
+struct cgvFrameView {
+	const uint8_t *pixels = nullptr; ///< First row of the frame (RGBA, rows from bottom to top)
+	uint32_t width = 0; ///< Width of the frame
+	uint32_t height = 0; ///< Height of the frame
+	uint32_t stride = 0; ///< Bytes from a row to the next one
+	uint64_t frame = 0; ///< Number of the frame in the ring
+	uint64_t time = 0; ///< Time when the frame was rendered (nanoseconds of the steady clock of the writer)
+	const cgvFrameSlot *slot = nullptr; ///< Slot of the frame
+	uint32_t sequence = 0; ///< Sequence of the slot when the frame was acquired
+};
+
+/**
+ * cgvFrameReader opens the ring of frames of a cgvFrameSink, possibly of another process, and reads its frames in
+ * place. The writer does not wait for the reader, so a frame acquired is only valid if it has not been overwritten
+ * when the reader has finished with it (validate).
+ */
+class cgvFrameReader {
+public:
+	static const int MAX_ATTEMPTS = 8; ///< Times that a frame being overwritten is acquired again
+
+private:
+	std::string name; ///< Name of the shared memory
+	const uint8_t *memory = nullptr; ///< Mapping of the shared memory
+	size_t size = 0; ///< Size of the shared memory
+	const cgvFrameRingHeader *header = nullptr; ///< Header of the ring
+
+public:
+	cgvFrameReader() = default;
+	~cgvFrameReader();
+
+	cgvFrameReader(const cgvFrameReader&) = delete;
+	cgvFrameReader& operator=(const cgvFrameReader&) = delete;
+
+	bool open(const std::string &_name);
+	void close();
+
+	bool acquire(cgvFrameView &view) const;
+	bool validate(const cgvFrameView &view) const;
+	bool read(cgvFrameView &view, std::vector<uint8_t> &pixels) const;
+
+	bool is_open() const { return header != nullptr; };
+	uint64_t get_num_published() const { return header ? header->published.load(std::memory_order_acquire) : 0; };
+	uint32_t get_width() const { return header ? header->width : 0; };
+	uint32_t get_height() const { return header ? header->height : 0; };
+};
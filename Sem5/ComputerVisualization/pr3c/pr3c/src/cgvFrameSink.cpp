@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "cgvFrameSink.h"
+
+/**
+ * Destructor. The shared memory is released
+ * @pre The context where create() was called must be current
+ */
+cgvFrameSink::~cgvFrameSink() {
+	destroy();
+}
+
+/**
+ * Create the ring of frames in shared memory and the pixel buffers where the frames are read back
+ * @param _name Name of the shared memory (a "/" is added at the beginning if it does not have it)
+ * @param width Maximum width of the frames
+ * @param height Maximum height of the frames
+ * @param n_slots Number of frames kept in the ring
+ * @retval true if the ring has been created, false otherwise (the reason is written to stderr)
+ * @pre An OpenGL context is current
+ * @post A shared memory with the same name of a previous execution is replaced: the readers that still have it open
+ * keep the old one
+ */
+bool cgvFrameSink::create(const std::string &_name, uint32_t width, uint32_t height, uint32_t n_slots) {
+	destroy();
+#ifdef _WIN32
+	fprintf(stderr, "cgvFrameSink: the frames can not be shared in Windows (%s)\n", _name.c_str());
+	return false;
+#else
+	if (_name.empty() || (_name.find('/', 1) != std::string::npos) || (width == 0) || (height == 0) ||
+	    (n_slots == 0)) {
+		fprintf(stderr, "cgvFrameSink: non-valid ring of frames %s (%u x %u, %u slots)\n", _name.c_str(), width,
+		        height, n_slots);
+		return false;
+	}
+	name = (_name[0] == '/') ? _name : "/" + _name;
+
+	const size_t page = 4096;
+	const size_t stride = (size_t) width * 4;
+	const size_t slot_size = (sizeof(cgvFrameSlot) + stride * height + page - 1) / page * page;
+	const size_t slot_offset = (sizeof(cgvFrameRingHeader) + page - 1) / page * page;
+	size = slot_offset + n_slots * slot_size;
+
+	shm_unlink(name.c_str());
+	const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if ((fd < 0) || (ftruncate(fd, (off_t) size) != 0) ||
+	    ((memory = (uint8_t *) mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+		fprintf(stderr, "cgvFrameSink: unable to create the shared memory %s of %lu bytes (%s)\n", name.c_str(),
+		        (unsigned long) size, strerror(errno));
+		memory = nullptr;
+		if (fd >= 0) close(fd);
+		destroy();
+		return false;
+	}
+	close(fd);
+
+	// the memory is filled with zeros: the readers take the ring as valid once the magic is written
+	header = (cgvFrameRingHeader *) memory;
+	header->version = VERSION;
+	header->n_slots = n_slots;
+	header->width = width;
+	header->height = height;
+	header->stride = (uint32_t) stride;
+	header->slot_offset = slot_offset;
+	header->slot_size = slot_size;
+	header->published.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(header->magic, "CGVFRAME", sizeof(header->magic));
+
+	readback.create(width, height);
+	return true;
+#endif
+}
+
+/**
+ * Release the ring and the pixel buffers. The frames in flight are not published
+ * @post The name of the shared memory is removed; the readers that have it open can still read the last frames
+ */
+void cgvFrameSink::destroy() {
+	readback.destroy();
+	writing = nullptr;
+
+#ifndef _WIN32
+	if (memory) munmap(memory, size);
+	if (!name.empty()) shm_unlink(name.c_str());
+#endif
+	memory = nullptr;
+	header = nullptr;
+	size = 0;
+	name.clear();
+	n_captured = n_published = n_dropped = 0;
+}
+
+/**
+ * Read back the frame that has just been rendered, and publish the frames read back before that are ready
+ * @param width Width of the frame (it is cropped to the width of the ring)
+ * @param height Height of the frame (it is cropped to the height of the ring)
+ * @pre The frame is in the current read buffer (e.g. the back buffer, before swapping the buffers)
+ * @post With pixel buffers, the frame is published in a later call (or in finish), or dropped if all the buffers are
+ * in flight; otherwise it is published now
+ */
+void cgvFrameSink::capture(int width, int height) {
+	if (!header || (width <= 0) || (height <= 0)) return;
+	const uint32_t w = ((uint32_t) width < header->width) ? (uint32_t) width : header->width;
+	const uint32_t h = ((uint32_t) height < header->height) ? (uint32_t) height : header->height;
+	const uint64_t time = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	if (!readback.is_valid()) {
+		// the rows of the frame have the stride of the ring (the rows of RGBA pixels are always aligned)
+		glPixelStorei(GL_PACK_ROW_LENGTH, (GLint) header->width);
+		glReadPixels(0, 0, (GLsizei) w, (GLsizei) h, GL_RGBA, GL_UNSIGNED_BYTE, begin_slot(w, h, time));
+		glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+		end_slot();
+		++n_captured;
+		return;
+	}
+
+	publish_read(false);
+	if (readback.is_full()) {
+		++n_dropped; // the consumer of the frames must not slow down the render loop
+	} else {
+		readback.read(w, h, time);
+		++n_captured;
+	}
+}
+
+/**
+ * Publish the frames in flight that have already been read back, without waiting for the rest. It lets the frames
+ * be published while no other frame is rendered
+ * @retval true if some frames are still being read back
+ * @pre The context where create() was called is current
+ */
+bool cgvFrameSink::publish_ready() {
+	if (!has_frames_in_flight()) return false;
+	publish_read(false);
+	return !readback.is_empty();
+}
+
+/**
+ * Publish all the frames in flight, waiting for them to be read back
+ * @pre The context where create() was called is current
+ */
+void cgvFrameSink::finish() {
+	if (header) publish_read(true);
+}
+
+/**
+ * Copy the frames read back to the ring, from the oldest one
+ * @param wait true to wait for all the frames in flight, false to stop at the first one that has not been read back yet
+ */
+void cgvFrameSink::publish_read(bool wait) {
+	uint32_t width, height;
+	uint64_t time;
+	while (const uint8_t *pixels = readback.map_oldest(wait, width, height, time)) {
+		memcpy(begin_slot(width, height, time), pixels, readback.get_stride() * height);
+		end_slot();
+		readback.unmap_oldest();
+	}
+}
+
+/**
+ * Start writing the next slot of the ring
+ * @param width Width of the frame
+ * @param height Height of the frame
+ * @param time Time when the frame was rendered
+ * @retval Where the pixels of the frame must be written
+ * @post The sequence of the slot is odd until end_slot is called
+ */
+uint8_t *cgvFrameSink::begin_slot(uint32_t width, uint32_t height, uint64_t time) {
+	const uint64_t frame = header->published.load(std::memory_order_relaxed);
+	writing = (cgvFrameSlot *) (memory + header->slot_offset + (frame % header->n_slots) * header->slot_size);
+	writing->sequence.store(writing->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	writing->width = width;
+	writing->height = height;
+	writing->frame = frame;
+	writing->time = time;
+	return (uint8_t *) writing + sizeof(cgvFrameSlot);
+}
+
+/**
+ * Finish writing the slot of begin_slot, and publish its frame
+ */
+void cgvFrameSink::end_slot() {
+	writing->sequence.store(writing->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	header->published.store(writing->frame + 1, std::memory_order_release);
+	writing = nullptr;
+	++n_published;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include "cgvPixelReadback.h"
+
+/**
+ * Header of the shared memory of a ring of frames. It is followed by n_slots slots, slot_size bytes each from
+ * slot_offset: a cgvFrameSlot and then the pixels of the frame
+ */
+struct cgvFrameRingHeader {
+	char magic[8]; ///< "CGVFRAME"
+	uint32_t version; ///< Version of the layout (cgvFrameSink::VERSION)
+	uint32_t n_slots; ///< Number of frames kept in the ring
+	uint32_t width; ///< Maximum width of a frame
+	uint32_t height; ///< Maximum height of a frame
+	uint32_t stride; ///< Bytes of a row of pixels (RGBA, 8 bits per channel, rows from bottom to top)
+	uint32_t reserved; ///< Always 0
+	uint64_t slot_offset; ///< Offset of the first slot from the beginning of the shared memory
+	uint64_t slot_size; ///< Bytes from a slot to the next one
+	std::atomic<uint64_t> published; ///< Number of frames published; the last one is in slot (published - 1) % n_slots
+};
+
+/**
+ * Header of a slot of the ring. sequence is a sequence lock: it is odd while the writer changes the slot, so a reader
+ * takes a frame as valid when sequence is even and has the same value before and after reading it
+ */
+struct cgvFrameSlot {
+	std::atomic<uint32_t> sequence; ///< Number of times that the slot has started and finished being written
+	uint32_t width; ///< Width of the frame
+	uint32_t height; ///< Height of the frame
+	uint32_t reserved; ///< Always 0
+	uint64_t frame; ///< Number of the frame in the ring (published - 1 when it was published)
+	uint64_t time; ///< Time when the frame was rendered (nanoseconds of the steady clock of the writer)
+	uint8_t padding[32]; ///< The pixels start 64 bytes after the header of the slot
+};
+
+static_assert(sizeof(cgvFrameSlot) == 64, "the pixels of a slot are aligned to 64 bytes");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring of frames is shared with other processes");
+
+/**
+ * cgvFrameSink publishes the rendered frames in a ring of framebuffers in POSIX shared memory, so that other local
+ * processes (encoders, comparators) read them in place (see cgvFrameReader), without sockets nor copies of their own.
+ * The writer never waits for the readers: a slot is overwritten n_slots frames later, and the sequence lock of each
+ * slot tells a reader whether the frame changed while it was read.
+ *
+ * The frames are read back through pixel buffer objects (cgvPixelReadback), and each one is copied to the ring in a
+ * later frame, once it has been read, so reading a frame back does not stall the render loop. When all the pixel
+ * buffers are still being filled, the frame is dropped. Without pixel buffer objects the frame is read directly into
+ * the ring.
+ */
+class cgvFrameSink {
+public:
+	static const uint32_t VERSION = 1; ///< Version of the layout of the shared memory
+	static const uint32_t DEFAULT_SLOTS = 3; ///< Default number of slots of the ring
+
+private:
+	std::string name; ///< Name of the shared memory ("/name")
+	uint8_t *memory = nullptr; ///< Mapping of the shared memory
+	size_t size = 0; ///< Size of the shared memory
+	cgvFrameRingHeader *header = nullptr; ///< Header of the ring, at the beginning of memory
+
+	cgvPixelReadback readback; ///< Pixel buffers where the frames are read back (not valid: they are read into the ring)
+	cgvFrameSlot *writing = nullptr; ///< Slot being written
+
+	unsigned long n_captured = 0; ///< Frames read back
+	unsigned long n_published = 0; ///< Frames copied to the ring
+	unsigned long n_dropped = 0; ///< Frames not read back because all the buffers were in flight
+
+public:
+	cgvFrameSink() = default;
+	~cgvFrameSink();
+
+	cgvFrameSink(const cgvFrameSink&) = delete;
+	cgvFrameSink& operator=(const cgvFrameSink&) = delete;
+
+	bool create(const std::string &_name, uint32_t width, uint32_t height, uint32_t n_slots = DEFAULT_SLOTS);
+	void destroy();
+
+	void capture(int width, int height);
+	bool publish_ready();
+	void finish();
+
+	bool is_open() const { return header != nullptr; };
+	const std::string &get_name() const { return name; };
+	uint32_t get_num_slots() const { return header ? header->n_slots : 0; };
+	bool uses_pixel_buffers() const { return readback.is_valid(); };
+	/**
+	 * @retval true if some frames captured have not been published yet (publish_ready, finish)
+	 */
+	bool has_frames_in_flight() const { return header && readback.is_valid() && !readback.is_empty(); };
+	unsigned long get_num_captured() const { return n_captured; };
+	unsigned long get_num_published() const { return n_published; };
+	unsigned long get_num_dropped() const { return n_dropped; };
+
+private:
+	void publish_read(bool wait);
+	uint8_t *begin_slot(uint32_t width, uint32_t height, uint64_t time);
+	void end_slot();
+};
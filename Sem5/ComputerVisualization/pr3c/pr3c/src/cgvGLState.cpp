@@ -0,0 +1,214 @@
+#include <string.h>
+
+#include "cgvGLState.h"
+
+
+/**
+ * Set the emission of the material (glMaterialfv(face, GL_EMISSION, ...))
+ * @param face GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
+ * @param _emission RGBA emission
+ * @post The call is issued only if the emission of the faces is different or unknown
+ */
+void cgvGLState::material_emission(GLenum face, const GLfloat _emission[4]) {
+    bool changed = false;
+    for (int f = 0; f < 2; ++f) {
+        if ((face != GL_FRONT_AND_BACK) && (face != (f == 0 ? GL_FRONT : GL_BACK))) continue;
+
+        if (!emission_known[f] || (emission[f][0] != _emission[0]) || (emission[f][1] != _emission[1]) ||
+            (emission[f][2] != _emission[2]) || (emission[f][3] != _emission[3])) {
+            changed = true;
+            for (int i = 0; i < 4; ++i) emission[f][i] = _emission[i];
+            emission_known[f] = true;
+        }
+    }
+
+    count(CGV_STATE_MATERIAL, changed);
+    if (changed) glMaterialfv(face, GL_EMISSION, _emission);
+}
+
+/**
+ * Set the current color (glColor4f)
+ * @post The call is issued only if the current color is different or unknown
+ */
+void cgvGLState::color4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+    bool changed = !color_known || (color[0] != r) || (color[1] != g) || (color[2] != b) || (color[3] != a);
+
+    count(CGV_STATE_COLOR, changed);
+    if (changed) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+        color[3] = a;
+        color_known = true;
+        glColor4f(r, g, b, a);
+    }
+}
+
+/**
+ * Set the current color (glColor3ubv)
+ * @param c RGB color, [0, 255] per component
+ * @post The call is issued only if the current color is different or unknown
+ */
+void cgvGLState::color3ubv(const GLubyte c[3]) {
+    GLfloat r = c[0] / 255.0f, g = c[1] / 255.0f, b = c[2] / 255.0f;
+    bool changed = !color_known || (color[0] != r) || (color[1] != g) || (color[2] != b) || (color[3] != 1.0f);
+
+    count(CGV_STATE_COLOR, changed);
+    if (changed) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+        color[3] = 1.0f;
+        color_known = true;
+        glColor3ubv(c);
+    }
+}
+
+/**
+ * Enable or disable an OpenGL capability (glEnable/glDisable)
+ * @param cap The capability, e.g. GL_LIGHTING
+ * @param enabled true to enable it, false to disable it
+ * @post The call is issued only if the state of the capability is different or unknown
+ */
+void cgvGLState::set_enabled(GLenum cap, bool enabled) {
+    int i = 0;
+    while ((i < n_caps) && (caps[i] != cap)) ++i;
+
+    bool changed = (i == n_caps) || (caps_enabled[i] != enabled);
+    if ((i == n_caps) && (n_caps < MAX_CAPS)) {
+        caps[n_caps++] = cap;
+    }
+    if (i < n_caps) {
+        caps_enabled[i] = enabled;
+    }
+
+    count(CGV_STATE_ENABLE, changed);
+    if (changed) {
+        if (enabled) glEnable(cap);
+        else glDisable(cap);
+    }
+}
+
+/**
+ * Set the position of a light (glLightfv(light, GL_POSITION, ...)). OpenGL transforms the position with the current
+ * modelview matrix, so the call can only be skipped if the view has not changed.
+ * @param light GL_LIGHT0 ... GL_LIGHT7
+ * @param position Homogeneous position of the light
+ * @param view_revision Revision of the camera whose view matrix is the current modelview matrix (0 if unknown)
+ * @post The call is issued only if the position or the view are different or unknown
+ */
+void cgvGLState::light_position(GLenum light, const GLfloat position[4], unsigned long view_revision) {
+    int l = light - GL_LIGHT0;
+    bool changed = true;
+    if ((l >= 0) && (l < MAX_LIGHTS)) {
+        changed = (view_revision == 0) || (light_view[l] != view_revision) ||
+                  (light_pos[l][0] != position[0]) || (light_pos[l][1] != position[1]) ||
+                  (light_pos[l][2] != position[2]) || (light_pos[l][3] != position[3]);
+        for (int i = 0; i < 4; ++i) light_pos[l][i] = position[i];
+        light_view[l] = view_revision;
+    }
+
+    count(CGV_STATE_LIGHT, changed);
+    if (changed) glLightfv(light, GL_POSITION, position);
+}
+
+/**
+ * Enable the vertex and normal arrays with the given data (3 GLfloat per element, tightly packed)
+ * @param vertices Array of vertices
+ * @param normals Array of normals, or nullptr to disable the normal array
+ * @post Only the calls that change the state of the client arrays are issued
+ */
+void cgvGLState::vertex_arrays(const GLvoid *vertices, const GLvoid *normals) {
+    bool issue = !arrays_known || !vertex_array;
+    count(CGV_STATE_CLIENT_ARRAY, issue);
+    if (issue) glEnableClientState(GL_VERTEX_ARRAY);
+
+    issue = !arrays_known || (normal_array != (normals != nullptr));
+    count(CGV_STATE_CLIENT_ARRAY, issue);
+    if (issue) {
+        if (normals) glEnableClientState(GL_NORMAL_ARRAY);
+        else glDisableClientState(GL_NORMAL_ARRAY);
+    }
+
+    issue = !arrays_known || (vertex_data != vertices);
+    count(CGV_STATE_CLIENT_ARRAY, issue);
+    if (issue) glVertexPointer(3, GL_FLOAT, 0, vertices);
+
+    if (normals) {
+        issue = !arrays_known || (normal_data != normals);
+        count(CGV_STATE_CLIENT_ARRAY, issue);
+        if (issue) glNormalPointer(GL_FLOAT, 0, normals);
+    }
+
+    vertex_array = true;
+    normal_array = (normals != nullptr);
+    vertex_data = vertices;
+    normal_data = normals;
+    arrays_known = true;
+}
+
+/**
+ * Forget the shadowed state. It must be called when the OpenGL state has been changed without this object
+ * @post The next call of every kind is issued to OpenGL. The counters are not modified
+ */
+void cgvGLState::invalidate() {
+    emission_known[0] = emission_known[1] = false;
+    color_known = false;
+    n_caps = 0;
+    for (unsigned long &v: light_view) v = 0;
+    arrays_known = false;
+}
+
+/**
+ * @return The number of calls issued to OpenGL since the last reset of the counters
+ */
+unsigned long cgvGLState::get_total_issued() const {
+    unsigned long total = 0;
+    for (unsigned long v: issued) total += v;
+    return total;
+}
+
+/**
+ * @return The number of redundant calls dropped since the last reset of the counters
+ */
+unsigned long cgvGLState::get_total_skipped() const {
+    unsigned long total = 0;
+    for (unsigned long v: skipped) total += v;
+    return total;
+}
+
+/**
+ * Set the counters to 0
+ */
+void cgvGLState::reset_counters() {
+    for (int g = 0; g < CGV_STATE_NUM_GROUPS; ++g) {
+        issued[g] = skipped[g] = 0;
+    }
+}
+
+/**
+ * Check whether the current context has a feature of OpenGL
+ * @param major Major version of OpenGL that includes the feature (0: only the extension is checked)
+ * @param minor Minor version of OpenGL that includes the feature
+ * @param extension Name of the extension that provides the feature in previous versions
+ * @retval true if the version of the context is major.minor or later, or it exposes the extension
+ * @pre An OpenGL 3.0 (or later) context is current
+ */
+bool cgvGLState::supports(int major, int minor, const char *extension) {
+#ifdef CGV_HAVE_CORE_PROFILE
+    GLint context_major = 0, context_minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &context_major);
+    glGetIntegerv(GL_MINOR_VERSION, &context_minor);
+    if ((major > 0) && ((context_major > major) || ((context_major == major) && (context_minor >= minor)))) {
+        return true;
+    }
+
+    GLint n_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n_extensions);
+    for (GLint i = 0; i < n_extensions; ++i) {
+        const char *name = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (name && !strcmp(name, extension)) return true;
+    }
+#endif
+    return false;
+}
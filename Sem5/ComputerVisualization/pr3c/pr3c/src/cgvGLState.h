@@ -0,0 +1,82 @@
+#pragma once
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+/**
+ * Groups of OpenGL calls counted by cgvGLState
+ */
+typedef enum {
+    CGV_STATE_MATERIAL, ///< glMaterialfv
+    CGV_STATE_COLOR, ///< glColor*
+    CGV_STATE_ENABLE, ///< glEnable / glDisable
+    CGV_STATE_LIGHT, ///< glLightfv
+    CGV_STATE_CLIENT_ARRAY, ///< glEnableClientState / glDisableClientState / gl*Pointer
+    CGV_STATE_NUM_GROUPS
+} stateGroup;
+
+/**
+ * cgvGLState shadows the part of the OpenGL state changed by the scene (emission material, current color,
+ * enabled capabilities, position of the lights and vertex arrays) and drops the calls that would not change it.
+ * Every change of that state must go through the same instance, otherwise invalidate() must be called.
+ * It counts the calls that are issued to OpenGL and the ones that are skipped.
+ */
+class cgvGLState {
+    static const int MAX_CAPS = 16; ///< Number of capabilities (glEnable) that can be shadowed
+    static const int MAX_LIGHTS = 8; ///< Number of lights that can be shadowed
+
+    GLfloat emission[2][4]; ///< Emission of the material of the front [0] and back [1] faces
+    bool emission_known[2] = {false, false}; ///< The emission of the faces is known
+
+    GLfloat color[4]; ///< Current color
+    bool color_known = false; ///< The current color is known
+
+    GLenum caps[MAX_CAPS]; ///< Shadowed capabilities
+    bool caps_enabled[MAX_CAPS]; ///< State of the shadowed capabilities
+    int n_caps = 0; ///< Number of shadowed capabilities
+
+    GLfloat light_pos[MAX_LIGHTS][4]; ///< Position of the lights
+    unsigned long light_view[MAX_LIGHTS] = {0}; ///< Revision of the view when the light was positioned (0: unknown)
+
+    bool vertex_array = false, normal_array = false; ///< Client arrays enabled
+    bool arrays_known = false; ///< The state of the client arrays is known
+    const GLvoid *vertex_data = nullptr, *normal_data = nullptr; ///< Current pointers of the client arrays
+
+    unsigned long issued[CGV_STATE_NUM_GROUPS] = {0}; ///< Number of calls issued to OpenGL
+    unsigned long skipped[CGV_STATE_NUM_GROUPS] = {0}; ///< Number of redundant calls that have been dropped
+
+public:
+    cgvGLState() = default;
+    ~cgvGLState() = default;
+
+    void material_emission(GLenum face, const GLfloat _emission[4]);
+    void color3f(GLfloat r, GLfloat g, GLfloat b) { color4f(r, g, b, 1.0f); };
+    void color4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+    void color3ubv(const GLubyte c[3]);
+
+    void enable(GLenum cap) { set_enabled(cap, true); };
+    void disable(GLenum cap) { set_enabled(cap, false); };
+    void set_enabled(GLenum cap, bool enabled);
+
+    void light_position(GLenum light, const GLfloat position[4], unsigned long view_revision);
+
+    void vertex_arrays(const GLvoid *vertices, const GLvoid *normals);
+
+    void invalidate();
+
+    // counters
+    unsigned long get_issued(stateGroup group) const { return issued[group]; };
+    unsigned long get_skipped(stateGroup group) const { return skipped[group]; };
+    unsigned long get_total_issued() const;
+    unsigned long get_total_skipped() const;
+    void reset_counters();
+
+    static bool supports(int major, int minor, const char *extension);
+
+private:
+    void count(stateGroup group, bool issue) { ++(issue ? issued : skipped)[group]; };
+};
@@ -0,0 +1,209 @@
+#include <cstdlib>
+#include <stdio.h>
+
+#include "cgvGlutAdapter.h"
+
+#if !defined(__APPLE__) || !defined(__MACH__)
+#include <GL/freeglut_ext.h>
+#endif
+
+std::map<int, cgvInterface *> cgvGlutAdapter::windows;
+std::set<int> cgvGlutAdapter::polled;
+
+/**
+ * Create the display window of an instance, and the world that it renders
+ * @param ui Instance shown in the window
+ * @param argc Parameter from the main function of the program to know the number of input parameters from the command line
+ * @param argv Parámeter from the command line to run the whole program
+ * @param _width_window Initial width of the window
+ * @param _height_window Initial height of the window
+ * @param _pos_X Initial position of the window (X coordinate)
+ * @param _pos_Y Initial position of the window (Y coordinate)
+ * @param _title Title of the window
+ * @retval false if the world cannot be created (cgvInterface::create_world)
+ * @pre It is assumed that the parameters have valid values
+ * @post The window is the current one. If the core profile renderer cannot be used, the window is created again
+ * with the fixed-function pipeline
+ */
+bool cgvGlutAdapter::configure_environment(cgvInterface &ui, int argc, char **argv, int _width_window,
+                                           int _height_window, int _pos_X, int _pos_Y, const std::string &_title) {
+	// initialization of the interface variables
+	ui.set_width_window(_width_window);
+	ui.set_height_window(_height_window);
+	ui.set_title(_title);
+
+	// initialization of the display window
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+	glutInitWindowSize(_width_window, _height_window);
+	glutInitWindowPosition(_pos_X, _pos_Y);
+
+	if (ui.get_backend() == CGV_RENDERER_CORE_PROFILE) {
+#if !defined(__APPLE__) || !defined(__MACH__)
+		glutInitContextVersion(3, 3);
+		glutInitContextProfile(GLUT_CORE_PROFILE);
+		int window = glutCreateWindow(_title.c_str());
+		if (!ui.init_renderer()) {
+			fprintf(stderr, "The core profile renderer is not available, the fixed-function pipeline is used\n");
+			glutDestroyWindow(window);
+			glutInitContextVersion(1, 0);
+			glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+			ui.set_backend(CGV_RENDERER_FIXED_FUNCTION);
+		}
+#else
+		fprintf(stderr, "The core profile renderer is not available, the fixed-function pipeline is used\n");
+		ui.set_backend(CGV_RENDERER_FIXED_FUNCTION);
+#endif
+	}
+	if (ui.get_backend() == CGV_RENDERER_FIXED_FUNCTION) {
+		glutCreateWindow(_title.c_str());
+	}
+
+	ui.init_gl_state();
+
+	// the frames published in shared memory are not cropped when the window grows
+	ui.set_max_window_size(glutGet(GLUT_SCREEN_WIDTH), glutGet(GLUT_SCREEN_HEIGHT));
+	return ui.create_world(); // create the world (scene) to be rendered in the window
+}
+
+/**
+ * Forward the events of the current window to an instance
+ * @param ui Instance shown in the current window (configure_environment)
+ * @post The snapshot is loaded while no event is pending, and the changes are polled while the instance needs it
+ */
+void cgvGlutAdapter::init_callbacks(cgvInterface &ui) {
+	const int window = glutGetWindow();
+	windows[window] = &ui;
+
+	glutKeyboardFunc(set_glutKeyboardFunc);
+	glutReshapeFunc(set_glutReshapeFunc);
+	glutDisplayFunc(set_glutDisplayFunc);
+
+	glutMouseFunc(set_glutMouseFunc);
+	glutMotionFunc(set_glutMotionFunc);
+
+	if (ui.is_loading()) glutIdleFunc(set_glutIdleFunc);
+	schedule_poll(window, ui);
+}
+
+/**
+ * Infinite loop to render the scene and wait for new events in the interface
+ */
+void cgvGlutAdapter::init_rendering_loop() {
+	glutMainLoop(); // initialize the visualization loop of OpenGL
+}
+
+/**
+ * @retval Instance shown in the current window, nullptr if it has none
+ */
+cgvInterface *cgvGlutAdapter::current() {
+	auto w = windows.find(glutGetWindow());
+	return (w != windows.end()) ? w->second : nullptr;
+}
+
+/**
+ * Arm the timer of a window, if its instance has to poll changes and the timer is not armed yet
+ * @param window Identifier of the window
+ * @param ui Instance shown in the window
+ */
+void cgvGlutAdapter::schedule_poll(int window, const cgvInterface &ui) {
+	const int interval = ui.get_poll_interval();
+	if ((interval <= 0) || !polled.insert(window).second) return;
+	glutTimerFunc(interval, set_glutTimerFunc, window);
+}
+
+/**
+ * Method to control the keyboard events
+ * @param key Pressed key code
+ * @param x Mouse position (x coordinate) when the key was pressed
+ * @param y Mouse position (y coordinate) when the key was pressed
+ */
+void cgvGlutAdapter::set_glutKeyboardFunc(unsigned char key, int x, int y) {
+	if (key == 27) exit(1); // Escape key to exit
+	cgvInterface *ui = current();
+	if (!ui) return;
+
+	ui->key_pressed(key);
+	glutPostRedisplay(); // renew the content of the window
+}
+
+/**
+ * Method that is called when the window changes its size
+ * @param w Width of the window
+ * @param h Height of the window
+ */
+void cgvGlutAdapter::set_glutReshapeFunc(int w, int h) {
+	cgvInterface *ui = current();
+	if (ui) ui->resize(w, h);
+}
+
+/**
+ * Method to render the scene
+ */
+void cgvGlutAdapter::set_glutDisplayFunc() {
+	cgvInterface *ui = current();
+	if (!ui) return;
+
+	// refresh the window
+	if (ui->render_frame()) glutSwapBuffers(); // it is used instead of glFlush(), to avoid flickering
+	if (ui->needs_another_frame()) glutPostRedisplay();
+	// the frame read back is published by the timer if no other frame is rendered
+	schedule_poll(glutGetWindow(), *ui);
+}
+
+/**
+ * Method that is called while no event is pending and a snapshot is being loaded. It adds the loaded boxes to the
+ * scenes, and shows the progress in the titles of the windows
+ * @post When all the snapshots have been loaded, the callback is removed
+ */
+void cgvGlutAdapter::set_glutIdleFunc() {
+	bool loading = false;
+	for (auto &w : windows) {
+		if (!w.second->is_loading()) continue;
+		glutSetWindow(w.first);
+		if (w.second->update_loading()) {
+			glutSetWindowTitle(w.second->get_window_title().c_str());
+			glutPostRedisplay();
+		}
+		loading = loading || w.second->is_loading();
+	}
+	if (!loading) glutIdleFunc(nullptr);
+}
+
+/**
+ * Method that is called periodically while the instance of a window polls changes (cgvInterface::poll_changes)
+ * @param window Identifier of the window
+ * @post The timer is armed again while the instance has to poll changes. Otherwise, it is armed again by the next
+ * frame that needs it (set_glutDisplayFunc)
+ */
+void cgvGlutAdapter::set_glutTimerFunc(int window) {
+	polled.erase(window);
+	auto w = windows.find(window);
+	if (w == windows.end()) return;
+
+	glutSetWindow(window);
+	if (w->second->poll_changes()) glutPostRedisplay();
+	schedule_poll(window, *w->second);
+}
+
+/**
+ * Mouse buttom detection function
+ * @param button The button parameter is one of GLUT_LEFT_BUTTON, GLUT_MIDDLE_BUTTON, or GLUT_RIGHT_BUTTON.
+ * @param state The state parameter is either GLUT_UP or GLUT_DOWN
+ * @param x X position of the mouse at the time the buttom is pressed or released
+ * @param y Y position of the mouse at the time the buttom is pressed or released
+ */
+void cgvGlutAdapter::set_glutMouseFunc(GLint button, GLint state, GLint x, GLint y) {
+	cgvInterface *ui = current();
+	if (ui && ui->mouse_button(button, state, x, y)) glutPostRedisplay(); // Trigger a redraw
+}
+
+/**
+ * Mouse buttom movement detection method
+ * @param x X position of the mouse
+ * @param y Y position of the mouse
+ */
+void cgvGlutAdapter::set_glutMotionFunc(GLint x, GLint y) {
+	cgvInterface *ui = current();
+	if (ui && ui->mouse_motion(x, y)) glutPostRedisplay();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "cgvInterface.h"
+
+/**
+ * cgvGlutAdapter shows the scenes of cgvInterface instances in GLUT windows: it creates the window of an instance
+ * and forwards to it the events of that window. GLUT only has a callback per event for the whole process, so the
+ * callbacks find the instance of the window that received the event. All its methods must be called from the thread
+ * of the GLUT loop.
+ */
+class cgvGlutAdapter {
+	static std::map<int, cgvInterface *> windows; ///< Instance shown in each window, by identifier of the window
+	static std::set<int> polled; ///< Windows whose timer is armed (set_glutTimerFunc)
+
+public:
+	cgvGlutAdapter() = delete;
+
+	static bool configure_environment(cgvInterface &ui, int argc, char **argv, int _width_window,
+	                                  int _height_window, int _pos_X, int _pos_Y, const std::string &_title);
+	static void init_callbacks(cgvInterface &ui);
+	static void init_rendering_loop();
+
+private:
+	static cgvInterface *current();
+	static void schedule_poll(int window, const cgvInterface &ui);
+
+	// event callbacks
+	static void set_glutKeyboardFunc(unsigned char key, int x, int y);
+	static void set_glutReshapeFunc(int w, int h);
+	static void set_glutDisplayFunc();
+	static void set_glutIdleFunc();
+	static void set_glutTimerFunc(int window);
+	static void set_glutMouseFunc(GLint button, GLint state, GLint x, GLint y);
+	static void set_glutMotionFunc(GLint x, GLint y);
+};
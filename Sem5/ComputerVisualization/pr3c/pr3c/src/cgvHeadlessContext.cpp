@@ -0,0 +1,144 @@
+#include <stdio.h>
+
+#include "cgvHeadlessContext.h"
+
+#ifdef CGV_HAVE_EGL
+#include <EGL/eglext.h>
+#endif
+
+/**
+ * Destructor. The context and the framebuffer are released
+ */
+cgvHeadlessContext::~cgvHeadlessContext() {
+	destroy();
+}
+
+/**
+ * Create the OpenGL context and the offscreen framebuffer, and make them current in the calling thread
+ * @param _width Width of the framebuffer in pixels
+ * @param _height Height of the framebuffer in pixels
+ * @param core_profile true to request an OpenGL 4.5 core profile context, false for a compatibility profile one
+ * @retval true if the context has been created, false otherwise (the reason is written to stderr)
+ * @post If true is returned, the context is current and the offscreen framebuffer is bound for drawing and reading
+ */
+bool cgvHeadlessContext::create(int _width, int _height, bool core_profile) {
+#ifdef CGV_HAVE_EGL
+	destroy();
+
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if ((display == EGL_NO_DISPLAY) || !eglInitialize(display, &major, &minor)) {
+		fprintf(stderr, "cgvHeadlessContext: unable to initialize EGL\n");
+		display = EGL_NO_DISPLAY;
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "cgvHeadlessContext: the EGL implementation does not support desktop OpenGL\n");
+		destroy();
+		return false;
+	}
+
+	EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+	                           core_profile ? context_attributes : nullptr);
+	if ((context == EGL_NO_CONTEXT) || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		fprintf(stderr, "cgvHeadlessContext: unable to create the OpenGL context\n");
+		destroy();
+		return false;
+	}
+
+	width = _width;
+	height = _height;
+
+	glGenRenderbuffers(1, &color_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depth_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rb);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "cgvHeadlessContext: the offscreen framebuffer is not complete\n");
+		destroy();
+		return false;
+	}
+
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glViewport(0, 0, width, height);
+
+	return true;
+#else
+	fprintf(stderr, "cgvHeadlessContext: headless rendering is not available in this build\n");
+	return false;
+#endif
+}
+
+/**
+ * Release the framebuffer and the OpenGL context
+ * @post The object can be used again to create a new context
+ */
+void cgvHeadlessContext::destroy() {
+#ifdef CGV_HAVE_EGL
+	if (context != EGL_NO_CONTEXT) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+		if (fbo) glDeleteFramebuffers(1, &fbo);
+		if (color_rb) glDeleteRenderbuffers(1, &color_rb);
+		if (depth_rb) glDeleteRenderbuffers(1, &depth_rb);
+
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+	}
+	// the display is not terminated: it is shared by every context of the process
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+#endif
+	fbo = color_rb = depth_rb = 0;
+	width = height = 0;
+}
+
+/**
+ * Make the context current in the calling thread, with the offscreen framebuffer bound
+ * @retval true if success, false otherwise
+ */
+bool cgvHeadlessContext::make_current() {
+#ifdef CGV_HAVE_EGL
+	if (!is_valid() || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		return false;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @retval true if the context has been successfully created
+ */
+bool cgvHeadlessContext::is_valid() const {
+#ifdef CGV_HAVE_EGL
+	return (context != EGL_NO_CONTEXT);
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#ifdef CGV_HAVE_EGL
+#include <EGL/egl.h>
+#endif
+
+/**
+ * cgvHeadlessContext creates an OpenGL context without any window (EGL surfaceless platform, e.g. Mesa llvmpipe)
+ * and an offscreen framebuffer with color and depth buffers where the scene can be rendered.
+ * It is used by the benchmarks and by the modes of the program that do not open a display window.
+ */
+class cgvHeadlessContext {
+	int width = 0; ///< Width of the offscreen framebuffer
+	int height = 0; ///< Height of the offscreen framebuffer
+
+	GLuint fbo = 0; ///< Framebuffer object where the scene is rendered
+	GLuint color_rb = 0; ///< Color renderbuffer (RGBA8)
+	GLuint depth_rb = 0; ///< Depth renderbuffer (24 bits)
+
+#ifdef CGV_HAVE_EGL
+	EGLDisplay display = EGL_NO_DISPLAY; ///< EGL display of the surfaceless platform
+	EGLContext context = EGL_NO_CONTEXT; ///< OpenGL context
+#endif
+
+public:
+	cgvHeadlessContext() = default;
+	~cgvHeadlessContext();
+
+	cgvHeadlessContext(const cgvHeadlessContext&) = delete;
+	cgvHeadlessContext& operator=(const cgvHeadlessContext&) = delete;
+
+	bool create(int _width, int _height, bool core_profile = false);
+	void destroy();
+
+	bool make_current();
+
+	bool is_valid() const;
+
+	int get_width() const { return width; };
+	int get_height() const { return height; };
+};
@@ -0,0 +1,389 @@
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+
+#include "cgvImpostors.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+static const float pi = 3.14159265358979f;
+
+// Width and height of the atlases: one row of directions for each pitch, first for non-selected boxes and then for
+// selected ones
+static const int atlas_width = cgvImpostors::YAW_STEPS * cgvImpostors::CELL_SIZE;
+static const int atlas_height = 2 * cgvImpostors::PITCH_STEPS * cgvImpostors::CELL_SIZE;
+
+/**
+ * Destructor. The atlases are released
+ * @pre The context where they were created must be current
+ */
+cgvImpostors::~cgvImpostors() {
+	destroy();
+}
+
+/**
+ * Prepare the impostors of a frame
+ * @param camera Camera of the frame
+ * @param _mode Mode of the frame
+ * @retval true if add() may replace boxes by impostors in this frame
+ * @pre The viewport of the frame has been set. The first call creates the atlases
+ */
+bool cgvImpostors::begin_frame(const cgvCamera &camera, RenderMode _mode) {
+	active = false;
+	vertices.clear();
+	if (init_failed) return false;
+	if (!supported && !init()) {
+		init_failed = true;
+		return false;
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float projection[16];
+	camera.get_view_matrix(view);
+	camera.get_projection_matrix(projection);
+	pixels_per_unit = projection[5] * viewport[3] * 0.5f;
+	perspective = !camera.isParallel();
+
+	if (perspective) {
+		// position of the camera: -R^T t
+		for (int i = 0; i < 3; ++i) {
+			eye[i] = -(view[i * 4] * view[12] + view[i * 4 + 1] * view[13] + view[i * 4 + 2] * view[14]);
+		}
+	} else {
+		// every box is seen from the same direction and has the same size
+		eye.set(view[2], view[6], view[10]);
+		if (2 * cgvBox::bounding_radius() * pixels_per_unit >= max_pixels) return false;
+	}
+
+	mode = _mode;
+	active = true;
+	return true;
+}
+
+/**
+ * Replace a box by an impostor if it is small enough in this frame
+ * @param box The box
+ * @param position Position of the box
+ * @param angle Rotation of the box around the Y axis, in degrees
+ * @retval true if the box has been replaced (the caller must not render it), false otherwise
+ */
+bool cgvImpostors::add(const cgvBox &box, const cgvPoint3D &position, GLfloat angle) {
+	if (!active) return false;
+
+	const float radius = cgvBox::bounding_radius();
+	float distance = 1;
+	if (perspective) {
+		distance = -(view[2] * position[X] + view[6] * position[Y] + view[10] * position[Z] + view[14]);
+		if (distance <= 2 * radius) return false; // too near: the impostor would be noticed
+	}
+	if (2 * radius * pixels_per_unit / distance >= max_pixels) return false;
+
+	// direction from the box to the camera and to the light, in the coordinates of the box
+	const float radians = angle * pi / 180, c = cosf(radians), s = sinf(radians);
+	float d[3], light[3];
+	for (int i = 0; i < 3; ++i) {
+		d[i] = perspective ? eye[i] - position[i] : eye[i];
+		light[i] = cgvScene3D::light_position[i] - position[i];
+	}
+	for (float *v : {d, light}) {
+		const float x = c * v[0] - s * v[2], z = s * v[0] + c * v[2];
+		const float length = sqrtf(x * x + v[1] * v[1] + z * z);
+		v[0] = x / length;
+		v[1] /= length;
+		v[2] = z / length;
+	}
+
+	// nearest direction of the atlas
+	float yaw = atan2f(d[0], d[2]);
+	if (yaw < 0) yaw += 2 * pi;
+	const int yaw_step = std::min(YAW_STEPS - 1, (int) (yaw / (2 * pi) * YAW_STEPS));
+	const int pitch_step = std::max(0, std::min(PITCH_STEPS - 1, (int) ((asinf(d[1]) + pi / 2) / pi * PITCH_STEPS)));
+	const int cell = pitch_step * YAW_STEPS + yaw_step;
+	if (!cell_ready[cell]) {
+		cell_ready[cell] = true; // it is rendered by draw(), before the impostors
+		cells_to_render.push_back(cell);
+	}
+
+	// quad perpendicular to the direction of the picture, in world coordinates
+	float cell_d[3], right[3], up[3];
+	cell_direction(cell, cell_d, right, up);
+	for (float *v : {right, up}) {
+		const float x = c * v[0] + s * v[2], z = -s * v[0] + c * v[2];
+		v[0] = x * radius;
+		v[1] *= radius;
+		v[2] = z * radius;
+	}
+
+	// texture coordinates of the cell, half a texel inside to avoid the neighbour cells
+	const int row = ((mode == CGV_DISPLAY) && box.isSelected() ? PITCH_STEPS : 0) + pitch_step;
+	const float u0 = (yaw_step * CELL_SIZE + 0.5f) / atlas_width, u1 = ((yaw_step + 1) * CELL_SIZE - 0.5f) / atlas_width;
+	const float v0 = (row * CELL_SIZE + 0.5f) / atlas_height, v1 = ((row + 1) * CELL_SIZE - 0.5f) / atlas_height;
+
+	vertex corner;
+	if (mode == CGV_SELECT) {
+		cgvBox::id_to_color(box.get_id(), corner.color);
+	} else {
+		// the light is scaled by the diffuse reflection of the material (0.8), GL_DOT3_RGB computes 4 * dot(n, l)
+		for (int i = 0; i < 3; ++i) corner.color[i] = (GLubyte) lroundf(127.5f + 127.5f * 0.8f * light[i]);
+	}
+	corner.color[3] = 255;
+
+	const float signs[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+	for (const float *sign : signs) {
+		for (int i = 0; i < 3; ++i) corner.position[i] = position[i] + sign[0] * right[i] + sign[1] * up[i];
+		corner.texture[0] = (sign[0] < 0) ? u0 : u1;
+		corner.texture[1] = (sign[1] < 0) ? v0 : v1;
+		vertices.push_back(corner);
+	}
+	return true;
+}
+
+/**
+ * Draw the impostors added in this frame
+ * @post The pictures that were missing are rendered first. The OpenGL state (and so the one shadowed by cgvGLState) is
+ * not changed
+ */
+void cgvImpostors::draw() {
+	if (!active) return;
+	active = false;
+	if (vertices.empty()) return;
+
+#ifdef CGV_HAVE_CORE_PROFILE
+	render_cells();
+
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glDisable(GL_LIGHTING);
+	glEnable(GL_ALPHA_TEST);
+	glAlphaFunc(GL_GREATER, 0.5f);
+
+	// unit 0: diffuse light with the normals, or color_as_ID. The coverage is the alpha of the normals
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, normal_atlas);
+	glEnable(GL_TEXTURE_2D);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+	if (mode == CGV_DISPLAY) {
+		glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_DOT3_RGB);
+		glTexEnvi(GL_TEXTURE_ENV, GL_SRC0_RGB, GL_TEXTURE);
+		glTexEnvi(GL_TEXTURE_ENV, GL_SRC1_RGB, GL_PRIMARY_COLOR);
+	} else {
+		glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+		glTexEnvi(GL_TEXTURE_ENV, GL_SRC0_RGB, GL_PRIMARY_COLOR);
+	}
+	glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_REPLACE);
+	glTexEnvi(GL_TEXTURE_ENV, GL_SRC0_ALPHA, GL_TEXTURE);
+
+	// unit 1: plus the emission and the ambient light
+	if (mode == CGV_DISPLAY) {
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, emission_atlas);
+		glEnable(GL_TEXTURE_2D);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+		glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_ADD);
+		glTexEnvi(GL_TEXTURE_ENV, GL_SRC0_RGB, GL_PREVIOUS);
+		glTexEnvi(GL_TEXTURE_ENV, GL_SRC1_RGB, GL_TEXTURE);
+		glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_REPLACE);
+		glTexEnvi(GL_TEXTURE_ENV, GL_SRC0_ALPHA, GL_PREVIOUS);
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(vertex), vertices[0].position);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(vertex), vertices[0].color);
+	for (GLenum unit : {GL_TEXTURE0, GL_TEXTURE1}) {
+		glClientActiveTexture(unit);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(vertex), vertices[0].texture);
+	}
+
+	glDrawArrays(GL_QUADS, 0, (GLsizei) vertices.size());
+
+	glPopClientAttrib();
+	glPopAttrib();
+#endif
+}
+
+/**
+ * Release the atlases
+ * @post The pictures will be rendered again if the impostors are used later
+ */
+void cgvImpostors::destroy() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+	if (depth_buffer) glDeleteRenderbuffers(1, &depth_buffer);
+	if (normal_atlas) glDeleteTextures(1, &normal_atlas);
+	if (emission_atlas) glDeleteTextures(1, &emission_atlas);
+#endif
+	framebuffer = depth_buffer = normal_atlas = emission_atlas = 0;
+	supported = false;
+	init_failed = false;
+	cell_ready.clear();
+	cells_to_render.clear();
+	vertices.clear();
+	active = false;
+}
+
+/**
+ * @retval Number of directions whose pictures have been rendered
+ */
+unsigned long cgvImpostors::get_num_rendered_cells() const {
+	return (unsigned long) std::count(cell_ready.begin(), cell_ready.end(), true);
+}
+
+
+// Private methods ---------------------------------------
+
+/**
+ * Create the atlases and the framebuffer used to render the pictures
+ * @retval true if they have been created, false otherwise (the reason is written to stderr)
+ * @pre An OpenGL context with the fixed-function pipeline is current
+ */
+bool cgvImpostors::init() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (!cgvGLState::supports(3, 0, "GL_ARB_framebuffer_object")) {
+		fprintf(stderr, "cgvImpostors: framebuffer objects are not supported, the impostors are disabled\n");
+		return false;
+	}
+
+	GLint previous_texture, previous_framebuffer;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+	for (GLuint *atlas : {&normal_atlas, &emission_atlas}) {
+		glGenTextures(1, atlas);
+		glBindTexture(GL_TEXTURE_2D, *atlas);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlas_width, atlas_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, previous_texture);
+
+	glGenRenderbuffers(1, &depth_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlas_width, atlas_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, normal_atlas, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+
+	if ((status != GL_FRAMEBUFFER_COMPLETE) || (glGetError() != GL_NO_ERROR)) {
+		fprintf(stderr, "cgvImpostors: unable to create the atlases, the impostors are disabled\n");
+		destroy();
+		return false;
+	}
+
+	cell_ready.assign(YAW_STEPS * PITCH_STEPS, false);
+	supported = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Render the pictures of the directions used for the first time in this frame
+ * @post The pictures of both atlases, for non-selected and selected boxes, are rendered. The OpenGL state is not
+ * changed
+ */
+void cgvImpostors::render_cells() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (cells_to_render.empty()) return;
+
+	if (mesh_indices.empty()) cgvBox::build_mesh(mesh_vertices, mesh_indices);
+
+	GLint previous_framebuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	const float radius = cgvBox::bounding_radius();
+	glOrtho(-radius, radius, -radius, radius, radius, 3 * radius);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_BLEND);
+	glDisable(GL_ALPHA_TEST);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glEnable(GL_SCISSOR_TEST);
+	glClearColor(0, 0, 0, 0);
+
+	for (int cell : cells_to_render) {
+		float d[3], right[3], up[3];
+		cell_direction(cell, d, right, up);
+		glLoadIdentity();
+		gluLookAt(2 * radius * d[0], 2 * radius * d[1], 2 * radius * d[2], 0, 0, 0, up[0], up[1], up[2]);
+
+		for (GLuint atlas : {normal_atlas, emission_atlas}) {
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas, 0);
+			for (int selected = 0; selected < 2; ++selected) {
+				const int x = (cell % YAW_STEPS) * CELL_SIZE;
+				const int y = (selected * PITCH_STEPS + cell / YAW_STEPS) * CELL_SIZE;
+				glViewport(x, y, CELL_SIZE, CELL_SIZE);
+				glScissor(x, y, CELL_SIZE, CELL_SIZE);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				glBegin(GL_TRIANGLES);
+				for (GLuint index : mesh_indices) {
+					const GLfloat *v = &mesh_vertices[index * 7];
+					if (atlas == normal_atlas) {
+						glColor4f(0.5f + 0.5f * v[3], 0.5f + 0.5f * v[4], 0.5f + 0.5f * v[5], 1);
+					} else {
+						// the same emission and ambient light (0.2 * 0.2) as the fixed-function lighting
+						const GLfloat *e = cgvBox::get_emission(selected ? CGV_NUM_BOX_PARTS : (int) v[6]);
+						glColor4f(e[0] + 0.04f, e[1] + 0.04f, e[2] + 0.04f, 1);
+					}
+					glVertex3fv(v);
+				}
+				glEnd();
+			}
+		}
+	}
+	cells_to_render.clear();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopAttrib();
+#endif
+}
+
+/**
+ * Compute the direction of view of the picture of a cell of the atlases, in the coordinates of the box
+ * @param cell Index of the cell: pitch step * YAW_STEPS + yaw step
+ * @param d Output unit vector from the box to the camera of the picture
+ * @param right Output unit vector to the right of the picture
+ * @param up Output unit vector to the top of the picture
+ */
+void cgvImpostors::cell_direction(int cell, float d[3], float right[3], float up[3]) {
+	const float yaw = ((cell % YAW_STEPS) + 0.5f) * 2 * pi / YAW_STEPS;
+	const float pitch = ((cell / YAW_STEPS) + 0.5f) * pi / PITCH_STEPS - pi / 2;
+	d[0] = cosf(pitch) * sinf(yaw);
+	d[1] = sinf(pitch);
+	d[2] = cosf(pitch) * cosf(yaw);
+
+	// right = -d x Y, up = right x -d (the same vectors as gluLookAt with the Y axis as up)
+	right[0] = cosf(yaw);
+	right[1] = 0;
+	right[2] = -sinf(yaw);
+	up[0] = -sinf(pitch) * sinf(yaw);
+	up[1] = cosf(pitch);
+	up[2] = -sinf(pitch) * cosf(yaw);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "cgvBox.h"
+#include "cgvPoint.h"
+
+class cgvCamera;
+
+/**
+ * cgvImpostors replaces the boxes that cover few pixels with impostors: textured quads with a picture of the box.
+ * The pictures are rendered once, the first time they are needed, for YAW_STEPS x PITCH_STEPS directions of view
+ * around the box, and stored in two atlases: the normals of the box and its emission (plus ambient light), for
+ * non-selected and selected boxes. The impostor of a box uses the picture of the direction nearest to the one from
+ * which the camera sees it, so the picture changes when the box or the camera turn more than one step.
+ * The diffuse light is computed for each pixel of the impostor with the normals (texture combiner GL_DOT3_RGB) and
+ * the direction of the light at the center of the box, so the same pictures are valid wherever the box is.
+ * All the impostors of a frame are drawn with a single call.
+ */
+class cgvImpostors {
+public:
+	static const int CELL_SIZE = 32; ///< Columns and rows of the picture of each direction
+	static const int YAW_STEPS = 32; ///< Directions around the Y axis of the box
+	static const int PITCH_STEPS = 18; ///< Directions from below to above the box
+	static constexpr float DEFAULT_MAX_PIXELS = 16; ///< Default projected size (diameter) of the boxes replaced
+
+private:
+	/**
+	 * Vertex of an impostor
+	 */
+	struct vertex {
+		GLfloat position[3]; ///< World coordinates
+		GLfloat texture[2]; ///< Coordinates in both atlases
+		GLubyte color[4]; ///< Direction of the light (display mode) or color_as_ID (selection mode)
+	};
+
+	GLuint normal_atlas = 0; ///< Normals of the box (RGB) and coverage (A) in each direction
+	GLuint emission_atlas = 0; ///< Emission plus ambient light (RGB) and coverage (A) in each direction
+	GLuint framebuffer = 0, depth_buffer = 0; ///< Framebuffer used to render the pictures
+	bool supported = false; ///< The atlases have been created
+	bool init_failed = false; ///< They could not be created: the impostors are never used
+
+	std::vector<bool> cell_ready; ///< Whether the picture of each direction has been rendered
+	std::vector<int> cells_to_render; ///< Directions used in this frame that have not been rendered yet
+	std::vector<GLfloat> mesh_vertices; ///< Mesh of the box rendered in the pictures (cgvBox::build_mesh)
+	std::vector<GLuint> mesh_indices; ///< Triangles of mesh_vertices
+
+	float max_pixels = DEFAULT_MAX_PIXELS; ///< Boxes with a smaller projected diameter are replaced
+	bool active = false; ///< begin_frame() has enabled the impostors for this frame
+	RenderMode mode = CGV_DISPLAY; ///< Mode of the frame
+	float view[16]; ///< View matrix of the frame
+	float pixels_per_unit = 0; ///< Projected size of one unit at a distance of one unit (perspective) or anywhere
+	bool perspective = false; ///< The camera of the frame is a perspective one
+	cgvPoint3D eye; ///< Position of the camera (perspective) or direction to the camera (parallel)
+
+	std::vector<vertex> vertices; ///< Impostors of this frame, 4 vertices each
+
+public:
+	cgvImpostors() = default;
+	~cgvImpostors();
+
+	cgvImpostors(const cgvImpostors&) = delete;
+	cgvImpostors& operator=(const cgvImpostors&) = delete;
+
+	bool begin_frame(const cgvCamera &camera, RenderMode _mode);
+	bool add(const cgvBox &box, const cgvPoint3D &position, GLfloat angle);
+	void draw();
+	void destroy();
+
+	float get_max_pixels() const { return max_pixels; };
+	void set_max_pixels(float _max_pixels) { max_pixels = _max_pixels; };
+
+	/**
+	 * @retval Number of impostors drawn in the last frame
+	 */
+	unsigned long get_num_impostors() const { return (unsigned long) (vertices.size() / 4); };
+	/**
+	 * @retval Memory of the impostor of a box (the atlases do not depend on the number of boxes)
+	 */
+	static uint32_t get_bytes_per_box() { return (uint32_t) (4 * sizeof(vertex)); };
+	unsigned long get_num_rendered_cells() const;
+
+private:
+	bool init();
+	void render_cells();
+	static void cell_direction(int cell, float d[3], float right[3], float up[3]);
+};
@@ -1,97 +1,379 @@
+#include <algorithm>
+#include <cmath>
+#include <chrono>
 #include <cstdlib>
 #include <stdio.h>
+#include <thread>
 
 #include "cgvInterface.h"
-
-
-// Singleton pattern
-cgvInterface *cgvInterface::instance = nullptr;
+#include "cgvSceneDiff.h"
+#include "cgvHeadlessContext.h"
+#include "cgvViewList.h"
 
 
 // Public methods ----------------------------------------
 /**
- * Method to access the unique instance of the class. Singleton pattern
- * @return A reference to the unique instance of the class
+ * Read the options of the command line. The options that are not recognized are left for GLUT
+ * @param argc Number of parameters of the command line
+ * @param argv Parameters of the command line
+ * @retval false if an option has a non-valid value (a message is written to stderr)
+ * @post If --layout, --boxes or --seed are given, the scene will be created by the generator. --renderer fixed|core
+ * selects the OpenGL pipeline. --paged renders a page file with the memory budget of --memory-budget, and
+ * --write-pages writes the scene to a page file once it is built. --updates reads updates of the transformation of the
+ * boxes from the standard input (-), a Unix domain socket (unix:<path>), a FIFO or a file. --frames-shm publishes the
+ * rendered frames in a ring of frames in shared memory. --export renders a turntable of --export-frames frames of
+ * --export-size pixels without a window, and writes it to a sequence of images. --views renders the views of a views
+ * file instead of the turntable (cgvViewList), and without --export writes the hash of the image of each view
  */
-cgvInterface &cgvInterface::getInstance() {
-    if (!instance) {
-        instance = new cgvInterface;
+bool cgvInterface::parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        int consumed = generator.parse_args(argc, argv, i);
+        if ((string(argv[i]) == "--load") && (consumed == 0)) {
+            consumed = -1;
+            if (i + 1 < argc) {
+                snapshot_path = argv[i + 1];
+                load_snapshot = true;
+                ++i;
+                continue;
+            }
+        }
+        if ((string(argv[i]) == "--paged") || (string(argv[i]) == "--write-pages") || (string(argv[i]) == "--updates") ||
+            (string(argv[i]) == "--frames-shm") || (string(argv[i]) == "--export") || (string(argv[i]) == "--views")) {
+            consumed = -1;
+            if (i + 1 < argc) {
+                string &value = (string(argv[i]) == "--paged") ? pages_path :
+                                ((string(argv[i]) == "--write-pages") ? write_pages_path :
+                                 ((string(argv[i]) == "--updates") ? updates_source :
+                                  ((string(argv[i]) == "--frames-shm") ? frames_name :
+                                   ((string(argv[i]) == "--export") ? export_pattern : views_path))));
+                value = argv[i + 1];
+                ++i;
+                continue;
+            }
+        }
+        if (string(argv[i]) == "--memory-budget") {
+            consumed = -1;
+            if (i + 1 < argc) {
+                char *end = nullptr;
+                unsigned long long megabytes = strtoull(argv[i + 1], &end, 10);
+                if ((*argv[i + 1] != '\0') && (*end == '\0') && (megabytes > 0) && (megabytes < (1ull << 32))) {
+                    memory_budget = megabytes << 20;
+                    ++i;
+                    continue;
+                }
+            }
+        }
+        if (string(argv[i]) == "--export-frames") {
+            consumed = -1;
+            if (i + 1 < argc) {
+                char *end = nullptr;
+                unsigned long frames = strtoul(argv[i + 1], &end, 10);
+                if ((*argv[i + 1] != '\0') && (*end == '\0') && (frames > 0) && (frames <= UINT32_MAX)) {
+                    export_frames = (uint32_t) frames;
+                    ++i;
+                    continue;
+                }
+            }
+        }
+        if (string(argv[i]) == "--export-size") {
+            consumed = -1;
+            int width = 0, height = 0;
+            char end = '\0';
+            if ((i + 1 < argc) && (sscanf(argv[i + 1], "%dx%d%c", &width, &height, &end) == 2) && (width > 0) &&
+                (height > 0)) {
+                export_width = width;
+                export_height = height;
+                ++i;
+                continue;
+            }
+        }
+        if (string(argv[i]) == "--renderer") {
+            consumed = -1;
+            if (i + 1 < argc) {
+                string value = argv[i + 1];
+                if ((value == "fixed") || (value == "core")) {
+                    backend = (value == "core") ? CGV_RENDERER_CORE_PROFILE : CGV_RENDERER_FIXED_FUNCTION;
+                    ++i;
+                    continue;
+                }
+            }
+        }
+        if (consumed < 0) {
+            fprintf(stderr, "Non-valid value for %s\n"
+                            "usage: %s [--layout tower|grid|clusters|dense] [--boxes <n>] [--seed <n>]"
+                            " [--load <snapshot>] [--paged <pages>] [--memory-budget <MB>] [--write-pages <pages>]"
+                            " [--updates -|unix:<socket>|<fifo>] [--frames-shm <name>] [--renderer fixed|core]"
+                            " [--export <pattern.png|pattern.ppm>] [--export-frames <n>] [--export-size <w>x<h>]"
+                            " [--views <file>]\n",
+                    argv[i], argv[0]);
+            return false;
+        }
+        if (consumed > 0) {
+            generate_scene = true;
+            i += consumed - 1;
+        }
     }
-
-    return *instance;
+    return true;
 }
 
 /**
  * Create a new empty world with a camera
+ * @retval false if the snapshot or the page file cannot be loaded, the updates cannot be received or the ring cannot
+ * be created (the reason is written to stderr)
+ * @post If the scene is loaded from a snapshot, it takes the camera of the snapshot and the loader starts: the boxes
+ * are added while the scene is rendered (update_loading). If the scene is generated (or when the snapshot without
+ * camera is loaded), the camera is placed so that the whole scene is visible. The loaded snapshot is watched, and
+ * reloaded every time it is written (poll_changes). With a page file, only the pages near
+ * the camera are loaded, while the scene is rendered (render_scene). The updates of --updates are received from now
+ * on. The ring of --frames-shm is as large as the maximum size of the window, so that the frames are not cropped when
+ * the window grows
  */
-void cgvInterface::create_world(void) {
+bool cgvInterface::create_world(void) {
     camera = cgvCamera(cgvPoint3D(6.0, 4.0, 8), cgvPoint3D(0, 0, 0), cgvPoint3D(0, 1.0, 0));
     camera.setParallelParameters(1 * 5, 1 * 5, 0.1, 200);
+    scene.set_camera(&camera);
+
+    if (!pages_path.empty()) {
+        if (!pager.open(pages_path, memory_budget)) return false;
+        scene.clear();
+        frame_scene();
+    } else if (load_snapshot) {
+        if (!streamer.start(snapshot_path, scene, &camera)) return false;
+        watcher.watch(snapshot_path);
+    } else if (generate_scene) {
+        generator.generate(scene);
+        frame_scene();
+    }
+    if (!streamer.is_loading()) write_pages();
+    if (!updates_source.empty() && !receiver.start(updates_source)) return false;
+    if (!frames_name.empty()) {
+        int width = max(width_window, max_width_window);
+        int height = max(height_window, max_height_window);
+        if (!frame_sink.create(frames_name, (uint32_t) width, (uint32_t) height)) return false;
+    }
+    return true;
 }
 
 /**
- * Initialize the required parameters to create a window
- * @param argc Parameter from the main function of the program to know the number of input parameters from the command line
- * @param argv Parámeter from the command line to run the whole program
- * @param _width_window Initial width of the window
- * @param _height_window Initial height of the window
- * @param _pos_X Initial position of the window (X coordinate)
- * @param _pos_Y Initial position of the window (Y coordinate)
- * @param _title Title of the window
- * @pre It is assumed that the parameters have valid values
- * @post Change the height and weight of the window stored in the object
- */
-void cgvInterface::configure_environment(int argc, char **argv,
-                                         int _width_window, int _height_window,
-                                         int _pos_X, int _pos_Y,
-                                         string _title) {
-    // initialization of the interface variables
-    width_window = _width_window;
-    height_window = _height_window;
-
-    // initialization of the display window
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-    glutInitWindowSize(_width_window, _height_window);
-    glutInitWindowPosition(_pos_X, _pos_Y);
-    glutCreateWindow(_title.c_str());
-
-    glEnable(GL_DEPTH_TEST); // enable the removal of hidden surfaces by using the z-buffer
-    glClearColor(1.0, 1.0, 1.0, 0.0); // define the background color of the window
+ * Save the scene and the camera to the snapshot (snapshot_path)
+ */
+void cgvInterface::save_snapshot() {
+    if (snapshot.save(snapshot_path, scene, &camera)) {
+        printf("Saved %lu boxes to %s (%lu bytes)\n", snapshot.get_num_boxes(), snapshot_path.c_str(),
+               snapshot.get_num_bytes());
+    }
+}
+
+/**
+ * Apply to the scene the changes of the snapshot (snapshot_path): its boxes are matched with the ones of the scene by
+ * their identifier, and only the inserted, removed and modified ones are changed
+ * @post The selection of the boxes is kept, and the camera does not change. If the snapshot is not valid, the reason
+ * is written to stderr and the scene does not change
+ */
+void cgvInterface::reload_snapshot() {
+    cgvSceneDiff diff;
+    const bool valid = snapshot.open(snapshot_path) && diff.compute(scene, snapshot);
+    snapshot.close();
+    if (!valid) {
+        fprintf(stderr, "The scene has not been reloaded from %s\n", snapshot_path.c_str());
+        return;
+    }
+    if (diff.is_empty()) return;
+
+    diff.apply(scene);
+    printf("Reloaded %s: %u boxes inserted, %u removed and %u modified\n", snapshot_path.c_str(),
+           diff.get_num_inserted(), diff.get_num_removed(), diff.get_num_modified());
+}
+
+/**
+ * Write the scene to the page file of --write-pages, if it was given
+ */
+void cgvInterface::write_pages() {
+    if (write_pages_path.empty()) return;
+    if (pager.is_open()) {
+        fprintf(stderr, "The page file %s is not written: only some pages of %s are in the scene\n",
+                write_pages_path.c_str(), pages_path.c_str());
+    } else if (cgvPagedScene::write(write_pages_path, scene)) {
+        printf("Wrote %u boxes to %s\n", scene.get_num_boxes(), write_pages_path.c_str());
+    }
+}
+
+/**
+ * Render several views of the scene without a window, and write their frames to the images of --export, or compute
+ * the hash of each image without it (get_view_hashes). The views are those of --views, or a turntable: the camera
+ * turns around the vertical axis that goes through its reference point, one turn in --export-frames frames. The scene
+ * is created once for all the views, and only the camera changes from a view to the next one. The frames are rendered
+ * while the previous ones are read back and encoded by other threads (cgvSequenceExporter)
+ * @retval true if all the images have been written. Otherwise, the reason is written to stderr
+ * @pre parse_args has been called. It is used instead of cgvGlutAdapter
+ * @post The views are rendered in a context of this instance, current in the calling thread while they are rendered:
+ * other instances can render their views in other threads at the same time. The snapshot of --load is loaded
+ * completely before the first frame
+ */
+bool cgvInterface::render_views() {
+    width_window = export_width;
+    height_window = export_height;
+    cgvViewList views;
+    if (!views_path.empty() && !views.load(views_path)) return false;
+    cgvHeadlessContext context;
+    if ((backend == CGV_RENDERER_CORE_PROFILE) &&
+        (!context.create(width_window, height_window, true) || !init_renderer())) {
+        fprintf(stderr, "The core profile renderer is not available, the fixed-function pipeline is used\n");
+        context.destroy();
+        backend = CGV_RENDERER_FIXED_FUNCTION;
+    }
+    if ((backend == CGV_RENDERER_FIXED_FUNCTION) && !context.create(width_window, height_window)) {
+        fprintf(stderr, "The turntable can not be exported without an OpenGL context\n");
+        return false;
+    }
+    init_gl_state();
 
+    if (!create_world()) return false;
+    if (streamer.is_loading()) {
+        while (streamer.is_loading()) {
+            if (!streamer.update(scene)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!streamer.has_loaded_camera()) frame_scene();
+        write_pages();
+    }
+
+    if (views_path.empty()) views.turntable(camera, export_frames);
+    const uint32_t n_views = views.get_num_views();
 
-    glEnable(GL_LIGHTING); // enable the lighting of the scene
-    glEnable(GL_NORMALIZE); // normalize the normal vectors required by the lighting computation.
+    if (!exporter.start(export_pattern, (uint32_t) width_window, (uint32_t) height_window)) return false;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < n_views; ++f) {
+        camera = views.get_views()[f];
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glViewport(0, 0, width_window, height_window);
+        render_scene();
+        exporter.capture(f);
+        frame_sink.capture(width_window, height_window);
+    }
+    const bool written = exporter.finish();
+    frame_sink.finish();
+    views_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return written;
+}
+
+/**
+ * Render the views of the scene without a window (render_views), and write to the standard output the hash of the
+ * image of each view when there is no --export
+ * @retval true if all the images have been written
+ * @pre parse_args has been called
+ */
+bool cgvInterface::export_sequence() {
+    const bool written = render_views();
+    const uint32_t n_views = (uint32_t) exporter.get_num_captured();
+    if (n_views == 0) return false;
+
+    if (export_pattern.empty()) {
+        for (uint32_t f = 0; f < n_views; ++f) {
+            printf("%u %016llx\n", f, (unsigned long long) get_view_hashes()[f]);
+        }
+        fprintf(stderr, "Rendered %u views in %.2f s (%.1f views/s, %u hashing threads, %lu stalls)\n", n_views,
+                views_seconds, n_views / views_seconds, exporter.get_num_threads(), exporter.get_num_stalls());
+        return written;
+    }
+    printf("Exported %lu of %u frames to %s in %.2f s (%.1f frames/s, %lu MB, %u encoding threads, %lu stalls)\n",
+           exporter.get_num_written(), n_views, export_pattern.c_str(), views_seconds, n_views / views_seconds,
+           (unsigned long) (exporter.get_num_bytes() >> 20), exporter.get_num_threads(), exporter.get_num_stalls());
+    return written;
+}
+
+/**
+ * Place the camera so that the whole scene is visible
+ * @post Same direction of view as the default camera, with a parallel projection
+ */
+void cgvInterface::frame_scene() {
+    cgvPoint3D min, max;
+    if (pager.is_open()) {
+        pager.get_bounds(min, max);
+    } else {
+        scene.get_bounds(min, max);
+    }
+    cgvPoint3D center((min[X] + max[X]) / 2, (min[Y] + max[Y]) / 2, (min[Z] + max[Z]) / 2);
+    float radius = sqrt((max[X] - center[X]) * (max[X] - center[X]) + (max[Y] - center[Y]) * (max[Y] - center[Y]) +
+                        (max[Z] - center[Z]) * (max[Z] - center[Z]));
+    if (radius < 5) radius = 5;
+
+    // same direction of view as the default camera (6, 4, 8), far enough to contain the whole scene
+    float d = 2 * radius / sqrt(6.0f * 6 + 4 * 4 + 8 * 8);
+    camera = cgvCamera(cgvPoint3D(center[X] + 6 * d, center[Y] + 4 * d, center[Z] + 8 * d), center,
+                       cgvPoint3D(0, 1.0, 0));
+    camera.setParallelParameters(radius, radius, 0.1, 4 * radius);
+}
 
-    create_world(); // create the world (scene) to be rendered in the window
+/**
+ * Initialize the renderer of the selected OpenGL pipeline in the current context
+ * @retval false if the core profile renderer is not available: the context must be created again for the
+ * fixed-function pipeline (set_backend)
+ */
+bool cgvInterface::init_renderer() {
+    return (backend != CGV_RENDERER_CORE_PROFILE) || shader_renderer.init(&program_cache);
 }
 
 /**
- * Infinite loop to render the scene and wait for new events in the interface
+ * Set the initial OpenGL state of the current context
  */
-void cgvInterface::init_rendering_loop() {
-    glutMainLoop(); // initialize the visualization loop of OpenGL
+void cgvInterface::init_gl_state() {
+    cgvGLState &state = scene.get_gl_state();
+    state.enable(GL_DEPTH_TEST); // enable the removal of hidden surfaces by using the z-buffer
+    glClearColor(1.0, 1.0, 1.0, 0.0); // define the background color of the window
+
+    if (backend == CGV_RENDERER_FIXED_FUNCTION) {
+        state.enable(GL_LIGHTING); // enable the lighting of the scene
+        state.enable(GL_NORMALIZE); // normalize the normal vectors required by the lighting computation.
+    }
 }
 
 /**
  * Method to control the keyboard events
  * @param key Pressed key code
- * @param x Mouse position (x coordinate) when the key was pressed
- * @param y Mouse position (y coordinate) when the key was pressed
  * @pre It is assumed that the parameters have valid values
  * @post The attribute that indicate whether the axes are rendered or not can be updated.
  */
-void cgvInterface::set_glutKeyboardFunc(unsigned char key, int x, int y) {
+void cgvInterface::key_pressed(unsigned char key) {
     switch (key) {
         case 'a': // enable/disable the visualization of the axes
-            cgvInterface::getInstance().scene.set_axes(cgvInterface::getInstance().scene.get_axes() ? false : true);
+            scene.set_axes(scene.get_axes() ? false : true);
 
             break;
-        case 27: // Escape key to exit
-            exit(1);
+        case 'q': // enable/disable the sorting of the boxes by material and depth
+            scene.set_render_queue(!scene.get_render_queue());
+            break;
+        case 'g': // enable/disable the culling of the boxes in the GPU (core profile renderer)
+            if (!shader_renderer.supports_gpu_culling()) {
+                printf("The culling in the GPU requires the core profile renderer and OpenGL 4.3\n");
+            }
+            shader_renderer.set_gpu_culling(!shader_renderer.get_gpu_culling());
+            break;
+        case 'o': // enable/disable the occlusion culling of the boxes (fixed-function pipeline)
+            scene.set_occlusion_culling(!scene.get_occlusion_culling());
+            break;
+        case 's': // enable/disable the occlusion culling of the boxes in the CPU (fixed-function pipeline)
+            scene.set_software_culling(!scene.get_software_culling());
+            break;
+        case 'l': // enable/disable the impostors of the distant boxes (fixed-function pipeline)
+            scene.set_impostors(!scene.get_impostors());
+            break;
+        case 'b': // enable/disable the batching of the boxes that are not rotated (fixed-function pipeline)
+            scene.set_static_batching(!scene.get_static_batching());
+            break;
+        case 'k': // enable/disable the cache of the static layer while the selected boxes are rotated (fixed-function pipeline)
+            scene.set_layer_caching(!scene.get_layer_caching());
+            break;
+        case 'r': // enable/disable the redraw of only the region of the boxes whose selection changes (fixed-function pipeline)
+            scene.set_partial_redraw(!scene.get_partial_redraw());
+            break;
+        case 'w': // save the scene and the camera to the snapshot
+            save_snapshot();
+            break;
+        case 'c': // print the OpenGL state changes and the culled boxes of the last frame
+            print_state_counters();
             break;
     }
-    glutPostRedisplay(); // renew the content of the window
 }
 
 /**
@@ -100,46 +382,116 @@ void cgvInterface::set_glutKeyboardFunc(unsigned char key, int x, int y) {
  * @param h Height of the window
  * @pre It is assumed that the parameters have valid values
  */
-void cgvInterface::set_glutReshapeFunc(int w, int h) {
-    // dimension of the viewport with a new width and a new height of the display window
+void cgvInterface::resize(int w, int h) {
+    // store the new values of the viewport and the display window.
+    set_width_window(w);
+    set_height_window(h);
+
+    // Set up the kind of projection to be used (the core profile renderer sets it up in every frame)
+    if (backend == CGV_RENDERER_FIXED_FUNCTION) {
+        camera.apply();
+    }
+}
+
+/**
+ * Method that is called while no event is pending and the snapshot is being loaded. It adds the loaded boxes to the
+ * scene
+ * @retval true if the scene has changed and it must be rendered again
+ * @post When the whole snapshot has been loaded, the camera frames the scene if the snapshot had no camera
+ */
+bool cgvInterface::update_loading() {
+    if (!streamer.is_loading()) return false;
+    if (!streamer.update(scene) && streamer.is_loading()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1)); // the loader has not filled the next chunk yet
+        return false;
+    }
 
+    if (!streamer.is_loading()) {
+        printf("Loaded %u boxes from %s\n", streamer.get_num_loaded(), snapshot_path.c_str());
+        if (!streamer.has_loaded_camera()) frame_scene();
+        write_pages();
+    }
+    return true;
+}
 
-    // store the new values of the viewport and the display window.
-    cgvInterface::getInstance().set_width_window(w);
-    cgvInterface::getInstance().set_height_window(h);
+/**
+ * @retval Title of the window, with the progress of the snapshot while it is loaded
+ */
+string cgvInterface::get_window_title() const {
+    if (!streamer.is_loading()) return title;
+    char progress[64];
+    snprintf(progress, sizeof(progress), " (loading %u / %u boxes)", streamer.get_num_loaded(),
+             streamer.get_num_total());
+    return title + progress;
+}
+
+/**
+ * Method that is called periodically while the loaded snapshot is watched, updates are received or rendered frames
+ * are being read back (get_poll_interval). When the snapshot has been written, the changes are applied to the scene
+ * @retval true if the scene must be rendered again: the snapshot has been reloaded or updates have been received
+ * (they are applied in render_scene)
+ * @pre The context of the window is current
+ * @post The snapshot is not reloaded while it is still being streamed. The frames already read back are published,
+ * so the last frame reaches the ring although no other frame is rendered
+ */
+bool cgvInterface::poll_changes() {
+    frame_sink.publish_ready();
+
+    bool changed = false;
+    if (watcher.is_watching() && !streamer.is_loading() && watcher.changed()) {
+        reload_snapshot();
+        changed = true;
+    }
+    return changed || receiver.has_pending();
+}
 
-    // Set up the kind of projection to be used
-    cgvInterface::getInstance().camera.apply();
+/**
+ * @retval Milliseconds until the next call to poll_changes: UPDATE_INTERVAL while updates are received or frames are
+ * being read back, WATCH_INTERVAL while only the snapshot is watched, and 0 when nothing has to be polled
+ */
+int cgvInterface::get_poll_interval() const {
+    if (receiver.is_receiving() || receiver.has_pending() || frame_sink.has_frames_in_flight()) return UPDATE_INTERVAL;
+    return watcher.is_watching() ? WATCH_INTERVAL : 0;
 }
 
 /**
  * Method to render the scene
+ * @retval true if the frame must be shown: it has been rendered in display mode
  */
-void cgvInterface::set_glutDisplayFunc() {
+bool cgvInterface::render_frame() {
+    scene.get_gl_state().reset_counters();
+
+    // Section A: check the mode before applying the camera and projection transformations, and before clearing the
+    // window (only the pixel below the mouse is cleared in selection mode)
+    if (mode == CGV_SELECT) {
+        init_selection();
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // clear the window and the z-buffer
 
     // set up the viewport
-    glViewport(0, 0, cgvInterface::getInstance().get_width_window(), cgvInterface::getInstance().get_height_window());
-
-    // Section A: check the mode before applying the camera and projection transformations,
-    if (cgvInterface::getInstance().mode == CGV_SELECT) {
-        cgvInterface::getInstance().init_selection();
-    }
-    // Apply the camera and projection transformations according to its parameters and to the mode (selection or visualization)
-    cgvInterface::getInstance().camera.apply();
+    glViewport(0, 0, get_width_window(), get_height_window());
 
     // Render the scene
-    cgvInterface::getInstance().scene.render(cgvInterface::getInstance().mode);
+    render_scene();
 
-    if (cgvInterface::getInstance().mode == CGV_SELECT) {
-        cgvInterface::getInstance().finish_selection();
-        glutPostRedisplay();
-    } else {
-        // refresh the window
-        glutSwapBuffers(); // it is used instead of glFlush(), to avoid flickering
+    if (mode == CGV_SELECT) {
+        finish_selection();
+        return false;
     }
+
+    // the frame is read back from the back buffer, before it is shown
+    frame_sink.capture(get_width_window(), get_height_window());
+    return true;
 }
 
+/**
+ * @retval true if the scene must be rendered again although nothing changes: in selection mode, and while the boxes
+ * revealed by the last change of the view are not known yet (occlusion culling)
+ */
+bool cgvInterface::needs_another_frame() const {
+    return (mode == CGV_SELECT) || (scene.get_occlusion_culling() && scene.get_occlusion().needs_another_frame());
+}
 
 /**
  * Mouse buttom detection function
@@ -147,67 +499,57 @@ void cgvInterface::set_glutDisplayFunc() {
  * @param state The state parameter is either GLUT_UP or GLUT_DOWN
  * @param x X position of the mouse at the time the buttom is pressed or released
  * @param y Y position of the mouse at the time the buttom is pressed or released
+ * @retval true if the scene must be rendered again
  */
-void cgvInterface::set_glutMouseFunc(GLint button, GLint state, GLint x, GLint y) {
-    // TODO: Section A: check if the left button of the mouse has been clicked
-    // Review the documentation of glutMouseFunc in
-    // Check if the state is GLUT_DOWN or not
+bool cgvInterface::mouse_button(GLint button, GLint state, GLint x, GLint y) {
+    // Section A: check if the left button of the mouse has been clicked
     // If the state is GLUT_DOWN then, change to select mode, store the position of the mouse and modify the state of pressed_button
     // if the state is not GLUT_DOWN change to display mode and modify the state of pressed_button accordingly.
-    if (button == GLUT_LEFT_BUTTON) {
-        getInstance().cursorX = x;
-        getInstance().cursorY = y;
-        getInstance().pressed_button = state;
-
-        if (state == GLUT_DOWN) {
-            getInstance().mode = CGV_SELECT; // Enable selection mode
-        } else {
-            getInstance().mode = CGV_DISPLAY; // Return to display mode
-        }
-        glutPostRedisplay(); // Trigger a redraw
+    if (button != GLUT_LEFT_BUTTON) return false;
+
+    cursorX = x;
+    cursorY = y;
+    pressed_button = state;
+
+    if (state == GLUT_DOWN) {
+        mode = CGV_SELECT; // Enable selection mode
+    } else {
+        mode = CGV_DISPLAY; // Return to display mode
     }
+    return true;
 }
 
 /**
  * Mouse buttom movement detection method
  * @param x X position of the mouse
  * @param y Y position of the mouse
+ * @retval true if the scene must be rendered again: the selected box has been rotated
  */
-void cgvInterface::set_glutMotionFunc(GLint x, GLint y) {
-    if (getInstance().pressed_button == GLUT_DOWN) {
-        if (getInstance().scene.return_isAnyBoxSelected()) {
-            GLint deltaX = x - getInstance().cursorX; // Change in x position
-            GLint deltaY = y - getInstance().cursorY; // Change in y position
-
-            getInstance().scene.updateRotation(deltaX, deltaY); // Example: Updating rotation
+bool cgvInterface::mouse_motion(GLint x, GLint y) {
+    if ((pressed_button != GLUT_DOWN) || !scene.return_isAnyBoxSelected()) return false;
 
-            getInstance().cursorX = x;
-            getInstance().cursorY = y;
-            glutPostRedisplay();
-        }
-    }
-}
+    GLint deltaX = x - cursorX; // Change in x position
+    GLint deltaY = y - cursorY; // Change in y position
 
+    scene.updateRotation(deltaX, deltaY); // Example: Updating rotation
 
-/**
- * Method to indicate the callback functions
- */
-void cgvInterface::init_callbacks() {
-    glutKeyboardFunc(set_glutKeyboardFunc);
-    glutReshapeFunc(set_glutReshapeFunc);
-    glutDisplayFunc(set_glutDisplayFunc);
-
-    glutMouseFunc(set_glutMouseFunc);
-    glutMotionFunc(set_glutMotionFunc);
+    cursorX = x;
+    cursorY = y;
+    return true;
 }
 
 
 /**
  * Function to do the required operations when the selection begins
+ * @post Only the pixel below the mouse is rasterized: it is the only one read by finish_selection
  */
 void cgvInterface::init_selection() {
     // Section A: Disable lighting.
-    glDisable(GL_LIGHTING);
+    if (backend == CGV_RENDERER_FIXED_FUNCTION) {
+        scene.get_gl_state().disable(GL_LIGHTING);
+    }
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(cursorX, height_window - cursorY, 1, 1);
 }
 
 /**
@@ -225,12 +567,114 @@ void cgvInterface::finish_selection() {
     // TODO: Section A. Once the color below the mouse is stored, then look for the corresponding box and select it.
     // Use the function assignSelection from Scene
 
-    glReadPixels(getInstance().cursorX, getInstance().height_window - getInstance().cursorY, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glReadPixels(cursorX, height_window - cursorY, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glDisable(GL_SCISSOR_TEST);
+
+    scene.assignSelection(pixels);
+
+
+    if (backend == CGV_RENDERER_FIXED_FUNCTION) {
+        scene.get_gl_state().enable(GL_LIGHTING);
+    }
+}
+
+/**
+ * Render the scene in the current mode with the selected OpenGL pipeline
+ * @post With the fixed-function pipeline, the camera and projection transformations are applied before rendering.
+ * With a page file, the pages near the camera are loaded before rendering in display mode, and the bounds of the
+ * visible pages that are not loaded are drawn (fixed-function pipeline). The updates received since the last frame
+ * are applied before rendering in display mode
+ */
+void cgvInterface::render_scene() {
+    if ((mode == CGV_DISPLAY) && pager.is_open()) {
+        // the core profile renderer replaces the renderers of the scene
+        const uint32_t bytes_per_box = (backend == CGV_RENDERER_CORE_PROFILE) ?
+                                       cgvScene3D::get_base_bytes_per_box() + cgvShaderRenderer::get_bytes_per_box() : 0;
+        pager.update(scene, camera, bytes_per_box);
+    }
+    if (mode == CGV_DISPLAY) receiver.apply(scene);
+    if (backend == CGV_RENDERER_CORE_PROFILE) {
+        shader_renderer.render(scene, camera, mode);
+        return;
+    }
+
+    // Apply the camera and projection transformations according to its parameters and to the mode (selection or visualization)
+    camera.apply();
 
-    getInstance().scene.assignSelection(pixels);
+    scene.render(mode);
+    if ((mode == CGV_DISPLAY) && pager.is_open()) pager.draw_bounds(camera);
+}
 
-    glutPostRedisplay();
+/**
+ * Write to stdout the number of OpenGL state changes issued and skipped by the last rendered frame, and the boxes
+ * culled in that frame by the occlusion culling
+ */
+void cgvInterface::print_state_counters() {
+    const char *names[CGV_STATE_NUM_GROUPS] = {"material", "color", "enable", "light", "client arrays"};
+    const cgvGLState &state = scene.get_gl_state();
 
+    printf("OpenGL state changes of the last frame (issued / skipped):\n");
+    for (int g = 0; g < CGV_STATE_NUM_GROUPS; ++g) {
+        printf("  %-14s %8lu / %8lu\n", names[g], state.get_issued((stateGroup) g), state.get_skipped((stateGroup) g));
+    }
+    printf("  %-14s %8lu / %8lu\n", "total", state.get_total_issued(), state.get_total_skipped());
 
-    glEnable(GL_LIGHTING);
+    if (scene.get_occlusion_culling()) {
+        printf("Occlusion queries of the last frame: %lu\n", scene.get_occlusion().get_num_queries());
+    }
+    if (scene.get_static_batching()) {
+        const cgvStaticBatch &batch = scene.get_static_batch();
+        printf("Static batch of the last frame:\n");
+        printf("  %-14s %8lu / %lu\n", "static", batch.get_num_static(), batch.get_num_static() + batch.get_num_dynamic());
+        printf("  %-14s %8lu\n", "written", batch.get_num_written());
+        printf("  %-14s %8lu / %lu\n", "chunks drawn", batch.get_num_drawn_chunks(), batch.get_num_chunks());
+    }
+    if (scene.get_layer_caching()) {
+        const cgvLayerCache &cache = scene.get_layer_cache();
+        printf("Static layer rendered in %lu of %lu frames\n", cache.get_num_static_renders(), cache.get_num_frames());
+    }
+    if (scene.get_partial_redraw()) {
+        const cgvLayerCache &cache = scene.get_frame_cache();
+        const cgvDirtyRegion &region = scene.get_dirty_region();
+        printf("Frame rendered in %lu of %lu frames, a region of it in %lu\n", cache.get_num_static_renders(),
+               cache.get_num_frames(), cache.get_num_region_renders());
+        printf("Dirty region of the last frame:\n");
+        printf("  %-14s %8lu\n", "changed boxes", region.get_num_changed());
+        printf("  %-14s %8lu\n", "redrawn boxes", region.get_num_redrawn());
+        printf("  %-14s %8lu\n", "pixels", region.get_num_pixels());
+    }
+    if (!updates_source.empty()) {
+        printf("Updates from %s%s:\n", updates_source.c_str(), receiver.is_receiving() ? "" : " (closed)");
+        printf("  %-14s %8lu\n", "received", receiver.get_num_received());
+        printf("  %-14s %8lu\n", "collapsed", receiver.get_num_collapsed());
+        printf("  %-14s %8lu\n", "applied", receiver.get_num_applied());
+        printf("  %-14s %8lu\n", "unknown boxes", receiver.get_num_unknown());
+        printf("  %-14s %8lu\n", "rejected", receiver.get_num_rejected());
+    }
+    if (frame_sink.is_open()) {
+        printf("Frames published in %s (%u slots, %s):\n", frame_sink.get_name().c_str(), frame_sink.get_num_slots(),
+               frame_sink.uses_pixel_buffers() ? "pixel buffers" : "synchronous read back");
+        printf("  %-14s %8lu\n", "captured", frame_sink.get_num_captured());
+        printf("  %-14s %8lu\n", "published", frame_sink.get_num_published());
+        printf("  %-14s %8lu\n", "dropped", frame_sink.get_num_dropped());
+    }
+    if (pager.is_open()) {
+        printf("Pages of %s (memory budget of %lu MB):\n", pages_path.c_str(), (unsigned long) (memory_budget >> 20));
+        printf("  %-14s %8u / %u\n", "resident", pager.get_num_resident_pages(), pager.get_num_pages());
+        printf("  %-14s %8u / %u\n", "boxes", pager.get_num_resident_boxes(), pager.get_max_resident_boxes());
+        printf("  %-14s %8u\n", "bytes per box", pager.get_bytes_per_box());
+        printf("  %-14s %8lu\n", "loads", pager.get_num_page_loads());
+        printf("  %-14s %8lu\n", "evictions", pager.get_num_page_evictions());
+        printf("  %-14s %8lu\n", "prefetched", pager.get_num_prefetched());
+    }
+    if (scene.get_impostors()) {
+        printf("Impostors of the last frame: %lu\n", scene.get_impostor_renderer().get_num_impostors());
+    }
+    if (scene.get_software_culling()) {
+        const cgvSoftwareOccluder &occlusion = scene.get_software_occlusion();
+        printf("Software occlusion culling of the last frame (%u threads):\n", occlusion.get_num_threads());
+        printf("  %-14s %8lu\n", "occluders", occlusion.get_num_occluders());
+        printf("  %-14s %8lu / %u\n", "occluded", occlusion.get_num_occluded(), scene.get_num_boxes());
+        printf("  %-14s %8lu / %u\n", "outside", occlusion.get_num_outside(), scene.get_num_boxes());
+    }
 }
@@ -12,17 +12,36 @@
 
 #include "cgvScene3D.h"
 #include "cgvCamera.h"
+#include "cgvSceneGenerator.h"
+#include "cgvShaderRenderer.h"
+#include "cgvSnapshot.h"
+#include "cgvSceneStreamer.h"
+#include "cgvPagedScene.h"
+#include "cgvFileWatcher.h"
+#include "cgvUpdateReceiver.h"
+#include "cgvFrameSink.h"
+#include "cgvSequenceExporter.h"
 
 using namespace std;
 
 
 
 
+/**
+ * cgvInterface renders a scene: it owns the scene, its camera and all the state needed to render it, so several
+ * instances can render in the same process, each one in its own OpenGL context (e.g. in parallel threads without a
+ * window, render_views). The events of a display window are forwarded to it by cgvGlutAdapter.
+ */
 class cgvInterface {
+	public:
+		static const int WATCH_INTERVAL = 200; ///< Milliseconds between two checks of the snapshot that was loaded
+		static const int UPDATE_INTERVAL = 16; ///< Milliseconds between two checks of the received updates
+
 	protected:
 		// Attributes
-		int width_window; ///< initial width of the display window
-		int height_window;  ///< initial height of the display window
+		int width_window=500; ///< initial width of the display window
+		int height_window=500;  ///< initial height of the display window
+		int max_width_window=0, max_height_window=0; ///< Maximum size the window can grow to (size of the screen)
 
 		cgvScene3D scene; ///< scene to be rendered in the display window defined by cgvInterface. 
 		cgvCamera camera; ///< Camera to visualize the scene
@@ -33,47 +52,74 @@ class cgvInterface {
 		int cursorX,cursorY; ///< pixel of the screen where the mouse is placed while clicking or dragging 
 		bool pressed_button=false; ///< button pressed (true) or released(false)
 
-		// Singleton pattern
-		static cgvInterface *instance; ///< Pointer to the unique instance of the class
-
-		// Default constructor
-		cgvInterface()=default;
+		cgvSceneGenerator generator; ///< Generator of the scene, when it is requested from the command line
+		bool generate_scene=false; ///< true: the scene is built by the generator, false: default scene of three boxes
+		string snapshot_path="scene.cgvsnap"; ///< Snapshot where the scene is saved ('w'), and loaded from with --load
+		bool load_snapshot=false; ///< true: the scene is loaded from snapshot_path
+		cgvSnapshot snapshot; ///< Writer of the snapshots
+		cgvSceneStreamer streamer; ///< Loader of the snapshot, while the scene is rendered
+		cgvFileWatcher watcher; ///< Watcher of the snapshot that was loaded, which is reloaded when it is written
+		string updates_source; ///< Input of the updates of the transformation of the boxes (--updates), empty: none
+		cgvUpdateReceiver receiver; ///< Receiver of the updates of updates_source, applied once per frame
+		string frames_name; ///< Shared memory where the rendered frames are published (--frames-shm), empty: none
+		cgvFrameSink frame_sink; ///< Ring of frames of frames_name
+		cgvSequenceExporter exporter; ///< Writer of the images (or hashes) of the views rendered without a window
+		double views_seconds=0; ///< Time spent rendering the views of the last render_views
+		string export_pattern; ///< Names of the images of the turntable exported without a window (--export), empty: none
+		uint32_t export_frames=360; ///< Frames of the turntable (--export-frames)
+		int export_width=500, export_height=500; ///< Size of the exported images (--export-size <width>x<height>)
+		string views_path; ///< Cameras of the views rendered without a window (--views), empty: a turntable
+		string title; ///< Title of the window
+		string pages_path; ///< Page file whose pages are loaded while the camera moves (--paged), empty: the scene is in memory
+		string write_pages_path; ///< Page file where the scene is written once it is built (--write-pages)
+		uint64_t memory_budget=256ull<<20; ///< Maximum memory of the resident boxes of the page file, in bytes (--memory-budget, in MB)
+		cgvPagedScene pager; ///< Resident pages of pages_path
+
+		rendererBackend backend=CGV_RENDERER_FIXED_FUNCTION; ///< OpenGL pipeline used to render the scene
+		cgvShaderRenderer shader_renderer; ///< Renderer of the scene with the core profile
+		cgvProgramCache program_cache; ///< Binaries of the programs of shader_renderer from previous executions
 
 	public:
-         // Singleton pattern
-        static cgvInterface& getInstance();
-
-		// Default destructor
+		// Default constructor and destructor
+		cgvInterface()=default;
 		~cgvInterface()=default;
 
-		// Static methods
-		// event callbacks
-		static void set_glutKeyboardFunc(unsigned char key, int x, int y); // method to control keyboard events
-		static void set_glutReshapeFunc(int w, int h); // method to define the camera and the viewport
-		                                               // it is automatically called when the window is resized
-		static void set_glutDisplayFunc(); // method to render the scene
+		cgvInterface(const cgvInterface&)=delete;
+		cgvInterface& operator=(const cgvInterface&)=delete;
 
-	///// Section A: methods to control the click and drag of the mouse
-		static void  set_glutMouseFunc(GLint button,GLint state,GLint x,GLint y); // control mouse clicking
-		static void  set_glutMotionFunc(GLint x,GLint y); // control the mouse movement while a button is pressed
+		// events of the display window, forwarded by cgvGlutAdapter
+		void key_pressed(unsigned char key); // toggle the options of the rendering
+		void resize(int w, int h); // define the camera and the viewport when the window is resized
+		bool render_frame(); // render the scene
+		bool needs_another_frame() const;
+		bool mouse_button(GLint button,GLint state,GLint x,GLint y); // Section A: control mouse clicking
+		bool mouse_motion(GLint x,GLint y); // control the mouse movement while a button is pressed
+		bool update_loading(); // add the loaded boxes to the scene while the snapshot is loaded
+		bool poll_changes(); // reload the snapshot when it is written and show the received updates
+		int get_poll_interval() const;
 
-		
 		// Methods
 		void init_selection();
 		void finish_selection();
 
+		void print_state_counters();
+		void render_scene();
+
 		
-		// create the world that is render in the window
-		void create_world(void);
-		// initialize all the parameters to create a display window
-		void configure_environment(int argc, char** argv, // main parameters
-			                       int _width_window, int _height_window, // width and height of the display window
-			                       int _pos_X, int _pos_Y, // init position of the display window
-													 string _title // title of the display window
-													 ); 
-		void init_callbacks(); // initialize all the callbacks
+		// read the options of the command line
+		bool parse_args(int argc, char** argv);
+		bool is_exporting() const { return !export_pattern.empty() || !views_path.empty(); };
 
-		void init_rendering_loop(); // render the scene and wait for an event in the interface
+		// create the world that is render in the window
+		bool init_renderer();
+		bool create_world(void);
+		void frame_scene();
+		void save_snapshot();
+		void reload_snapshot();
+		void write_pages();
+		bool render_views();
+		bool export_sequence();
+		void init_gl_state();
 
 		// methods get_ and set_ to access the attributes
 		int get_width_window(){return width_window;};
@@ -81,6 +127,19 @@ class cgvInterface {
 
 		void set_width_window(int _width_window){width_window = _width_window;};
 		void set_height_window(int _height_window){height_window = _height_window;};
+		void set_max_window_size(int _width, int _height){max_width_window = _width; max_height_window = _height;};
+
+		string get_window_title() const;
+		void set_title(const string &_title){title = _title;};
+
+		rendererBackend get_backend() const {return backend;};
+		void set_backend(rendererBackend _backend){backend = _backend;};
+		bool is_loading() const {return streamer.is_loading();};
+
+		/**
+		 * @retval Hash of the image of each view of the last render_views without --export
+		 */
+		const vector<uint64_t> &get_view_hashes() const {return exporter.get_hashes();};
 };
 
 
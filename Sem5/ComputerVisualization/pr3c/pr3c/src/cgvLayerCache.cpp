@@ -0,0 +1,195 @@
+#include <stdio.h>
+
+#include "cgvLayerCache.h"
+#include "cgvGLState.h"
+
+/**
+ * Destructor. The framebuffer is released
+ * @pre The context where it was created must be current
+ */
+cgvLayerCache::~cgvLayerCache() {
+	destroy();
+}
+
+/**
+ * Prepare the layer for a frame
+ * @param _key State of the scene that is rendered in the static layer
+ * @retval true if the layer can be used in this frame. Then the static layer must be rendered if needs_static(), and
+ * composite() must be called before rendering the moving boxes
+ * @pre The viewport and the framebuffer of the frame have been set. The first call (and the first one after a change
+ * of the size of the viewport) creates the offscreen framebuffer
+ */
+bool cgvLayerCache::begin_frame(const layerKey &_key) {
+	stale = false;
+	if (init_failed) return false;
+#ifdef CGV_HAVE_CORE_PROFILE
+	GLint _target = 0;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_target);
+	if (!framebuffer || (viewport[2] != width) || (viewport[3] != height) || (_target != target)) {
+		target = _target;
+		if (!create(viewport[2], viewport[3])) {
+			destroy();
+			init_failed = true;
+			return false;
+		}
+	}
+
+	stale = !valid || (key != _key);
+	key = _key;
+	valid = true;
+	++n_frames;
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Start rendering the static layer
+ * @post The offscreen framebuffer is bound and cleared (with the current clear color), with a viewport of its size
+ */
+void cgvLayerCache::begin_static() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+#endif
+}
+
+/**
+ * Finish rendering the static layer
+ * @post The framebuffer and the viewport of the frame are restored
+ */
+void cgvLayerCache::end_static() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	++n_static_renders;
+#endif
+}
+
+/**
+ * Start rendering a region of the static layer
+ * @param rectangle Region: x, y, width and height in pixels of the layer
+ * @post The offscreen framebuffer is bound with a viewport of its size. Only the region is cleared, and only the region
+ * will be drawn (scissor test)
+ */
+void cgvLayerCache::begin_region(const GLint rectangle[4]) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(rectangle[0], rectangle[1], rectangle[2], rectangle[3]);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+#endif
+}
+
+/**
+ * Finish rendering a region of the static layer
+ * @post The scissor test is disabled, and the framebuffer and the viewport of the frame are restored
+ */
+void cgvLayerCache::end_region() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	++n_region_renders;
+#endif
+}
+
+/**
+ * Copy the color and the depth of the static layer to the viewport of the frame
+ * @post The content of the viewport is replaced. The framebuffer of the frame is bound for reading and drawing
+ */
+void cgvLayerCache::composite() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+	glBlitFramebuffer(0, 0, width, height, viewport[0], viewport[1], viewport[0] + width, viewport[1] + height,
+	                  GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+#endif
+}
+
+/**
+ * Release the offscreen framebuffer
+ * @post The static layer will be rendered again in the next frame
+ */
+void cgvLayerCache::destroy() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+	if (color_buffer) glDeleteRenderbuffers(1, &color_buffer);
+	if (depth_buffer) glDeleteRenderbuffers(1, &depth_buffer);
+#endif
+	framebuffer = color_buffer = depth_buffer = 0;
+	width = height = 0;
+	valid = false;
+}
+
+/**
+ * Create the offscreen framebuffer, with the formats of the framebuffer of the frame (target)
+ * @param _width Width of the viewport
+ * @param _height Height of the viewport
+ * @retval true if it has been created, and its depth can be copied to the one of the frame. Otherwise, the reason is
+ * written to stderr
+ */
+bool cgvLayerCache::create(GLint _width, GLint _height) {
+	destroy();
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (!cgvGLState::supports(3, 0, "GL_ARB_framebuffer_object")) {
+		fprintf(stderr, "cgvLayerCache: framebuffer objects are not supported, the layers are not cached\n");
+		return false;
+	}
+
+	GLint sample_buffers = 0, depth_bits = 0, stencil_bits = 0;
+	glGetIntegerv(GL_SAMPLE_BUFFERS, &sample_buffers);
+	glGetIntegerv(GL_DEPTH_BITS, &depth_bits);
+	glGetIntegerv(GL_STENCIL_BITS, &stencil_bits);
+	if (sample_buffers > 0) {
+		fprintf(stderr, "cgvLayerCache: the framebuffer is multisampled, the layers are not cached\n");
+		return false;
+	}
+	if (stencil_bits > 0) {
+		depth_format = GL_DEPTH24_STENCIL8;
+	} else {
+		depth_format = (depth_bits > 24) ? GL_DEPTH_COMPONENT32 : ((depth_bits > 16) ? GL_DEPTH_COMPONENT24 : GL_DEPTH_COMPONENT16);
+	}
+
+	width = _width;
+	height = _height;
+	glGenRenderbuffers(1, &color_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depth_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, depth_format, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, (stencil_bits > 0) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+	                          GL_RENDERBUFFER, depth_buffer);
+	const bool complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	if (!complete) {
+		fprintf(stderr, "cgvLayerCache: the framebuffer of %dx%d is not complete, the layers are not cached\n", width,
+		        height);
+		return false;
+	}
+
+	// the copy of the depth fails if the formats are not the same. The pixel copied here is replaced by composite()
+	while (glGetError() != GL_NO_ERROR) {}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBlitFramebuffer(0, 0, 1, 1, 0, 0, 1, 1, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	if (glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "cgvLayerCache: the depth of the frame cannot be copied, the layers are not cached\n");
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+/**
+ * cgvLayerCache keeps the static layer of a frame (everything but the boxes that are being moved) in an offscreen
+ * framebuffer with color and depth, the size of the viewport. The layer is rendered again only when something it
+ * depends on changes (a key given by the scene, and the viewport); in the rest of the frames its color and depth are
+ * copied to the framebuffer of the frame (glBlitFramebuffer), and only the moving boxes are rendered over them.
+ * The depth buffer of the layer has the format of the one of the frame, as glBlitFramebuffer requires.
+ * The layer can also hold a whole frame, where only some regions are drawn again (begin_region and end_region).
+ */
+class cgvLayerCache {
+public:
+	static const int KEY_SIZE = 7; ///< Values of the key of the static layer
+	typedef std::array<unsigned long, KEY_SIZE> layerKey; ///< State of the scene rendered in the static layer
+
+private:
+	GLuint framebuffer = 0, color_buffer = 0, depth_buffer = 0; ///< Offscreen framebuffer of the static layer
+	GLint width = 0, height = 0; ///< Size of the framebuffer
+	GLenum depth_format = 0; ///< Internal format of its depth buffer
+	bool init_failed = false; ///< The layer cannot be used with the framebuffer of the frame
+
+	GLint target = 0; ///< Draw framebuffer of the frame
+	GLint viewport[4] = {0, 0, 0, 0}; ///< Viewport of the frame
+	layerKey key = {}; ///< Key of the content of the static layer
+	bool valid = false; ///< The static layer has been rendered with key
+	bool stale = false; ///< The static layer must be rendered in this frame
+
+	unsigned long n_static_renders = 0; ///< Number of times the static layer has been rendered
+	unsigned long n_region_renders = 0; ///< Number of times a region of the static layer has been rendered
+	unsigned long n_frames = 0; ///< Number of frames that have used the layer
+
+public:
+	cgvLayerCache() = default;
+	~cgvLayerCache();
+
+	cgvLayerCache(const cgvLayerCache&) = delete;
+	cgvLayerCache& operator=(const cgvLayerCache&) = delete;
+
+	bool begin_frame(const layerKey &_key);
+	void begin_static();
+	void end_static();
+	void begin_region(const GLint rectangle[4]);
+	void end_region();
+	void composite();
+
+	/**
+	 * Force the static layer to be rendered in the next frame
+	 */
+	void invalidate() { valid = false; };
+	void destroy();
+
+	/**
+	 * @retval true if the static layer must be rendered in this frame (between begin_static and end_static)
+	 */
+	bool needs_static() const { return stale; };
+
+	unsigned long get_num_static_renders() const { return n_static_renders; };
+	unsigned long get_num_region_renders() const { return n_region_renders; };
+	unsigned long get_num_frames() const { return n_frames; };
+
+private:
+	bool create(GLint _width, GLint _height);
+};
@@ -0,0 +1,90 @@
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cgvMappedFile.h"
+
+/**
+ * Destructor. The file is unmapped
+ */
+cgvMappedFile::~cgvMappedFile() {
+#ifndef _WIN32
+	if (data) munmap((void *) data, size);
+#endif
+}
+
+/**
+ * Map a file
+ * @param path Path of the file
+ * @param sequential true if the file will be read from the beginning to the end, false if it will be read in parts
+ * in any order
+ * @retval true if the file exists and is not empty
+ * @pre No file has been mapped by this object
+ */
+bool cgvMappedFile::open(const std::string &path, bool sequential) {
+#ifdef _WIN32
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) return false;
+	fseek(file, 0, SEEK_END);
+	const long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (length > 0) {
+		buffer.resize((size_t) length);
+		if (fread(buffer.data(), buffer.size(), 1, file) != 1) buffer.clear();
+	}
+	fclose(file);
+	data = buffer.data();
+	size = buffer.size();
+	return size > 0;
+#else
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) return false;
+	struct stat info;
+	if ((fstat(file, &info) == 0) && (info.st_size > 0)) {
+		void *mapping = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping != MAP_FAILED) {
+			data = (const uint8_t *) mapping;
+			size = (size_t) info.st_size;
+			madvise(mapping, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+		}
+	}
+	close(file);
+	return data != nullptr;
+#endif
+}
+
+/**
+ * Ask the operating system to start loading a part of the file in the background
+ * @param offset First byte of the part
+ * @param length Bytes of the part
+ */
+void cgvMappedFile::prefetch(size_t offset, size_t length) const {
+#ifndef _WIN32
+	// madvise requires addresses aligned to the pages of the system
+	const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	const size_t first = offset / page * page;
+	if ((length == 0) || (offset + length > size)) return;
+	madvise((void *) (data + first), offset + length - first, MADV_WILLNEED);
+#endif
+}
+
+/**
+ * Let the operating system drop from memory a part of the file. It is loaded again if it is accessed later
+ * @param offset First byte of the part
+ * @param length Bytes of the part
+ * @post Only the pages of the system completely inside the part are dropped, as the rest can be shared with other
+ * parts
+ */
+void cgvMappedFile::release(size_t offset, size_t length) const {
+#ifndef _WIN32
+	const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	const size_t first = (offset + page - 1) / page * page, last = (offset + length) / page * page;
+	if ((offset + length > size) || (last <= first)) return;
+	madvise((void *) (data + first), last - first, MADV_DONTNEED);
+#endif
+}
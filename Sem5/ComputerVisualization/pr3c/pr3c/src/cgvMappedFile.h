@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * cgvMappedFile maps the content of a file in memory (read-only) while the object exists. On Windows, the file is
+ * read into memory instead. The operating system only loads the parts of the file that are accessed; release() lets
+ * it drop them again, so that files larger than the memory can be accessed in parts.
+ */
+class cgvMappedFile {
+	const uint8_t *data = nullptr; ///< First byte of the file
+	size_t size = 0; ///< Size of the file
+#ifdef _WIN32
+	std::vector<uint8_t> buffer; ///< Content of the file
+#endif
+
+public:
+	cgvMappedFile() = default;
+	~cgvMappedFile();
+
+	cgvMappedFile(const cgvMappedFile&) = delete;
+	cgvMappedFile& operator=(const cgvMappedFile&) = delete;
+
+	bool open(const std::string &path, bool sequential = true);
+	void prefetch(size_t offset, size_t length) const;
+	void release(size_t offset, size_t length) const;
+
+	const uint8_t *get_data() const { return data; };
+	size_t get_size() const { return size; };
+
+	/**
+	 * @retval true if the host stores numbers in little-endian order, the order of the binary files of the scenes
+	 */
+	static bool is_little_endian() {
+		const uint16_t one = 1;
+		uint8_t first;
+		memcpy(&first, &one, 1);
+		return first == 1;
+	}
+};
@@ -0,0 +1,301 @@
+#include <cmath>
+
+#include "cgvOcclusionCuller.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+static const float pi = 3.14159265358979f;
+
+/// Scale of the unit cube tested for a box: the bounding box of the body and the top piece, slightly larger
+static const float box_query_scale[3] = {1.17f, 1.02f, 2.07f};
+
+/**
+ * @param near_plane Near plane of the camera, pointing inwards (cgvCamera::get_frustum_planes)
+ * @param eye Position of the camera
+ * @param center Center of an axis-aligned bounding box
+ * @param half Half of the size of the bounding box along each axis
+ * @retval true if the bounding box contains the camera or crosses the near plane
+ */
+static bool touches_camera(const float near_plane[4], const cgvPoint3D &eye, const float center[3], const float half[3]) {
+	bool contains = true;
+	float distance = near_plane[3], extent = 0;
+	for (int i = X; i <= Z; ++i) {
+		contains = contains && (fabsf(eye[i] - center[i]) <= half[i]);
+		distance += near_plane[i] * center[i];
+		extent += fabsf(near_plane[i]) * half[i];
+	}
+	return contains || (fabsf(distance) <= extent);
+}
+
+/**
+ * Destructor. The queries are released
+ * @pre The context where the queries were created must be current
+ */
+cgvOcclusionCuller::~cgvOcclusionCuller() {
+	destroy();
+}
+
+/**
+ * Release the queries
+ * @post Every box is considered visible
+ */
+void cgvOcclusionCuller::destroy() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	for (std::vector<queryState> *objects : { &clusters, &boxes }) {
+		for (queryState &object : *objects) {
+			if (object.query) glDeleteQueries(1, &object.query);
+		}
+	}
+#endif
+	clusters.clear();
+	boxes.clear();
+	cluster_boxes.clear();
+	box_cluster.clear();
+	cluster_min.clear();
+	cluster_max.clear();
+	pending_clusters.clear();
+	pending_boxes.clear();
+	scene_revision = 0;
+}
+
+/**
+ * Prepare the visibility of the boxes for a new frame
+ * @param scene Scene to be rendered
+ * @param _view_revision Revision of the camera of the frame
+ * @post The clusters are built again if boxes have been added or removed, and their bounds are computed again if
+ * boxes have been moved. The results of the queries of previous frames that are already available are read, without
+ * waiting for the rest
+ */
+void cgvOcclusionCuller::begin_frame(const cgvScene3D &scene, unsigned long _view_revision) {
+	++frame;
+	n_queries = 0;
+	n_changes = 0;
+
+	if (scene.get_revision() != scene_revision) {
+		build_clusters(scene);
+	} else if (scene.get_num_box_moves() != box_moves) {
+		compute_bounds(scene);
+	}
+
+	for (size_t p = 0; p < pending_clusters.size();) {
+		const uint32_t c = pending_clusters[p];
+		const bool was_visible = clusters[c].visible;
+		if (!read_result(clusters[c])) {
+			++p;
+			continue;
+		}
+		if (!was_visible && clusters[c].visible) {
+			// its boxes have not been tested while the cluster was hidden: they are rendered and tested again
+			for (uint32_t i = c * CLUSTER_SIZE; (i < (c + 1) * CLUSTER_SIZE) && (i < boxes.size()); ++i) {
+				boxes[cluster_boxes[i]].visible = true;
+			}
+		}
+		pending_clusters[p] = pending_clusters.back();
+		pending_clusters.pop_back();
+	}
+	for (size_t p = 0; p < pending_boxes.size();) {
+		if (read_result(boxes[pending_boxes[p]])) {
+			pending_boxes[p] = pending_boxes.back();
+			pending_boxes.pop_back();
+		} else {
+			++p;
+		}
+	}
+
+	// the visibility needs a couple of frames to settle after any change
+	const bool changed = (_view_revision != view_revision) || (scene.get_num_box_changes() != box_changes) ||
+	                     (n_changes > 0);
+	view_revision = _view_revision;
+	box_changes = scene.get_num_box_changes();
+	settle_frames = changed ? 2 : ((settle_frames > 0) ? settle_frames - 1 : 0);
+}
+
+/**
+ * Issue the occlusion queries of the frame, against the depth buffer of the boxes already rendered
+ * @param scene Scene that has been rendered
+ * @param camera Camera of the frame (optional)
+ * @param state OpenGL state, used to draw the bounding boxes
+ * @pre begin_frame() has been called in this frame and the visible boxes have been rendered. The modelview matrix is
+ * the one of the scene
+ * @post The bounding boxes are tested without changing the color and depth buffers. The hidden objects are tested
+ * and, every RETEST_INTERVAL frames, also the visible ones. The boxes of hidden clusters are not tested. With a
+ * camera, the objects whose bounding box contains it or crosses its near plane are made visible without a query
+ */
+void cgvOcclusionCuller::issue_queries(const cgvScene3D &scene, const cgvCamera *camera, cgvGLState &state) {
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+
+	float planes[6][4];
+	cgvPoint3D eye, reference, up;
+	if (camera) {
+		camera->get_frustum_planes(planes);
+		camera->getCameraParameters(eye, reference, up);
+	}
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+
+	for (uint32_t c = 0; c < clusters.size(); ++c) {
+		queryState &cluster = clusters[c];
+		const float center[3] = {(cluster_min[c][X] + cluster_max[c][X]) / 2, (cluster_min[c][Y] + cluster_max[c][Y]) / 2,
+		                         (cluster_min[c][Z] + cluster_max[c][Z]) / 2};
+		const float half[3] = {(cluster_max[c][X] - cluster_min[c][X]) / 2, (cluster_max[c][Y] - cluster_min[c][Y]) / 2,
+		                       (cluster_max[c][Z] - cluster_min[c][Z]) / 2};
+		if (!cluster.pending && camera && touches_camera(planes[4], eye, center, half)) {
+			if (!cluster.visible) {
+				// its boxes have not been tested while the cluster was hidden
+				reveal(cluster);
+				for (uint32_t i = c * CLUSTER_SIZE; (i < (c + 1) * CLUSTER_SIZE) && (i < boxes.size()); ++i) {
+					boxes[cluster_boxes[i]].visible = true;
+				}
+			}
+		} else if (!cluster.pending && (!cluster.visible || ((frame + c) % RETEST_INTERVAL == 0))) {
+			glPushMatrix();
+			glTranslatef(center[X], center[Y], center[Z]);
+			glScalef(2 * half[X], 2 * half[Y], 2 * half[Z]);
+			begin_query(cluster, pending_clusters, c);
+			cgvBox::draw_unit_cube(state);
+			end_query();
+			glPopMatrix();
+		}
+		if (!cluster.visible) continue;
+
+		for (uint32_t i = c * CLUSTER_SIZE; (i < (c + 1) * CLUSTER_SIZE) && (i < boxes.size()); ++i) {
+			const uint32_t b = cluster_boxes[i];
+			queryState &box = boxes[b];
+			if (box.pending || (box.visible && ((frame + b) % RETEST_INTERVAL != 0))) continue;
+
+			if (camera) {
+				// axis-aligned bounding box of the rotated bounding box
+				const float angle = rotations[b][0] * pi / 180;
+				const float c_a = fabsf(cosf(angle)), s_a = fabsf(sinf(angle));
+				const float half_box[3] = {(c_a * box_query_scale[X] + s_a * box_query_scale[Z]) / 2, box_query_scale[Y] / 2,
+				                           (s_a * box_query_scale[X] + c_a * box_query_scale[Z]) / 2};
+				const float center_box[3] = {positions[b][X], positions[b][Y], positions[b][Z]};
+				if (touches_camera(planes[4], eye, center_box, half_box)) {
+					if (!box.visible) reveal(box);
+					continue;
+				}
+			}
+
+			// bounding box of the body and the top piece, with the transformation of the box. It is slightly larger,
+			// so that its faces are not coplanar with the ones of the box (they could be rasterized behind them)
+			glPushMatrix();
+			glTranslatef(positions[b][X], positions[b][Y], positions[b][Z]);
+			glRotatef(rotations[b][0], 0, 1, 0);
+			glScalef(box_query_scale[X], box_query_scale[Y], box_query_scale[Z]);
+			begin_query(box, pending_boxes, b);
+			cgvBox::draw_unit_cube(state);
+			end_query();
+			glPopMatrix();
+		}
+	}
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/**
+ * Compute the clusters of the boxes of a scene: the boxes are sorted along a Morton curve over the bounding box of
+ * the scene, and every CLUSTER_SIZE consecutive boxes of the curve form a cluster
+ * @param scene The scene
+ * @post Every cluster and every box is visible, without pending queries
+ */
+void cgvOcclusionCuller::build_clusters(const cgvScene3D &scene) {
+	destroy();
+	scene_revision = scene.get_revision();
+
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const uint32_t n_boxes = (uint32_t) positions.size();
+	const uint32_t n_clusters = (n_boxes + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+	boxes.resize(n_boxes);
+	clusters.resize(n_clusters);
+	cluster_min.resize(n_clusters);
+	cluster_max.resize(n_clusters);
+	if (n_boxes == 0) return;
+
+	scene.get_morton_order(cluster_boxes);
+	box_cluster.resize(n_boxes);
+	for (uint32_t i = 0; i < n_boxes; ++i) box_cluster[cluster_boxes[i]] = i / CLUSTER_SIZE;
+	compute_bounds(scene);
+}
+
+/**
+ * Compute the bounding box of each cluster from the current positions of its boxes
+ * @param scene The scene, with the same boxes of the clusters
+ */
+void cgvOcclusionCuller::compute_bounds(const cgvScene3D &scene) {
+	box_moves = scene.get_num_box_moves();
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const uint32_t n_boxes = (uint32_t) positions.size();
+	const uint32_t n_clusters = (uint32_t) clusters.size();
+	const float radius = cgvBox::bounding_radius();
+	for (uint32_t c = 0; c < n_clusters; ++c) {
+		cgvPoint3D min = positions[cluster_boxes[c * CLUSTER_SIZE]], max = min;
+		for (uint32_t b = c * CLUSTER_SIZE + 1; (b < (c + 1) * CLUSTER_SIZE) && (b < n_boxes); ++b) {
+			const cgvPoint3D &p = positions[cluster_boxes[b]];
+			for (int i = X; i <= Z; ++i) {
+				if (p[i] < min[i]) min[i] = p[i];
+				if (p[i] > max[i]) max[i] = p[i];
+			}
+		}
+		cluster_min[c].set(min[X] - radius, min[Y] - radius, min[Z] - radius);
+		cluster_max[c].set(max[X] + radius, max[Y] + radius, max[Z] + radius);
+	}
+}
+
+/**
+ * Read the result of the query of an object, if it is available
+ * @param state Visibility of the object, with a pending query
+ * @retval true if the result has been read
+ */
+bool cgvOcclusionCuller::read_result(queryState &state) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return false;
+
+	GLuint samples = 0;
+	glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &samples);
+	if ((samples > 0) != state.visible) ++n_changes;
+	state.visible = samples > 0;
+#endif
+	state.pending = false;
+	return true;
+}
+
+/**
+ * Make visible a hidden object without a query
+ * @param state Visibility of the object, without a pending query
+ * @post Another frame is needed to render the object
+ */
+void cgvOcclusionCuller::reveal(queryState &state) {
+	state.visible = true;
+	++n_changes;
+	if (settle_frames < 1) settle_frames = 1;
+}
+
+/**
+ * Start the occlusion query of an object
+ * @param state Visibility of the object
+ * @param pending List of objects with pending queries where the object is added
+ * @param index Index of the object
+ * @post The samples of the geometry rendered until end_query() are counted
+ */
+void cgvOcclusionCuller::begin_query(queryState &state, std::vector<uint32_t> &pending, uint32_t index) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (!state.query) glGenQueries(1, &state.query);
+	glBeginQuery(GL_SAMPLES_PASSED, state.query);
+	state.pending = true;
+	pending.push_back(index);
+	++n_queries;
+#endif
+}
+
+/**
+ * Finish the occlusion query started by begin_query()
+ */
+void cgvOcclusionCuller::end_query() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	glEndQuery(GL_SAMPLES_PASSED);
+#endif
+}
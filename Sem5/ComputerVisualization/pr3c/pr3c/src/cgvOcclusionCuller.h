@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include "cgvGLState.h"
+#include "cgvPoint.h"
+
+class cgvScene3D;
+class cgvCamera;
+
+/**
+ * cgvOcclusionCuller decides which boxes of a scene are hidden by other boxes, with occlusion queries of the
+ * fixed-function pipeline (GL_SAMPLES_PASSED) against bounding boxes.
+ * The boxes are grouped in clusters of nearby boxes (consecutive in Morton order). A box is rendered if its cluster and the box itself were
+ * visible the last time they were tested. The results of the queries are read one frame later, only if they are
+ * already available, so the CPU never waits for the GPU. The hidden objects are tested in every frame, and the
+ * visible ones every RETEST_INTERVAL frames (in different frames for each object). The objects whose bounding box
+ * contains the camera or crosses the near plane are visible without a query: their bounding box would be clipped,
+ * and the query would not pass any sample.
+ */
+class cgvOcclusionCuller {
+public:
+	static const uint32_t CLUSTER_SIZE = 64; ///< Maximum number of boxes of a cluster
+	static const unsigned int RETEST_INTERVAL = 8; ///< Frames between two tests of a visible object
+
+private:
+	/**
+	 * Visibility of a cluster or a box
+	 */
+	struct queryState {
+		GLuint query = 0; ///< Occlusion query
+		bool visible = true; ///< Result of the last test
+		bool pending = false; ///< The query has been issued and its result has not been read yet
+	};
+
+	std::vector<queryState> clusters; ///< Visibility of each cluster
+	std::vector<queryState> boxes; ///< Visibility of each box
+	std::vector<uint32_t> cluster_boxes; ///< Boxes sorted by cluster: cluster c has the CLUSTER_SIZE boxes from c * CLUSTER_SIZE
+	std::vector<uint32_t> box_cluster; ///< Cluster of each box
+	std::vector<cgvPoint3D> cluster_min, cluster_max; ///< Axis-aligned bounding box of each cluster
+	std::vector<uint32_t> pending_clusters, pending_boxes; ///< Objects whose query has not been read
+
+	unsigned long scene_revision = 0; ///< Revision of the scene of the clusters
+	unsigned long view_revision = 0; ///< Revision of the camera of the last frame
+	unsigned long box_changes = 0; ///< Number of changes of the boxes of the scene in the last frame
+	unsigned long box_moves = 0; ///< Number of changes of position of the boxes of the scene of the bounds of the clusters
+	unsigned long frame = 0; ///< Number of frames rendered
+	int settle_frames = 0; ///< Frames still needed to get the final visibility after a change
+
+	unsigned long n_queries = 0; ///< Queries issued in the last frame
+	unsigned long n_changes = 0; ///< Objects whose visibility changed in the last frame
+
+public:
+	cgvOcclusionCuller() = default;
+	~cgvOcclusionCuller();
+
+	cgvOcclusionCuller(const cgvOcclusionCuller&) = delete;
+	cgvOcclusionCuller& operator=(const cgvOcclusionCuller&) = delete;
+
+	void begin_frame(const cgvScene3D &scene, unsigned long _view_revision);
+	void issue_queries(const cgvScene3D &scene, const cgvCamera *camera, cgvGLState &state);
+	void destroy();
+
+	/**
+	 * @param box Index of a box
+	 * @retval false if the box was hidden the last time it was tested (or its cluster was)
+	 */
+	bool is_visible(uint32_t box) const {
+		return (box >= boxes.size()) || (clusters[box_cluster[box]].visible && boxes[box].visible);
+	}
+
+	/**
+	 * @retval true while the visibility is still changing because of a change of the view or of the scene: another
+	 * frame must be rendered to show the boxes that have become visible
+	 */
+	bool needs_another_frame() const { return settle_frames > 0; };
+
+	unsigned long get_num_queries() const { return n_queries; };
+	unsigned long get_num_changes() const { return n_changes; };
+	/**
+	 * @retval Memory of the visibility of a box, and of its share of a cluster (rounded up)
+	 */
+	static uint32_t get_bytes_per_box() {
+		return (uint32_t) (sizeof(queryState) + 3 * sizeof(uint32_t) +
+		                   (sizeof(queryState) + 2 * sizeof(cgvPoint3D) + sizeof(uint32_t) + CLUSTER_SIZE - 1) / CLUSTER_SIZE);
+	};
+
+private:
+	void build_clusters(const cgvScene3D &scene);
+	void compute_bounds(const cgvScene3D &scene);
+	bool read_result(queryState &state);
+	void reveal(queryState &state);
+	void begin_query(queryState &state, std::vector<uint32_t> &pending, uint32_t index);
+	void end_query();
+};
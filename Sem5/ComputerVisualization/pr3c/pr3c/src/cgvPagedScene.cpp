@@ -0,0 +1,601 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "cgvPagedScene.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+static const char page_file_magic[8] = {'C', 'G', 'V', 'P', 'A', 'G', 'E', 0}; ///< First bytes of a page file
+static const uint64_t column_alignment = 64; ///< Alignment of the table of pages and of the columns in the file
+static const uint32_t element_sizes[3] = {sizeof(cgvBox), sizeof(cgvPoint3D), sizeof(array<GLfloat, 2>)}; ///< Bytes per box of each column
+
+/**
+ * Header of a page file, at the beginning of the file
+ */
+struct cgvPageFileHeader {
+	char magic[8]; ///< page_file_magic
+	uint32_t version; ///< cgvPagedScene::VERSION
+	uint32_t header_size; ///< sizeof(cgvPageFileHeader)
+	uint64_t file_size; ///< Size of the whole file
+	uint32_t n_boxes; ///< Number of boxes
+	uint32_t n_pages; ///< Number of pages
+	uint32_t page_size; ///< cgvPagedScene::PAGE_SIZE
+	uint32_t reserved; ///< 0
+	float min[3]; ///< Minimum corner of the bounding box of the scene
+	float max[3]; ///< Maximum corner of the bounding box of the scene
+	uint64_t page_table; ///< Offset of the table of pages
+	uint64_t columns[3]; ///< Offset of the columns of the boxes, positions and rotations
+};
+
+static_assert(sizeof(cgvPageFileHeader) == 96, "the header of a page file must not have padding");
+
+/**
+ * @param offset Position in the file
+ * @retval The first position aligned to column_alignment from offset
+ */
+static uint64_t align_offset(uint64_t offset) {
+	return (offset + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+/**
+ * @param planes Planes of a view volume, pointing inwards
+ * @param min Minimum corner of a bounding box
+ * @param max Maximum corner of a bounding box
+ * @retval true if the bounding box is not completely outside any plane
+ */
+static bool intersects(const float planes[6][4], const float min[3], const float max[3]) {
+	for (int p = 0; p < 6; ++p) {
+		float d = planes[p][3];
+		for (int i = X; i <= Z; ++i) d += planes[p][i] * ((planes[p][i] > 0) ? max[i] : min[i]);
+		if (d < 0) return false;
+	}
+	return true;
+}
+
+/**
+ * @param eye A point
+ * @param min Minimum corner of a bounding box
+ * @param max Maximum corner of a bounding box
+ * @retval Squared distance from the point to the bounding box (0 if it is inside)
+ */
+static float squared_distance(const cgvPoint3D &eye, const float min[3], const float max[3]) {
+	float d = 0;
+	for (int i = X; i <= Z; ++i) {
+		const float v = (eye[i] < min[i]) ? min[i] - eye[i] : ((eye[i] > max[i]) ? eye[i] - max[i] : 0);
+		d += v * v;
+	}
+	return d;
+}
+
+/**
+ * Write the page file of a scene
+ * @param path Path of the file. It is replaced only when the whole file has been written
+ * @param scene The scene, with every box
+ * @retval true if the file has been written. Otherwise, the reason is written to stderr
+ */
+bool cgvPagedScene::write(const std::string &path, const cgvScene3D &scene) {
+	if (!cgvMappedFile::is_little_endian()) {
+		fprintf(stderr, "cgvPagedScene: the page files can only be written in little-endian hosts\n");
+		return false;
+	}
+
+	const uint32_t _n_boxes = scene.get_num_boxes();
+	std::vector<uint32_t> order;
+	scene.get_morton_order(order);
+
+	cgvPageFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, page_file_magic, sizeof(page_file_magic));
+	header.version = VERSION;
+	header.header_size = sizeof(header);
+	header.n_boxes = _n_boxes;
+	header.n_pages = (_n_boxes + PAGE_SIZE - 1) / PAGE_SIZE;
+	header.page_size = PAGE_SIZE;
+	cgvPoint3D min, max;
+	scene.get_bounds(min, max);
+	for (int i = X; i <= Z; ++i) {
+		header.min[i] = min[i];
+		header.max[i] = max[i];
+	}
+	header.page_table = align_offset(sizeof(header));
+	uint64_t offset = header.page_table + sizeof(page) * (uint64_t) header.n_pages;
+	for (int c = 0; c < 3; ++c) {
+		header.columns[c] = offset = align_offset(offset);
+		offset += (uint64_t) element_sizes[c] * _n_boxes;
+	}
+	header.file_size = offset;
+
+	// consecutive boxes in Morton order are near each other
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const float radius = cgvBox::bounding_radius();
+	std::vector<page> table(header.n_pages);
+	for (uint32_t p = 0; p < header.n_pages; ++p) {
+		page &pg = table[p];
+		pg.first = p * PAGE_SIZE;
+		pg.n_boxes = std::min(PAGE_SIZE, _n_boxes - pg.first);
+		for (int i = X; i <= Z; ++i) {
+			pg.min[i] = positions[order[pg.first]][i];
+			pg.max[i] = pg.min[i];
+		}
+		for (uint32_t k = pg.first; k < pg.first + pg.n_boxes; ++k) {
+			for (int i = X; i <= Z; ++i) {
+				pg.min[i] = std::min(pg.min[i], positions[order[k]][i]);
+				pg.max[i] = std::max(pg.max[i], positions[order[k]][i]);
+			}
+		}
+		for (int i = X; i <= Z; ++i) {
+			pg.min[i] -= radius;
+			pg.max[i] += radius;
+		}
+	}
+
+#ifdef _WIN32
+	const std::string temporary = path + "." + std::to_string(_getpid());
+#else
+	const std::string temporary = path + "." + std::to_string(getpid());
+#endif
+	FILE *out = fopen(temporary.c_str(), "wb");
+	if (!out) {
+		fprintf(stderr, "cgvPagedScene: unable to write %s\n", temporary.c_str());
+		return false;
+	}
+
+	const char padding[column_alignment] = {0};
+	uint64_t written = 0;
+	auto write_at = [&](uint64_t position, const void *bytes, size_t length) {
+		const size_t gap = (size_t) (position - written);
+		written = position + length;
+		return (fwrite(padding, 1, gap, out) == gap) && ((length == 0) || (fwrite(bytes, length, 1, out) == 1));
+	};
+	bool ok = write_at(0, &header, sizeof(header)) &&
+	          write_at(header.page_table, table.data(), sizeof(page) * table.size());
+
+	// the columns are written in parts, in the order of the pages
+	std::vector<uint8_t> part;
+	for (int c = 0; ok && (c < 3); ++c) {
+		const uint8_t *column = (c == 0) ? (const uint8_t *) scene.get_boxes().data() :
+		                        ((c == 1) ? (const uint8_t *) positions.data() :
+		                                    (const uint8_t *) scene.get_rotations().data());
+		for (uint32_t first = 0; ok && (first < _n_boxes); first += PAGE_SIZE) {
+			const uint32_t n = std::min(PAGE_SIZE, _n_boxes - first);
+			part.resize((size_t) element_sizes[c] * n);
+			for (uint32_t k = 0; k < n; ++k) {
+				memcpy(&part[(size_t) element_sizes[c] * k], column + (size_t) element_sizes[c] * order[first + k],
+				       element_sizes[c]);
+			}
+			ok = write_at(header.columns[c] + (uint64_t) element_sizes[c] * first, part.data(), part.size());
+		}
+	}
+	ok = (fclose(out) == 0) && ok;
+
+#ifdef _WIN32
+	if (ok) remove(path.c_str()); // rename does not replace existing files
+#endif
+	if (!ok || (rename(temporary.c_str(), path.c_str()) != 0)) {
+		remove(temporary.c_str());
+		fprintf(stderr, "cgvPagedScene: unable to write %s\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Open a page file
+ * @param path Path of the file
+ * @param _memory_budget Maximum memory of the resident boxes, in bytes
+ * @retval true if the file is valid. Otherwise, the reason is written to stderr
+ * @post No page is resident until the first update
+ */
+bool cgvPagedScene::open(const std::string &path, uint64_t _memory_budget) {
+	close();
+	if (!cgvMappedFile::is_little_endian()) {
+		fprintf(stderr, "cgvPagedScene: the page files can only be read in little-endian hosts\n");
+		return false;
+	}
+
+	std::unique_ptr<cgvMappedFile> _file(new cgvMappedFile());
+	if (!_file->open(path, false)) {
+		fprintf(stderr, "cgvPagedScene: unable to read %s\n", path.c_str());
+		return false;
+	}
+
+	const char *error = nullptr;
+	cgvPageFileHeader header;
+	const uint64_t size = _file->get_size();
+	if (size < sizeof(header)) {
+		error = "the file is too short";
+	} else {
+		memcpy(&header, _file->get_data(), sizeof(header));
+		if (memcmp(header.magic, page_file_magic, sizeof(page_file_magic)) != 0) {
+			error = "unknown format";
+		} else if (header.version != VERSION) {
+			error = "unsupported version";
+		} else if ((header.header_size != sizeof(header)) || (header.page_size != PAGE_SIZE) ||
+		           (header.n_boxes >= (1u << 24)) || (header.n_pages != (header.n_boxes + PAGE_SIZE - 1) / PAGE_SIZE)) {
+			error = "corrupt header";
+		} else if (header.file_size != size) {
+			error = "the file is truncated";
+		} else if ((header.page_table % column_alignment != 0) || (header.page_table < sizeof(header)) ||
+		           (header.page_table > size) || ((size - header.page_table) / sizeof(page) < header.n_pages)) {
+			error = "the table of pages is out of the file";
+		}
+		for (int c = 0; !error && (c < 3); ++c) {
+			if ((header.columns[c] % column_alignment != 0) || (header.columns[c] < sizeof(header)) ||
+			    (header.columns[c] > size) || ((size - header.columns[c]) / element_sizes[c] < header.n_boxes)) {
+				error = "a column is out of the file";
+			}
+		}
+	}
+	const page *table = error ? nullptr : (const page *) (_file->get_data() + header.page_table);
+	for (uint32_t p = 0; !error && (p < header.n_pages); ++p) {
+		if ((table[p].first != p * PAGE_SIZE) || (table[p].n_boxes != std::min(PAGE_SIZE, header.n_boxes - table[p].first))) {
+			error = "corrupt table of pages";
+		}
+	}
+	if (error) {
+		fprintf(stderr, "cgvPagedScene: %s is not a valid page file (%s)\n", path.c_str(), error);
+		return false;
+	}
+
+	file = std::move(_file);
+	pages = table;
+	n_pages = header.n_pages;
+	n_boxes = header.n_boxes;
+	for (int c = 0; c < 3; ++c) columns[c] = header.columns[c];
+	scene_min.set(header.min[X], header.min[Y], header.min[Z]);
+	scene_max.set(header.max[X], header.max[Y], header.max[Z]);
+	memory_budget = _memory_budget;
+	bytes_per_box = cgvScene3D::get_base_bytes_per_box();
+	resident.assign(n_pages, 0);
+	last_used.assign(n_pages, 0);
+	page_changes.assign(n_pages, 0);
+	corrupt.assign(n_pages, 0);
+	return true;
+}
+
+/**
+ * Close the page file
+ * @post No page is resident, and the changes of the boxes are forgotten. The scene is not changed
+ */
+void cgvPagedScene::close() {
+	file.reset();
+	pages = nullptr;
+	n_pages = n_boxes = n_resident_boxes = 0;
+	resident.clear();
+	last_used.clear();
+	page_changes.clear();
+	corrupt.clear();
+	resident_pages.clear();
+	scene_first.clear();
+	changed_boxes.clear();
+	scene_revision = 0;
+	frame = 0;
+	has_last_eye = false;
+	n_page_loads = n_page_evictions = n_prefetched = n_boxes_copied = 0;
+}
+
+/**
+ * @retval Maximum number of resident boxes, given by the memory budget and the memory of a box with the renderers
+ * enabled in the last update
+ */
+uint32_t cgvPagedScene::get_max_resident_boxes() const {
+	return (uint32_t) std::min<uint64_t>(memory_budget / bytes_per_box, n_boxes);
+}
+
+/**
+ * Update the resident pages for a frame, and copy to the scene the ones that change
+ * @param scene The scene where the resident pages are copied
+ * @param camera Camera of the frame
+ * @param _bytes_per_box Memory of a resident box with the renderers that are used. 0: the ones enabled in the scene
+ * (cgvScene3D::get_bytes_per_box)
+ * @retval true if the boxes of the scene have changed
+ * @post The selection and rotation of the boxes changed in the scene since the last update are kept. If the scene
+ * has not been changed by anyone else since the last update, the boxes of the evicted pages are removed from it and
+ * the loaded pages are appended; otherwise, its boxes are replaced. When a renderer is enabled, fewer boxes fit in the
+ * memory budget, and the least recently used pages are evicted
+ */
+bool cgvPagedScene::update(cgvScene3D &scene, const cgvCamera &camera, uint32_t _bytes_per_box) {
+	n_prefetched = 0;
+	if (!file) return false;
+	++frame;
+	store_changes(scene);
+	bytes_per_box = std::max<uint32_t>(_bytes_per_box ? _bytes_per_box : scene.get_bytes_per_box(), 1);
+
+	// motion of the camera since the last frame
+	cgvPoint3D eye, reference, up;
+	camera.getCameraParameters(eye, reference, up);
+	cgvPoint3D motion(0, 0, 0);
+	if (has_last_eye) motion.set(eye[X] - last_eye[X], eye[Y] - last_eye[Y], eye[Z] - last_eye[Z]);
+	last_eye = eye;
+	has_last_eye = true;
+	const bool moving = (motion[X] != 0) || (motion[Y] != 0) || (motion[Z] != 0);
+
+	float planes[6][4], ahead_planes[6][4];
+	camera.get_frustum_planes(planes);
+	cgvPoint3D ahead_eye = eye;
+	if (moving) {
+		cgvCamera ahead(camera);
+		for (int i = X; i <= Z; ++i) {
+			ahead_eye[i] += PREFETCH_FRAMES * motion[i];
+			reference[i] += PREFETCH_FRAMES * motion[i];
+		}
+		ahead.setCameraParameters(ahead_eye, reference, up);
+		ahead.get_frustum_planes(ahead_planes);
+	}
+
+	// the visible pages, nearest first, then the ones that will be visible, nearest to the predicted camera first
+	std::vector<std::pair<float, uint32_t> > visible, upcoming;
+	for (uint32_t p = 0; p < n_pages; ++p) {
+		if (corrupt[p]) continue;
+		if (intersects(planes, pages[p].min, pages[p].max)) {
+			visible.push_back({squared_distance(eye, pages[p].min, pages[p].max), p});
+		} else if (moving && intersects(ahead_planes, pages[p].min, pages[p].max)) {
+			upcoming.push_back({squared_distance(ahead_eye, pages[p].min, pages[p].max), p});
+		}
+	}
+	std::sort(visible.begin(), visible.end());
+	std::sort(upcoming.begin(), upcoming.end());
+
+	const uint32_t max_boxes = get_max_resident_boxes();
+	std::vector<uint8_t> selected(n_pages, 0);
+	std::vector<uint32_t> selection;
+	uint32_t n_selected = 0;
+	bool missing = false;
+	for (const std::vector<std::pair<float, uint32_t> > *list: {&visible, &upcoming}) {
+		for (const std::pair<float, uint32_t> &candidate: *list) {
+			const uint32_t p = candidate.second;
+			if (n_selected + pages[p].n_boxes > max_boxes) break;
+			selected[p] = 1;
+			selection.push_back(p);
+			n_selected += pages[p].n_boxes;
+			last_used[p] = frame;
+			missing = missing || !resident[p];
+			if ((list == &upcoming) && !resident[p]) ++n_prefetched;
+		}
+	}
+	const bool same_scene = (scene.get_revision() == scene_revision);
+	if (!missing && (n_resident_boxes <= max_boxes) && same_scene) return false;
+
+	// the rest of the resident pages are kept while there is room, the most recently used first
+	std::vector<std::pair<uint32_t, uint32_t> > kept;
+	for (uint32_t p: resident_pages) {
+		if (!selected[p]) kept.push_back({last_used[p], p});
+	}
+	std::sort(kept.begin(), kept.end(), std::greater<std::pair<uint32_t, uint32_t> >());
+	for (const std::pair<uint32_t, uint32_t> &candidate: kept) {
+		const uint32_t p = candidate.second;
+		if (n_selected + pages[p].n_boxes > max_boxes) continue;
+		selected[p] = 1;
+		selection.push_back(p);
+		n_selected += pages[p].n_boxes;
+	}
+
+	// the boxes of the evicted pages are removed from the scene, and the rest keep their order
+	std::vector<uint32_t> removed, kept_pages;
+	for (size_t r = 0; r < resident_pages.size(); ++r) {
+		const uint32_t p = resident_pages[r];
+		if (selected[p]) {
+			kept_pages.push_back(p);
+			continue;
+		}
+		resident[p] = 0;
+		++n_page_evictions;
+		for (int c = 0; c < 3; ++c) {
+			size_t offset, length;
+			page_range(p, c, offset, length);
+			file->release(offset, length);
+		}
+		if (same_scene) {
+			for (uint32_t k = 0; k < pages[p].n_boxes; ++k) removed.push_back(scene_first[r] + k);
+		}
+	}
+	std::vector<uint32_t> loaded;
+	for (uint32_t p: selection) {
+		if (resident[p]) continue;
+		resident[p] = 1;
+		++n_page_loads;
+		loaded.push_back(p);
+	}
+
+	if (!same_scene) {
+		std::sort(selection.begin(), selection.end());
+		resident_pages.swap(selection);
+		build_scene(scene);
+		return true;
+	}
+	scene.remove_boxes(removed);
+	resident_pages.swap(kept_pages);
+	scene_first.clear();
+	n_resident_boxes = 0;
+	for (uint32_t p: resident_pages) {
+		scene_first.push_back(n_resident_boxes);
+		n_resident_boxes += pages[p].n_boxes;
+	}
+	for (uint32_t p: loaded) append_page(scene, p);
+	finish_scene(scene);
+	return true;
+}
+
+/**
+ * Draw the bounding boxes of the pages in the view volume that are not resident
+ * @param camera Camera of the frame
+ * @pre Display mode
+ * @post The OpenGL state (and so the one shadowed by cgvGLState) is not changed
+ */
+void cgvPagedScene::draw_bounds(const cgvCamera &camera) const {
+	if (!file) return;
+	float planes[6][4];
+	camera.get_frustum_planes(planes);
+
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glColor3f(0.6f, 0.6f, 0.6f);
+	glBegin(GL_LINES);
+	for (uint32_t p = 0; p < n_pages; ++p) {
+		if (resident[p] || !intersects(planes, pages[p].min, pages[p].max)) continue;
+		const float *min = pages[p].min, *max = pages[p].max;
+		// the 4 edges along each axis
+		for (int axis = X; axis <= Z; ++axis) {
+			const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			for (int k = 0; k < 4; ++k) {
+				float a[3], b[3];
+				a[u] = b[u] = (k & 1) ? max[u] : min[u];
+				a[v] = b[v] = (k & 2) ? max[v] : min[v];
+				a[axis] = min[axis];
+				b[axis] = max[axis];
+				glVertex3fv(a);
+				glVertex3fv(b);
+			}
+		}
+	}
+	glEnd();
+	glPopAttrib();
+}
+
+/**
+ * Store the selection and rotation of the resident boxes that differ from the ones of the file
+ * @param scene The scene where the resident pages were copied
+ */
+void cgvPagedScene::store_changes(const cgvScene3D &scene) {
+	if (scene.get_revision() != scene_revision) return;
+
+	const bool selection_changed = (scene.get_num_selection_requests() != selection_requests);
+	if (!selection_changed && (scene.get_num_box_changes() == box_changes)) return;
+	selection_requests = scene.get_num_selection_requests();
+	box_changes = scene.get_num_box_changes();
+
+	const uint8_t *data = file->get_data();
+	if (selection_changed) {
+		// the boxes that are not resident cannot match the new selection
+		for (auto c = changed_boxes.begin(); c != changed_boxes.end();) {
+			const uint32_t p = c->first / PAGE_SIZE;
+			if (!resident[p]) c->second.selected = false;
+			const float *rotation = (const float *) (data + columns[2] + element_sizes[2] * (size_t) c->first);
+			if (!resident[p] && (rotation[0] == c->second.rotation[0]) && (rotation[1] == c->second.rotation[1])) {
+				--page_changes[p];
+				c = changed_boxes.erase(c);
+			} else {
+				++c;
+			}
+		}
+	}
+
+	const vector<cgvBox> &boxes = scene.get_boxes();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	for (size_t r = 0; r < resident_pages.size(); ++r) {
+		const uint32_t p = resident_pages[r];
+		const uint32_t first = scene_first[r], n = pages[p].n_boxes;
+		const cgvBox *file_boxes = (const cgvBox *) (data + columns[0]) + pages[p].first;
+		const array<GLfloat, 2> *file_rotations = (const array<GLfloat, 2> *) (data + columns[2]) + pages[p].first;
+		if (!page_changes[p] && !memcmp(&boxes[first], file_boxes, sizeof(cgvBox) * n) &&
+		    !memcmp(&rotations[first], file_rotations, sizeof(array<GLfloat, 2>) * n)) {
+			continue;
+		}
+		for (uint32_t k = 0; k < n; ++k) {
+			const uint32_t index = pages[p].first + k;
+			const bool same = (boxes[first + k].isSelected() == file_boxes[k].isSelected()) &&
+			                  (rotations[first + k] == file_rotations[k]);
+			auto c = changed_boxes.find(index);
+			if (same && (c != changed_boxes.end())) {
+				changed_boxes.erase(c);
+				--page_changes[p];
+			} else if (!same) {
+				if (c == changed_boxes.end()) ++page_changes[p];
+				changed_boxes[index] = {boxes[first + k].isSelected(), rotations[first + k]};
+			}
+		}
+	}
+}
+
+/**
+ * Copy the resident pages to a scene
+ * @param scene The scene. Its boxes are replaced
+ * @post The boxes changed by the user have their stored state. The pages with corrupt boxes are reported to stderr,
+ * and they are never resident again
+ */
+void cgvPagedScene::build_scene(cgvScene3D &scene) {
+	scene.clear();
+	scene.reserve(std::min(n_boxes, get_max_resident_boxes()));
+	scene_first.clear();
+	n_resident_boxes = 0;
+
+	std::vector<uint32_t> pending;
+	pending.swap(resident_pages);
+	for (uint32_t p: pending) append_page(scene, p);
+	finish_scene(scene);
+}
+
+/**
+ * Append the boxes of a page to a scene, with the state stored for the boxes changed by the user
+ * @param scene The scene
+ * @param p Index of the page. It is added to the resident pages
+ * @post If the page has corrupt boxes, it is reported to stderr, it is not appended, and it is never resident again
+ */
+void cgvPagedScene::append_page(cgvScene3D &scene, uint32_t p) {
+	const uint8_t *data = file->get_data();
+	const uint32_t first = pages[p].first, n = pages[p].n_boxes;
+	const cgvBox *file_boxes = (const cgvBox *) (data + columns[0]) + first;
+	const cgvPoint3D *file_positions = (const cgvPoint3D *) (data + columns[1]) + first;
+	const array<GLfloat, 2> *file_rotations = (const array<GLfloat, 2> *) (data + columns[2]) + first;
+
+	// the selection is a bool in memory: any other value than 0 or 1 is not valid
+	const uint8_t *bytes = (const uint8_t *) file_boxes;
+	bool valid = true;
+	for (uint32_t k = 0; valid && (k < n); ++k) valid = (bytes[sizeof(cgvBox) * k + offsetof(cgvBox, selected)] <= 1);
+	if (!valid) {
+		fprintf(stderr, "cgvPagedScene: the page %u has corrupt boxes, it is not loaded\n", p);
+		corrupt[p] = 1;
+		resident[p] = 0;
+		return;
+	}
+
+	resident_pages.push_back(p);
+	scene_first.push_back(n_resident_boxes);
+	n_resident_boxes += n;
+	n_boxes_copied += n;
+	if (!page_changes[p]) {
+		scene.append_boxes(n, file_boxes, file_positions, file_rotations);
+		return;
+	}
+	std::vector<cgvBox> boxes(file_boxes, file_boxes + n);
+	std::vector<array<GLfloat, 2> > rotations(file_rotations, file_rotations + n);
+	for (uint32_t k = 0; k < n; ++k) {
+		auto c = changed_boxes.find(first + k);
+		if (c == changed_boxes.end()) continue;
+		boxes[k].selected = c->second.selected;
+		rotations[k] = c->second.rotation;
+	}
+	scene.append_boxes(n, boxes.data(), file_positions, rotations.data());
+}
+
+/**
+ * Remember the state of the scene where the resident pages have been copied
+ * @param scene The scene
+ */
+void cgvPagedScene::finish_scene(const cgvScene3D &scene) {
+	scene_revision = scene.get_revision();
+	box_changes = scene.get_num_box_changes();
+	selection_requests = scene.get_num_selection_requests();
+}
+
+/**
+ * Part of a column of the file with the boxes of a page
+ * @param p Index of the page
+ * @param column 0 (boxes), 1 (positions) or 2 (rotations)
+ * @param offset Output first byte of the part
+ * @param length Output bytes of the part
+ */
+void cgvPagedScene::page_range(uint32_t p, int column, size_t &offset, size_t &length) const {
+	offset = (size_t) (columns[column] + (uint64_t) element_sizes[column] * pages[p].first);
+	length = (size_t) element_sizes[column] * pages[p].n_boxes;
+}
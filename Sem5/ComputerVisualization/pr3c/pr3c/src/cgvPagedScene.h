@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cgvPoint.h"
+#include "cgvMappedFile.h"
+
+class cgvScene3D;
+class cgvCamera;
+
+/**
+ * cgvPagedScene renders scenes larger than the memory. The boxes are partitioned in spatial pages of PAGE_SIZE boxes
+ * (consecutive boxes in Morton order), stored in a page file that is mapped in memory. Only some pages are resident:
+ * they are copied to a cgvScene3D, so that rendering and picking work as with any other scene. In each frame, the
+ * pages in the view volume of the camera are made resident, nearest first, and then the ones in the view volume of
+ * the camera predicted from its motion (prefetch), while the number of resident boxes fits in the memory budget. The
+ * rest of the resident pages are kept while there is room, and the least recently used ones are evicted first.
+ * The pages that are not resident are drawn as their bounding boxes.
+ *
+ * The selection and rotation of the boxes is kept when their page is evicted, and restored when it becomes resident.
+ *
+ * Layout of the page file (little-endian, version 1): header (magic "CGVPAGE", version, sizes, number of boxes and
+ * pages, bounds of the scene, offsets), the table of pages (bounds, first box and number of boxes), and the columns of
+ * the boxes sorted by page, as in cgvSnapshot: boxes, positions and rotations.
+ */
+class cgvPagedScene {
+public:
+	static const uint32_t VERSION = 1; ///< Version of the format written by write
+	static const uint32_t PAGE_SIZE = 4096; ///< Boxes of a page (the last one can have less)
+	static const int PREFETCH_FRAMES = 10; ///< Frames ahead of the camera, along its motion, whose pages are prefetched
+
+private:
+	/**
+	 * Page of the file
+	 */
+	struct page {
+		float min[3]; ///< Minimum corner of the bounding box of the boxes of the page
+		float max[3]; ///< Maximum corner of the bounding box of the boxes of the page
+		uint32_t first; ///< Index of the first box of the page
+		uint32_t n_boxes; ///< Number of boxes of the page
+	};
+
+	/**
+	 * State of a box changed while it was resident
+	 */
+	struct boxState {
+		bool selected; ///< Selection of the box
+		std::array<float, 2> rotation; ///< Rotation of the box
+	};
+
+	std::unique_ptr<cgvMappedFile> file; ///< Page file
+	const page *pages = nullptr; ///< Table of pages, in the file
+	uint32_t n_pages = 0; ///< Number of pages
+	uint32_t n_boxes = 0; ///< Number of boxes of the file
+	uint64_t columns[3] = {0, 0, 0}; ///< Offset of the columns of the boxes, positions and rotations in the file
+	cgvPoint3D scene_min, scene_max; ///< Bounds of the whole scene
+
+	uint64_t memory_budget = 0; ///< Maximum memory of the resident boxes, in bytes
+	uint32_t bytes_per_box = 1; ///< Memory of a resident box: the arrays of the scene and of the renderers enabled in the last update
+	std::vector<uint8_t> resident; ///< Whether each page is resident
+	std::vector<uint32_t> last_used; ///< Last frame where each page was in the view volume (0: never)
+	std::vector<uint32_t> page_changes; ///< Boxes of each page in changed_boxes
+	std::vector<uint8_t> corrupt; ///< Whether each page has corrupt boxes, so it is never resident
+	std::vector<uint32_t> resident_pages; ///< Resident pages, in the order of their boxes in the scene
+	std::vector<uint32_t> scene_first; ///< Index in the scene of the first box of each resident page
+	uint32_t n_resident_boxes = 0; ///< Boxes of the resident pages
+	unsigned long scene_revision = 0; ///< Revision of the scene when the resident pages were copied to it
+	unsigned long box_changes = 0; ///< Changes of the boxes of the scene already stored in changed_boxes
+	unsigned long selection_requests = 0; ///< Selections of the scene already applied to changed_boxes
+	std::unordered_map<uint32_t, boxState> changed_boxes; ///< State of the boxes changed by the user, by index in the file
+
+	uint32_t frame = 0; ///< Number of updates
+	cgvPoint3D last_eye; ///< Position of the camera in the last update
+	bool has_last_eye = false; ///< last_eye is valid
+
+	unsigned long n_page_loads = 0; ///< Pages made resident since open
+	unsigned long n_page_evictions = 0; ///< Pages evicted since open
+	unsigned long n_prefetched = 0; ///< Pages made resident by the prediction of the motion of the camera, in the last update
+	unsigned long n_boxes_copied = 0; ///< Boxes copied to the scene since open
+
+public:
+	cgvPagedScene() = default;
+	~cgvPagedScene() = default;
+
+	cgvPagedScene(const cgvPagedScene&) = delete;
+	cgvPagedScene& operator=(const cgvPagedScene&) = delete;
+
+	static bool write(const std::string &path, const cgvScene3D &scene);
+	bool open(const std::string &path, uint64_t _memory_budget);
+	void close();
+
+	bool update(cgvScene3D &scene, const cgvCamera &camera, uint32_t _bytes_per_box = 0);
+	void draw_bounds(const cgvCamera &camera) const;
+
+	bool is_open() const { return file != nullptr; };
+	/**
+	 * @param min Output minimum corner of the bounding box of the whole scene
+	 * @param max Output maximum corner of the bounding box of the whole scene
+	 */
+	void get_bounds(cgvPoint3D &min, cgvPoint3D &max) const { min = scene_min; max = scene_max; };
+	uint32_t get_num_pages() const { return n_pages; };
+	uint32_t get_num_resident_pages() const { return (uint32_t) resident_pages.size(); };
+	uint32_t get_num_resident_boxes() const { return n_resident_boxes; };
+	uint32_t get_max_resident_boxes() const;
+	uint32_t get_bytes_per_box() const { return bytes_per_box; };
+	unsigned long get_num_page_loads() const { return n_page_loads; };
+	unsigned long get_num_page_evictions() const { return n_page_evictions; };
+	unsigned long get_num_prefetched() const { return n_prefetched; };
+	unsigned long get_num_boxes_copied() const { return n_boxes_copied; };
+
+private:
+	void store_changes(const cgvScene3D &scene);
+	void build_scene(cgvScene3D &scene);
+	void append_page(cgvScene3D &scene, uint32_t p);
+	void finish_scene(const cgvScene3D &scene);
+	void page_range(uint32_t p, int column, size_t &offset, size_t &length) const;
+};
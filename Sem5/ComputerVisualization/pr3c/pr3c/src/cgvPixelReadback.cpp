@@ -0,0 +1,160 @@
+#include <stdio.h>
+
+#include "cgvPixelReadback.h"
+#include "cgvGLState.h"
+
+/**
+ * Destructor. The buffers are released
+ * @pre The context where create() was called must be current
+ */
+cgvPixelReadback::~cgvPixelReadback() {
+	destroy();
+}
+
+/**
+ * Create the pixel buffers
+ * @param _max_width Maximum width of the frames
+ * @param _max_height Maximum height of the frames
+ * @retval true if the buffers have been created. false if the pixel buffer objects are not available (OpenGL 2.1 or
+ * ARB_pixel_buffer_object, and CGV_HAVE_CORE_PROFILE), or if they can not be created (the reason is written to stderr)
+ * @pre An OpenGL context is current
+ */
+bool cgvPixelReadback::create(uint32_t _max_width, uint32_t _max_height) {
+	destroy();
+#ifdef CGV_HAVE_CORE_PROFILE
+	if ((_max_width == 0) || (_max_height == 0) || !cgvGLState::supports(2, 1, "GL_ARB_pixel_buffer_object")) {
+		return false;
+	}
+	max_width = _max_width;
+	max_height = _max_height;
+
+	glGenBuffers(N_BUFFERS, buffers);
+	for (GLuint buffer : buffers) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, get_stride() * max_height, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	use_fences = cgvGLState::supports(3, 2, "GL_ARB_sync");
+	if (glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "cgvPixelReadback: unable to create the pixel buffers of %u x %u pixels\n", max_width,
+		        max_height);
+		destroy();
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Release the buffers and the fences. The frames in flight are lost
+ */
+void cgvPixelReadback::destroy() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	for (GLsync &fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (buffers[0]) glDeleteBuffers(N_BUFFERS, buffers);
+#endif
+	for (int b = 0; b < N_BUFFERS; ++b) {
+		buffers[b] = 0;
+		in_flight[b] = false;
+	}
+	next = oldest = 0;
+	use_fences = false;
+	max_width = max_height = 0;
+	n_read = 0;
+}
+
+/**
+ * Start reading the lower left corner of the current read buffer into the next pixel buffer
+ * @param width Width of the frame (at most the maximum width)
+ * @param height Height of the frame (at most the maximum height)
+ * @param tag Value returned with the frame by map_oldest
+ * @pre The buffers are valid and not full
+ */
+void cgvPixelReadback::read(uint32_t width, uint32_t height, uint64_t tag) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	// the rows have the stride of the largest frame (the rows of RGBA pixels are always aligned)
+	glPixelStorei(GL_PACK_ROW_LENGTH, (GLint) max_width);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[next]);
+	glReadPixels(0, 0, (GLsizei) width, (GLsizei) height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	if (use_fences) fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+	widths[next] = width;
+	heights[next] = height;
+	tags[next] = tag;
+	read_at[next] = n_read++;
+	in_flight[next] = true;
+	next = (next + 1) % N_BUFFERS;
+}
+
+/**
+ * Map the oldest frame in flight
+ * @param wait true to wait until it has been read, false to return nullptr if it has not been read yet
+ * @param width Width of the frame
+ * @param height Height of the frame
+ * @param tag Value given with the frame to read
+ * @retval The pixels of the frame, valid until unmap_oldest is called; nullptr if there are no frames in flight, if
+ * the frame has not been read yet and wait is false, or if the buffer can not be mapped (the frame is lost)
+ */
+const uint8_t *cgvPixelReadback::map_oldest(bool wait, uint32_t &width, uint32_t &height, uint64_t &tag) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	while (in_flight[oldest] && (wait || is_ready(oldest))) {
+		width = widths[oldest];
+		height = heights[oldest];
+		tag = tags[oldest];
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[oldest]);
+		const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, get_stride() * height, GL_MAP_READ_BIT);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if (pixels) return (const uint8_t *) pixels;
+
+		fprintf(stderr, "cgvPixelReadback: unable to map a frame, it is lost\n");
+		release_oldest();
+	}
+#endif
+	return nullptr;
+}
+
+/**
+ * Release the frame mapped by map_oldest, so that its buffer can be read again
+ */
+void cgvPixelReadback::unmap_oldest() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[oldest]);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+	release_oldest();
+}
+
+/**
+ * Forget the oldest frame in flight
+ */
+void cgvPixelReadback::release_oldest() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (fences[oldest]) glDeleteSync(fences[oldest]);
+	fences[oldest] = nullptr;
+#endif
+	in_flight[oldest] = false;
+	oldest = (oldest + 1) % N_BUFFERS;
+}
+
+/**
+ * @param b Buffer in flight
+ * @retval true if the frame of the buffer has been read: its fence has been signaled or, without fences,
+ * N_BUFFERS - 1 frames have been read after it
+ */
+bool cgvPixelReadback::is_ready(int b) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (fences[b]) {
+		const GLenum status = glClientWaitSync(fences[b], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		return (status == GL_ALREADY_SIGNALED) || (status == GL_CONDITION_SATISFIED);
+	}
+#endif
+	return n_read - read_at[b] >= N_BUFFERS - 1;
+}
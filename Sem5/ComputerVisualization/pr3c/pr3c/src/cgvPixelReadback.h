@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+/**
+ * cgvPixelReadback reads frames back from OpenGL without waiting for them: each frame is read into one of N_BUFFERS
+ * pixel buffer objects in turns, and it is mapped in a later frame, once its fence has been signaled (or, without
+ * ARB_sync, N_BUFFERS - 1 frames later). The frames are mapped in the order they were read.
+ * The frames are RGBA, 8 bits per channel, with the rows from bottom to top and get_stride() bytes from a row to the
+ * next one.
+ */
+class cgvPixelReadback {
+public:
+	static const int N_BUFFERS = 3; ///< Number of pixel buffer objects
+
+private:
+	GLuint buffers[N_BUFFERS] = {}; ///< Pixel buffer objects
+	GLsync fences[N_BUFFERS] = {}; ///< Fence after the read of each buffer (nullptr: without ARB_sync)
+	bool in_flight[N_BUFFERS] = {}; ///< The buffer holds a frame not mapped yet
+	uint32_t widths[N_BUFFERS] = {}, heights[N_BUFFERS] = {}; ///< Size of the frame of each buffer
+	uint64_t tags[N_BUFFERS] = {}; ///< Value given with the frame of each buffer
+	unsigned long read_at[N_BUFFERS] = {}; ///< Value of n_read when each buffer was read
+	int next = 0; ///< Buffer of the next frame
+	int oldest = 0; ///< Buffer of the oldest frame in flight
+	bool use_fences = false; ///< The fences tell when a buffer has been read
+	uint32_t max_width = 0, max_height = 0; ///< Maximum size of a frame
+	unsigned long n_read = 0; ///< Frames read
+
+public:
+	cgvPixelReadback() = default;
+	~cgvPixelReadback();
+
+	cgvPixelReadback(const cgvPixelReadback&) = delete;
+	cgvPixelReadback& operator=(const cgvPixelReadback&) = delete;
+
+	bool create(uint32_t _max_width, uint32_t _max_height);
+	void destroy();
+
+	void read(uint32_t width, uint32_t height, uint64_t tag);
+	const uint8_t *map_oldest(bool wait, uint32_t &width, uint32_t &height, uint64_t &tag);
+	void unmap_oldest();
+
+	bool is_valid() const { return buffers[0] != 0; };
+	/**
+	 * @retval true if all the buffers hold frames that have not been mapped: read() must not be called
+	 */
+	bool is_full() const { return in_flight[next]; };
+	bool is_empty() const { return !in_flight[oldest]; };
+	size_t get_stride() const { return (size_t) max_width * 4; };
+
+private:
+	bool is_ready(int b);
+	void release_oldest();
+};
@@ -24,29 +24,6 @@ cgvPoint3D::cgvPoint3D (const float& x, const float& y, const float& z ) {
 	c[Z] = z;	
 }
 
-/** 
-* Copy constructor 
-* @param p Point/vector
-* @post The coordinates of the point/vector becomes the same as the parameter 
-*/
-cgvPoint3D::cgvPoint3D (const cgvPoint3D& p ) {
-	c[X] = p.c[X];
-	c[Y] = p.c[Y];
-	c[Z] = p.c[Z];
-}
-
-/**
- * Assignment operator 
- * @param p Point/vector
- * @return A new point/vector with the same coordinates as the original
- */
-cgvPoint3D& cgvPoint3D::operator = (const cgvPoint3D& p) {
-	c[X] = p.c[X];
-	c[Y] = p.c[Y];
-	c[Z] = p.c[Z];
-	return(*this);
-}
-
 /**
  * Equality operator
  * @param p The point/vector to compare with
@@ -31,11 +31,11 @@ class cgvPoint3D {
 		cgvPoint3D(); 
 		cgvPoint3D( const float& x, const float& y, const float& z );
 		
-		// Copy Constructor 
-		cgvPoint3D( const cgvPoint3D& p );
+		// Copy Constructor (trivial, so that arrays of points can be copied in bulk)
+		cgvPoint3D( const cgvPoint3D& p ) = default;
 
 		// Assignment operator
-		cgvPoint3D& operator = (const cgvPoint3D& p);
+		cgvPoint3D& operator = (const cgvPoint3D& p) = default;
 
 		// Destructor
 		~cgvPoint3D()=default;
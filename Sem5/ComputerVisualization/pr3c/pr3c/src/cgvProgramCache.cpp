@@ -0,0 +1,340 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef CGV_HAVE_EGL
+#include <EGL/egl.h>
+#endif
+
+#include "cgvProgramCache.h"
+#include "cgvGLState.h"
+
+// Header of the files of the cache
+static const char binary_magic[8] = { 'C', 'G', 'V', 'P', 'B', 'I', 'N', '1' };
+static const uint32_t max_binary_length = 64 * 1024 * 1024;
+
+/**
+ * Default constructor. The cache uses default_directory()
+ */
+cgvProgramCache::cgvProgramCache() : directory(default_directory()) {
+}
+
+/**
+ * Parametrized constructor
+ * @param _directory Directory of the binaries. An empty string disables the cache
+ */
+cgvProgramCache::cgvProgramCache(const std::string &_directory) : directory(_directory) {
+}
+
+/**
+ * Build several programs, loading their binaries from the cache when possible
+ * @param sources Sources of each program
+ * @param n_programs Number of programs
+ * @param programs Output programs
+ * @retval true if every program has been built. false otherwise: the errors are written to stderr and every output
+ * program is 0
+ * @pre An OpenGL 3.3 (or later) context is current
+ * @post The programs that were not in the cache are stored in it, if the cache is enabled and the driver can
+ * retrieve program binaries
+ */
+bool cgvProgramCache::build(const cgvProgramSource *sources, int n_programs, GLuint *programs) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	GLint n_formats = 0;
+	if (is_enabled() && cgvGLState::supports(4, 1, "GL_ARB_get_program_binary")) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+	}
+	const bool use_binaries = n_formats > 0;
+
+	// the same sources produce different binaries with other drivers
+	uint64_t driver = 14695981039346656037ull; // FNV-1a offset basis
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		driver = hash(driver, (const char *) glGetString(name));
+	}
+
+	std::vector<uint64_t> keys(n_programs);
+	std::vector<int> missing;
+	for (int p = 0; p < n_programs; ++p) {
+		keys[p] = hash(hash(hash(driver, sources[p].vertex), "\n//fragment\n"), sources[p].fragment);
+		keys[p] = hash(hash(keys[p], "\n//compute\n"), sources[p].compute);
+		programs[p] = use_binaries ? load(keys[p]) : 0;
+		if (programs[p]) {
+			++n_loaded;
+		} else {
+			missing.push_back(p);
+		}
+	}
+	if (missing.empty()) return true;
+
+	// every shader is compiled and every program is linked before asking for the result of any of them, so that the
+	// driver can do it in parallel
+#ifdef CGV_HAVE_EGL
+	if (cgvGLState::supports(0, 0, "GL_KHR_parallel_shader_compile")) {
+		// libOpenGL does not export it: it is looked up at run time
+		PFNGLMAXSHADERCOMPILERTHREADSKHRPROC max_threads =
+			(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+		if (max_threads) max_threads(0xFFFFFFFF); // as many threads as the driver wants
+	}
+#endif
+
+	std::vector<GLuint> shaders(2 * missing.size(), 0); // up to 2 shaders per program
+	for (size_t m = 0; m < missing.size(); ++m) {
+		GLenum types[2];
+		const char *texts[2];
+		int n_stages = get_stages(sources[missing[m]], types, texts);
+		for (int s = 0; s < n_stages; ++s) {
+			shaders[2 * m + s] = glCreateShader(types[s]);
+			glShaderSource(shaders[2 * m + s], 1, &texts[s], nullptr);
+			glCompileShader(shaders[2 * m + s]);
+		}
+	}
+	for (size_t m = 0; m < missing.size(); ++m) {
+		GLuint program = glCreateProgram();
+		for (int s = 0; s < 2; ++s) {
+			if (shaders[2 * m + s]) glAttachShader(program, shaders[2 * m + s]);
+		}
+		if (use_binaries) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(program);
+		programs[missing[m]] = program;
+	}
+
+	bool ok = true;
+	char log[1024];
+	for (size_t m = 0; m < missing.size(); ++m) {
+		const int p = missing[m];
+		for (int s = 0; s < 2; ++s) {
+			GLint status = GL_TRUE;
+			if (shaders[2 * m + s]) glGetShaderiv(shaders[2 * m + s], GL_COMPILE_STATUS, &status);
+			if (status != GL_TRUE) {
+				GLint type = 0;
+				glGetShaderiv(shaders[2 * m + s], GL_SHADER_TYPE, &type);
+				glGetShaderInfoLog(shaders[2 * m + s], sizeof(log), nullptr, log);
+				fprintf(stderr, "cgvProgramCache: unable to compile the %s shader of %s\n%s\n",
+				        (type == GL_VERTEX_SHADER) ? "vertex" : ((type == GL_FRAGMENT_SHADER) ? "fragment" : "compute"),
+				        sources[p].name, log);
+				ok = false;
+			}
+		}
+		GLint status = GL_FALSE;
+		glGetProgramiv(programs[p], GL_LINK_STATUS, &status);
+		if (status != GL_TRUE) {
+			glGetProgramInfoLog(programs[p], sizeof(log), nullptr, log);
+			fprintf(stderr, "cgvProgramCache: unable to link %s\n%s\n", sources[p].name, log);
+			ok = false;
+		} else {
+			++n_compiled;
+			if (use_binaries) store(keys[p], programs[p]);
+		}
+	}
+	for (GLuint shader : shaders) {
+		if (shader) glDeleteShader(shader); // they are released when the programs are deleted
+	}
+
+	if (!ok) {
+		for (int p = 0; p < n_programs; ++p) {
+			glDeleteProgram(programs[p]);
+			programs[p] = 0;
+		}
+	}
+	return ok;
+#else
+	for (int p = 0; p < n_programs; ++p) programs[p] = 0;
+	fprintf(stderr, "cgvProgramCache: this build does not support shaders\n");
+	return false;
+#endif
+}
+
+/**
+ * Directory of the cache when no other one is given: $CGV_SHADER_CACHE_DIR if it is defined (an empty value disables
+ * the cache), otherwise pr3c/shaders in the cache directory of the user ($XDG_CACHE_HOME, ~/.cache or %LOCALAPPDATA%)
+ * @return The directory, or an empty string if none can be found
+ */
+std::string cgvProgramCache::default_directory() {
+	const char *value = getenv("CGV_SHADER_CACHE_DIR");
+	if (value) return value;
+
+#ifdef _WIN32
+	value = getenv("LOCALAPPDATA");
+	if (value && *value) return std::string(value) + "\\pr3c\\shaders";
+#else
+	value = getenv("XDG_CACHE_HOME");
+	if (value && *value) return std::string(value) + "/pr3c/shaders";
+	value = getenv("HOME");
+	if (value && *value) return std::string(value) + "/.cache/pr3c/shaders";
+#endif
+	return "";
+}
+
+/**
+ * @param key Identifier of a program
+ * @return Path of the file with the binary of the program
+ */
+std::string cgvProgramCache::binary_path(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+	return directory + "/" + name;
+}
+
+/**
+ * Create a program from its binary in the cache
+ * @param key Identifier of the program
+ * @return The program, or 0 if it is not in the cache or the driver does not accept the binary (then the file is
+ * removed)
+ */
+GLuint cgvProgramCache::load(uint64_t key) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	const std::string path = binary_path(key);
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) return 0;
+
+	char magic[8];
+	uint32_t format = 0, length = 0;
+	uint64_t file_key = 0;
+	std::vector<char> binary;
+	bool valid = (fread(magic, sizeof(magic), 1, file) == 1) && !memcmp(magic, binary_magic, sizeof(magic)) &&
+	             (fread(&format, sizeof(format), 1, file) == 1) && (fread(&length, sizeof(length), 1, file) == 1) &&
+	             (fread(&file_key, sizeof(file_key), 1, file) == 1) && (file_key == key) &&
+	             (length > 0) && (length <= max_binary_length);
+	if (valid) {
+		binary.resize(length);
+		valid = fread(binary.data(), length, 1, file) == 1;
+	}
+	fclose(file);
+
+	GLuint program = 0;
+	if (valid) {
+		program = glCreateProgram();
+		glProgramBinary(program, format, binary.data(), (GLsizei) length);
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE) {
+			glDeleteProgram(program);
+			program = 0;
+			// a format unknown to the driver raises GL_INVALID_ENUM: it must not be seen by the caller
+			while (glGetError() != GL_NO_ERROR) {
+			}
+		}
+	}
+	if (!program) {
+		// for instance, the driver was updated without changing its version string: it will be built again
+		remove(path.c_str());
+	}
+	return program;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Write the binary of a program in the cache
+ * @param key Identifier of the program
+ * @param program Program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+ * @post The file is written with another name (unique for each process and thread) and then renamed, so that other
+ * processes or renderers that use the same cache never read an incomplete binary. Errors are ignored: the program will be compiled again the next time
+ */
+void cgvProgramCache::store(uint64_t key, GLuint program) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if ((length <= 0) || ((uint32_t) length > max_binary_length) || !make_directories(directory)) return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	if (length <= 0) return;
+
+	const std::string path = binary_path(key);
+	const size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+#ifdef _WIN32
+	const std::string temporary = path + "." + std::to_string(_getpid()) + "." + std::to_string(thread);
+#else
+	const std::string temporary = path + "." + std::to_string(getpid()) + "." + std::to_string(thread);
+#endif
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file) return;
+
+	uint32_t file_format = format, file_length = length;
+	bool ok = (fwrite(binary_magic, sizeof(binary_magic), 1, file) == 1) &&
+	          (fwrite(&file_format, sizeof(file_format), 1, file) == 1) &&
+	          (fwrite(&file_length, sizeof(file_length), 1, file) == 1) &&
+	          (fwrite(&key, sizeof(key), 1, file) == 1) &&
+	          (fwrite(binary.data(), file_length, 1, file) == 1);
+	ok = (fclose(file) == 0) && ok;
+
+#ifdef _WIN32
+	if (ok) remove(path.c_str()); // rename does not replace existing files
+#endif
+	if (ok && (rename(temporary.c_str(), path.c_str()) == 0)) {
+		++n_stored;
+	} else {
+		remove(temporary.c_str());
+	}
+#endif
+}
+
+/**
+ * Shaders of a program
+ * @param source Sources of the program
+ * @param types Output type of each shader
+ * @param texts Output source of each shader
+ * @return Number of shaders: 1 (compute) or 2 (vertex and fragment)
+ */
+int cgvProgramCache::get_stages(const cgvProgramSource &source, GLenum types[2], const char *texts[2]) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (source.compute) {
+		types[0] = GL_COMPUTE_SHADER;
+		texts[0] = source.compute;
+		return 1;
+	}
+#endif
+	types[0] = GL_VERTEX_SHADER;
+	texts[0] = source.vertex;
+	types[1] = GL_FRAGMENT_SHADER;
+	texts[1] = source.fragment;
+	return 2;
+}
+
+/**
+ * FNV-1a hash of a text
+ * @param h Hash of the previous data
+ * @param text Text to be added to the hash (nullptr is taken as an empty text)
+ * @return The hash of the previous data followed by the text
+ */
+uint64_t cgvProgramCache::hash(uint64_t h, const char *text) {
+	if (!text) return h;
+	for (const unsigned char *c = (const unsigned char *) text; *c; ++c) {
+		h = (h ^ *c) * 1099511628211ull;
+	}
+	return h;
+}
+
+/**
+ * Create a directory and all its parents
+ * @param path Directory
+ * @retval true if the directory exists when the method ends
+ */
+bool cgvProgramCache::make_directories(const std::string &path) {
+	for (size_t i = 1; i <= path.size(); ++i) {
+		if ((i == path.size()) || (path[i] == '/') || (path[i] == '\\')) {
+			const std::string parent = path.substr(0, i);
+#ifdef _WIN32
+			int result = _mkdir(parent.c_str());
+#else
+			int result = mkdir(parent.c_str(), 0755);
+#endif
+			if ((result != 0) && (errno != EEXIST) && (i == path.size())) return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+/**
+ * Sources of a program with a vertex and a fragment shader, or with a compute shader
+ */
+struct cgvProgramSource {
+	const char *name; ///< Name of the program, used in the messages
+	const char *vertex; ///< Source of the vertex shader (nullptr in a compute program)
+	const char *fragment; ///< Source of the fragment shader (nullptr in a compute program)
+	const char *compute = nullptr; ///< Source of the compute shader (nullptr in a graphics program)
+};
+
+/**
+ * cgvProgramCache builds OpenGL programs and stores their binaries (glGetProgramBinary) in a directory, so that the
+ * next executions of the program load them instead of compiling the shaders again. Each binary is identified by a
+ * hash of the sources and of the vendor, renderer and version of the driver. A binary that the driver does not accept
+ * any more is replaced by a new one. The programs that are not in the cache are compiled and linked together, in
+ * parallel when the driver supports KHR_parallel_shader_compile.
+ */
+class cgvProgramCache {
+	std::string directory; ///< Directory of the binaries. Empty: the cache is disabled
+
+	unsigned long n_loaded = 0; ///< Number of programs loaded from the cache
+	unsigned long n_compiled = 0; ///< Number of programs compiled from their sources
+	unsigned long n_stored = 0; ///< Number of binaries written to the cache
+
+public:
+	cgvProgramCache();
+	explicit cgvProgramCache(const std::string &_directory);
+	~cgvProgramCache() = default;
+
+	bool build(const cgvProgramSource *sources, int n_programs, GLuint *programs);
+
+	const std::string &get_directory() const { return directory; };
+	void set_directory(const std::string &_directory) { directory = _directory; };
+	bool is_enabled() const { return !directory.empty(); };
+
+	unsigned long get_num_loaded() const { return n_loaded; };
+	unsigned long get_num_compiled() const { return n_compiled; };
+	unsigned long get_num_stored() const { return n_stored; };
+
+	static std::string default_directory();
+
+private:
+	std::string binary_path(uint64_t key) const;
+	GLuint load(uint64_t key);
+	void store(uint64_t key, GLuint program);
+
+	static int get_stages(const cgvProgramSource &source, GLenum types[2], const char *texts[2]);
+	static uint64_t hash(uint64_t h, const char *text);
+	static bool make_directories(const std::string &path);
+};
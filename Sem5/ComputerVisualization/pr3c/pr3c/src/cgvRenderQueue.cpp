@@ -0,0 +1,63 @@
+#include "cgvRenderQueue.h"
+
+// The radix sort only uses the 24 upper bits of the keys (mode, material and depth), in two passes of 12 bits.
+// The indices of the boxes are pushed in increasing order, and the sort is stable, so they remain sorted
+// within the boxes with the same mode, material and depth.
+#define CGV_RADIX_FIRST_BIT 40
+#define CGV_RADIX_BITS 12
+#define CGV_RADIX_SIZE (1 << CGV_RADIX_BITS)
+#define CGV_RADIX_PASSES 2
+
+/**
+ * Create the key of a box
+ * @param mode Render mode of the frame
+ * @param material Material of the box
+ * @param depth Quantized distance from the camera, in [0, 2^DEPTH_BITS)
+ * @param box Index of the box in the scene
+ * @return The key
+ */
+uint64_t cgvRenderQueue::make_key(RenderMode mode, queueMaterial material, uint32_t depth, uint32_t box) {
+    return ((uint64_t) (mode == CGV_SELECT ? 1 : 0) << 63) |
+           ((uint64_t) material << 60) |
+           ((uint64_t) (depth & ((1u << DEPTH_BITS) - 1)) << CGV_RADIX_FIRST_BIT) |
+           (uint64_t) box;
+}
+
+/**
+ * Sort the keys with a least-significant-digit radix sort. The histograms of all the passes are computed in a
+ * single read of the keys, and the passes in which all the keys have the same digit are skipped.
+ * @post The keys are in increasing order
+ */
+void cgvRenderQueue::sort() {
+    const size_t n = keys.size();
+    if (n < 2) return;
+
+    static_assert(CGV_RADIX_FIRST_BIT + CGV_RADIX_BITS * CGV_RADIX_PASSES == 64, "the passes must cover the key");
+    histogram.assign(CGV_RADIX_PASSES * CGV_RADIX_SIZE, 0);
+
+    for (uint64_t key: keys) {
+        for (int p = 0; p < CGV_RADIX_PASSES; ++p) {
+            ++histogram[p * CGV_RADIX_SIZE + ((key >> (CGV_RADIX_FIRST_BIT + p * CGV_RADIX_BITS)) & (CGV_RADIX_SIZE - 1))];
+        }
+    }
+
+    scratch.resize(n);
+    for (int p = 0; p < CGV_RADIX_PASSES; ++p) {
+        uint32_t *count = &histogram[p * CGV_RADIX_SIZE];
+        const int shift = CGV_RADIX_FIRST_BIT + p * CGV_RADIX_BITS;
+
+        // all the keys have the same digit: this pass does not change the order
+        if (count[(keys[0] >> shift) & (CGV_RADIX_SIZE - 1)] == n) continue;
+
+        uint32_t offset = 0;
+        for (int d = 0; d < CGV_RADIX_SIZE; ++d) {
+            uint32_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (uint64_t key: keys) {
+            scratch[count[(key >> shift) & (CGV_RADIX_SIZE - 1)]++] = key;
+        }
+        keys.swap(scratch);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cgvBox.h"
+
+/**
+ * Materials used to sort the render queue. The boxes with the same material are rendered together
+ */
+typedef enum {
+    CGV_MATERIAL_ID = 0, ///< Color as identifier (CGV_SELECT). It changes with every box
+    CGV_MATERIAL_SELECTED = 1, ///< Selected box (yellow), both pieces
+    CGV_MATERIAL_UNSELECTED = 2 ///< Non-selected box: all the bodies are rendered first, then all the top pieces
+} queueMaterial;
+
+/**
+ * cgvRenderQueue is the list of boxes to be rendered in a frame. Every box is a 64-bit key:
+ *
+ *   bit 63      render mode
+ *   bits 62-60  material (queueMaterial)
+ *   bits 59-40  depth from the camera, quantized to 20 bits (front to back)
+ *   bits 39-32  0
+ *   bits 31-0   index of the box
+ *
+ * Sorting the keys groups the boxes by material, so the material only changes a few times per frame, and renders
+ * every group from front to back, so that the depth test discards the hidden fragments as early as possible.
+ */
+class cgvRenderQueue {
+    std::vector<uint64_t> keys; ///< Keys of the boxes in the queue
+    std::vector<uint64_t> scratch; ///< Auxiliary buffer of the radix sort
+    std::vector<uint32_t> histogram; ///< Histograms of the digits of the radix sort
+
+public:
+    static const unsigned int DEPTH_BITS = 20; ///< Bits of the quantized depth
+
+    cgvRenderQueue() = default;
+    ~cgvRenderQueue() = default;
+
+    void clear() { keys.clear(); };
+    void reserve(size_t n) { keys.reserve(n); };
+
+    /**
+     * Add a box to the queue
+     * @param key Key of the box, created with make_key
+     */
+    void push(uint64_t key) { keys.push_back(key); };
+
+    void sort();
+
+    size_t size() const { return keys.size(); };
+    const std::vector<uint64_t> &get_keys() const { return keys; };
+
+    static uint64_t make_key(RenderMode mode, queueMaterial material, uint32_t depth, uint32_t box);
+
+    /// @return The index of the box of a key
+    static uint32_t get_box(uint64_t key) { return (uint32_t) key; };
+    /// @return The material of a key
+    static queueMaterial get_material(uint64_t key) { return (queueMaterial) ((key >> 60) & 0x7u); };
+};
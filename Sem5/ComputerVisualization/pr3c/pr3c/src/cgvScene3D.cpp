@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <cstdlib>
 #include <stdio.h>
 
 #include "cgvScene3D.h"
 
+const GLfloat cgvScene3D::light_position[4] = {5.0, 5.0, 5.0, 1}; // point light source
 
 // Constructor methods -----------------------------------
 
@@ -21,7 +23,23 @@ cgvScene3D::cgvScene3D() {
     };
 
     for (int i = 0; i < 3; ++i) {
-        boxes.push_back(cgvBox(c[i]));
+        add_box(cgvBox(c[i]), cgvPoint3D(0, i, 0)); // stack boxes along the Y-axis
+    }
+}
+
+/**
+ * Constructor method. It defines a tower of boxes, each one with a unique color as identifier
+ * @param n_boxes Number of boxes of the tower
+ * @pre It is assumed that n_boxes < 2^24 - 1, so that every identifier fits in an RGB color
+ * @post The boxes are identified by the colors 1, 2, ..., n_boxes (encoded as 0xRRGGBB)
+ */
+cgvScene3D::cgvScene3D(unsigned int n_boxes) {
+    axes = true;
+    isAnyBoxSelected = false;
+
+    reserve(n_boxes);
+    for (unsigned int i = 0; i < n_boxes; ++i) {
+        add_box(cgvBox(i + 1), cgvPoint3D(0, i, 0));
     }
 }
 
@@ -38,34 +56,337 @@ cgvScene3D::cgvScene3D() {
 void cgvScene3D::render(RenderMode mode) {
     // TODO: Section B: Add the required code to be able to transform the selected box.
 
+    // the mode is resolved once per frame: the rest of the frame is specialized at compile time
+    if (mode == CGV_SELECT) {
+        render_as<CGV_SELECT>();
+    } else {
+        render_as<CGV_DISPLAY>();
+    }
+}
+
+/**
+ * Render the scene in a mode known at compile time
+ * @tparam mode CGV_DISPLAY or CGV_SELECT
+ */
+template <RenderMode mode>
+void cgvScene3D::render_as() {
 
     // lights
-    GLfloat light0[4] = {5.0, 5.0, 5.0, 1}; // point light source
-    glLightfv(GL_LIGHT0,GL_POSITION, light0); // this light is placed here and it remains still
-    glEnable(GL_LIGHT0);
+    // this light is placed here and it remains still. It is only set again when the view changes
+    gl_state.light_position(GL_LIGHT0, light_position, camera ? camera->get_revision() : 0);
+    gl_state.enable(GL_LIGHT0);
 
     // create the model
     glPushMatrix(); // store the model matrices
 
+    // the boxes leave the static batch when they are rotated, and return to it later
+    if ((mode == CGV_DISPLAY) && static_batching) static_batch.update(*this);
+
+    if ((mode == CGV_DISPLAY) && layer_caching && camera && layer_cache.begin_frame(get_layer_key())) {
+        // the static layer is only rendered when it changes; the selected boxes are rendered over it in every frame
+        if (layer_cache.needs_static()) {
+            layer_cache.begin_static();
+            rendering_static_layer = true;
+            render_content<mode>();
+            rendering_static_layer = false;
+            layer_cache.end_static();
+        }
+        layer_cache.composite();
+        render_selected();
+    } else if ((mode == CGV_DISPLAY) && partial_redraw && camera && frame_cache.begin_frame(get_frame_key())) {
+        // the last frame is kept: only the region of the boxes whose selection or rotation changed is redrawn
+        if (frame_cache.needs_static()) {
+            frame_cache.begin_static();
+            render_content<mode>();
+            frame_cache.end_static();
+            dirty_region.reset(*this, *camera);
+        } else if (dirty_region.update(*this)) {
+            GLint rectangle[4];
+            dirty_region.get_region(rectangle);
+            frame_cache.begin_region(rectangle);
+            redrawing_region = true;
+            render_content<mode>();
+            redrawing_region = false;
+            frame_cache.end_region();
+        }
+        frame_cache.composite();
+    } else {
+        render_content<mode>();
+    }
+
+    glPopMatrix(); // restore the modelview matrix
+}
+
+/**
+ * Render the content of the scene (axes and boxes) in a mode known at compile time
+ * @tparam mode CGV_DISPLAY or CGV_SELECT
+ * @post While the static layer is rendered, the selected boxes that are not in the static batch are skipped. While a
+ * dirty region is redrawn, the boxes outside it are skipped (the static batch is clipped by the scissor test)
+ */
+template <RenderMode mode>
+void cgvScene3D::render_content() {
     // draw the axes
-    if ((axes) && (mode == CGV_DISPLAY)) draw_axes();
+    if ((mode == CGV_DISPLAY) && (axes)) draw_axes();
 
-    //
+    // the visibility of the boxes is updated in display mode and reused in selection mode
+    // a dirty region reuses the visibility of the last complete frame
+    if ((mode == CGV_DISPLAY) && occlusion_culling && !redrawing_region) {
+        occlusion.begin_frame(*this, camera ? camera->get_revision() : 0);
+    }
+    if (software_culling && camera && !redrawing_region) software_occlusion.cull(*this, *camera);
 
-    for (int i = 0; i < boxes.size(); ++i) {
-        glPushMatrix();
+    if ((mode == CGV_SELECT) && use_select_proxy) {
+        // neither the order of the boxes nor the impostors matter here: the proxies are drawn in a few calls
+        select_proxy.update(*this);
+        if (occlusion_culling || software_culling) {
+            select_proxy.draw_visible([this](uint32_t i) { return is_culled(i); });
+        } else {
+            select_proxy.draw();
+        }
+        return;
+    }
 
-        // Apply transformation: translate and rotate
-        glTranslatef(0, i, 0); // Stack boxes along the Y-axis
-        glRotatef(rotation[i][0], 0, 1, 0);
+    if (use_impostors && camera) impostors.begin_frame(*camera, mode);
 
+    // the static boxes are drawn first, the rest of the frame only renders the dynamic ones
+    if ((mode == CGV_DISPLAY) && static_batching) static_batch.draw(camera);
 
-        // Render the box
-        boxes[i].render(mode);
+    if (use_render_queue) {
+        build_queue<mode>();
+        render_queue<mode>();
+    } else {
+        render_unsorted<mode>();
+    }
+
+    if (use_impostors && camera) impostors.draw();
+    if ((mode == CGV_DISPLAY) && occlusion_culling && !redrawing_region) occlusion.issue_queries(*this, camera, gl_state);
+}
+
+/**
+ * Render the selected boxes that are not in the static batch, over the static layer
+ * @post Neither culling nor impostors are applied: the cost only depends on the number of selected boxes
+ */
+void cgvScene3D::render_selected() {
+    for (uint32_t i: selected_boxes) {
+        if (is_batched(i)) continue;
+        push_box_transform(i);
+        boxes[i].render_as<CGV_DISPLAY, true>(gl_state);
         glPopMatrix();
     }
+}
 
-    glPopMatrix(); // restore the modelview matrix
+/**
+ * @retval State of the scene rendered in the static layer: boxes, selection, static batch, view and options
+ */
+cgvLayerCache::layerKey cgvScene3D::get_layer_key() const {
+    const unsigned long options = (axes ? 1 : 0) | (use_render_queue ? 2 : 0) | (occlusion_culling ? 4 : 0) |
+                                  (software_culling ? 8 : 0) | (use_impostors ? 16 : 0) | (static_batching ? 32 : 0);
+    // the visibility of the occlusion queries changes in the next frames after a change
+    const unsigned long settling = (occlusion_culling && occlusion.needs_another_frame()) ? layer_cache.get_num_frames() : 0;
+    return {{revision, selection_changes, static_batch.get_num_moves(), camera ? camera->get_revision() : 0, options,
+             settling, layer_changes}};
+}
+
+/**
+ * @retval State of the scene rendered in the whole cached frame: the one of the static layer but the selection and the
+ * static batch, as their changes only affect the boxes of the dirty region
+ */
+cgvLayerCache::layerKey cgvScene3D::get_frame_key() const {
+    cgvLayerCache::layerKey key = get_layer_key();
+    key[1] = key[2] = 0;
+    key[5] = (occlusion_culling && occlusion.needs_another_frame()) ? frame_cache.get_num_frames() + 1 : 0;
+    return key;
+}
+
+/**
+ * Remove all the boxes of the scene
+ * @post The scene is empty and no box is selected
+ */
+void cgvScene3D::clear() {
+    boxes.clear();
+    positions.clear();
+    rotation.clear();
+    selected_boxes.clear();
+    isAnyBoxSelected = false;
+    dirty_boxes.clear();
+    is_dirty.clear();
+    ++revision;
+}
+
+/**
+ * Reserve memory for a number of boxes
+ * @param n_boxes Expected number of boxes of the scene
+ */
+void cgvScene3D::reserve(unsigned int n_boxes) {
+    boxes.reserve(n_boxes);
+    positions.reserve(n_boxes);
+    rotation.reserve(n_boxes);
+    is_dirty.reserve(n_boxes);
+}
+
+/**
+ * Add a box to the scene
+ * @param box The box, with its color as identifier
+ * @param position Position of the center of the box
+ * @param rotation_y Initial rotation (degrees) of the box around the Y axis
+ * @pre It is assumed that the identifier of the box is not used by any other box of the scene
+ * @post The box is added at the end of the list of boxes
+ */
+void cgvScene3D::add_box(const cgvBox &box, const cgvPoint3D &position, GLfloat rotation_y) {
+    boxes.push_back(box);
+    positions.push_back(position);
+    rotation.push_back({rotation_y, 0});
+    is_dirty.push_back(false);
+    if (box.isSelected()) selected_boxes.push_back((uint32_t) (boxes.size() - 1));
+    isAnyBoxSelected = isAnyBoxSelected || box.isSelected();
+    ++revision;
+}
+
+/**
+ * Replace the boxes of the scene with arrays of boxes, copied in bulk
+ * @param n_boxes Number of boxes
+ * @param _boxes Boxes, with their color as identifier and their selection
+ * @param _positions Position of the center of each box
+ * @param _rotations Rotation (degrees) of each box around Y and around X
+ * @pre It is assumed that the identifiers of the boxes are unique
+ * @post The scene has the boxes of the arrays, in the same order
+ */
+void cgvScene3D::assign_boxes(uint32_t n_boxes, const cgvBox *_boxes, const cgvPoint3D *_positions,
+                              const array<GLfloat, 2> *_rotations) {
+    clear();
+    append_boxes(n_boxes, _boxes, _positions, _rotations);
+}
+
+/**
+ * Add arrays of boxes at the end of the list of boxes, copied in bulk
+ * @param n_boxes Number of boxes
+ * @param _boxes Boxes, with their color as identifier and their selection
+ * @param _positions Position of the center of each box
+ * @param _rotations Rotation (degrees) of each box around Y and around X
+ * @pre It is assumed that the identifiers of the boxes are not used by any other box of the scene
+ * @post The boxes are added at the end of the list of boxes, in the same order
+ */
+void cgvScene3D::append_boxes(uint32_t n_boxes, const cgvBox *_boxes, const cgvPoint3D *_positions,
+                              const array<GLfloat, 2> *_rotations) {
+    const uint32_t first = (uint32_t) boxes.size();
+    boxes.insert(boxes.end(), _boxes, _boxes + n_boxes);
+    positions.insert(positions.end(), _positions, _positions + n_boxes);
+    rotation.insert(rotation.end(), _rotations, _rotations + n_boxes);
+    is_dirty.resize(boxes.size(), false);
+    for (uint32_t i = first; i < boxes.size(); ++i) {
+        if (boxes[i].isSelected()) selected_boxes.push_back(i);
+    }
+    isAnyBoxSelected = !selected_boxes.empty();
+    ++revision;
+}
+
+/**
+ * Remove boxes from the scene
+ * @param removed Indices of the boxes, in increasing order without repetitions
+ * @post The rest of the boxes keep their order, so the indices after a removed box change. The dirty boxes are
+ * forgotten, as with any other change of the list of boxes (get_revision)
+ */
+void cgvScene3D::remove_boxes(const vector<uint32_t> &removed) {
+    if (removed.empty()) return;
+
+    uint32_t kept = removed[0];
+    for (size_t r = 0; r < removed.size(); ++r) {
+        const uint32_t end = (r + 1 < removed.size()) ? removed[r + 1] : (uint32_t) boxes.size();
+        for (uint32_t i = removed[r] + 1; i < end; ++i, ++kept) {
+            boxes[kept] = boxes[i];
+            positions[kept] = positions[i];
+            rotation[kept] = rotation[i];
+        }
+    }
+    boxes.resize(kept);
+    positions.resize(kept);
+    rotation.resize(kept);
+
+    selected_boxes.clear();
+    for (uint32_t i = 0; i < kept; ++i) {
+        if (boxes[i].isSelected()) selected_boxes.push_back(i);
+    }
+    isAnyBoxSelected = !selected_boxes.empty();
+    dirty_boxes.clear();
+    is_dirty.assign(kept, false);
+    ++revision;
+}
+
+/**
+ * Change the position and the rotation of a box
+ * @param i Index of the box
+ * @param position New position of the center of the box
+ * @param _rotation New rotation (degrees) of the box around Y and around X
+ * @post The box is marked as dirty. Its index, identifier and selection do not change. A change of the rotation of a
+ * box that is not selected changes the static layer (get_layer_key), as a change of position does
+ */
+void cgvScene3D::move_box(uint32_t i, const cgvPoint3D &position, const array<GLfloat, 2> &_rotation) {
+    if ((positions[i][X] != position[X]) || (positions[i][Y] != position[Y]) || (positions[i][Z] != position[Z])) {
+        positions[i] = position;
+        ++box_moves;
+        ++layer_changes;
+    } else if (!boxes[i].isSelected() && ((rotation[i][0] != _rotation[0]) || (rotation[i][1] != _rotation[1]))) {
+        ++layer_changes;
+    }
+    rotation[i] = _rotation;
+    mark_dirty(i);
+}
+
+/**
+ * Compute the axis-aligned bounding box of the scene
+ * @param min Minimum corner of the bounding box
+ * @param max Maximum corner of the bounding box
+ * @post If the scene is empty, min = max = (0,0,0). The size of the boxes is taken into account conservatively,
+ * whatever their rotation is
+ */
+void cgvScene3D::get_bounds(cgvPoint3D &min, cgvPoint3D &max) const {
+    min.set(0, 0, 0);
+    max.set(0, 0, 0);
+    if (positions.empty()) return;
+
+    const float radius = cgvBox::bounding_radius();
+    min = max = positions[0];
+    for (const cgvPoint3D &p: positions) {
+        for (int c = X; c <= Z; ++c) {
+            if (p[c] < min[c]) min[c] = p[c];
+            if (p[c] > max[c]) max[c] = p[c];
+        }
+    }
+    min.set(min[X] - radius, min[Y] - radius, min[Z] - radius);
+    max.set(max[X] + radius, max[Y] + radius, max[Z] + radius);
+}
+
+/**
+ * Sort the boxes along a Morton curve over the bounding box of their positions, so that consecutive boxes are near
+ * @param order Output indices of the boxes, in Morton order. It is replaced
+ */
+void cgvScene3D::get_morton_order(vector<uint32_t> &order) const {
+    const uint32_t n_boxes = (uint32_t) positions.size();
+    order.resize(n_boxes);
+    if (n_boxes == 0) return;
+
+    cgvPoint3D scene_min = positions[0], scene_max = positions[0];
+    for (const cgvPoint3D &p: positions) {
+        for (int i = X; i <= Z; ++i) {
+            if (p[i] < scene_min[i]) scene_min[i] = p[i];
+            if (p[i] > scene_max[i]) scene_max[i] = p[i];
+        }
+    }
+
+    // Morton code of each box, with 10 bits per coordinate
+    vector<uint64_t> keys(n_boxes);
+    for (uint32_t b = 0; b < n_boxes; ++b) {
+        uint64_t code = 0;
+        for (int i = X; i <= Z; ++i) {
+            const float size = scene_max[i] - scene_min[i];
+            const uint32_t cell = (size > 0) ? (uint32_t) ((positions[b][i] - scene_min[i]) / size * 1023.0f) : 0;
+            for (int bit = 0; bit < 10; ++bit) code |= (uint64_t) ((cell >> bit) & 1) << (3 * bit + i);
+        }
+        keys[b] = (code << 32) | b;
+    }
+    sort(keys.begin(), keys.end());
+
+    for (uint32_t i = 0; i < n_boxes; ++i) order[i] = (uint32_t) keys[i];
 }
 
 /**
@@ -73,21 +394,154 @@ void cgvScene3D::render(RenderMode mode) {
  * @param _c RBG color
  * @pre It is assumed that the parameters are valid
  * @post The boxes that correspond to the color _c as identifier are marked as selected, the rest as not selected.
+ * The boxes whose selection changes are marked as dirty
  */
 void cgvScene3D::assignSelection(GLubyte _c[3]) {
     // TODO: Section A. Add the required code to select the corresponding box if any of them can be selected.
     bool selectCheck = false;
-    for (auto &box: boxes) {
+    bool changed = false;
+    selected_boxes.clear();
+    for (uint32_t i = 0; i < boxes.size(); ++i) {
+        cgvBox &box = boxes[i];
+        bool was_selected = box.isSelected();
         box.select(_c); // This will check if the color matches
         if (box.isSelected()) {
             selectCheck = true;
+            selected_boxes.push_back(i);
+        }
+        if (box.isSelected() != was_selected) {
+            mark_dirty(i);
+            changed = true;
         }
     }
     isAnyBoxSelected = selectCheck;
-    std::cout<<isAnyBoxSelected<<std::endl;
+    ++selection_requests;
+    if (changed) ++selection_changes;
 }
 
 
+/**
+ * Fill the render queue with every box, and sort it by material and distance to the camera
+ * @tparam mode CGV_DISPLAY or CGV_SELECT
+ * @post The queue contains one key per box in increasing order. If the scene has no camera, the boxes are only
+ * sorted by material. With occlusion culling (queries or software), the hidden boxes are not added, and the boxes
+ * replaced by impostors are added to the impostors instead. In display mode, the boxes of the static batch are not
+ * added either
+ */
+template <RenderMode mode>
+void cgvScene3D::build_queue() {
+    float view[16] = {0};
+    double znear = 0, zfar = 1;
+    if (camera) {
+        camera->get_view_matrix(view);
+        camera->get_depth_range(znear, zfar);
+    }
+    const float max_depth = (float) ((1u << cgvRenderQueue::DEPTH_BITS) - 1);
+    const float scale = max_depth / (float) (zfar - znear);
+
+    queue.clear();
+    queue.reserve(boxes.size());
+    for (uint32_t i = 0; i < boxes.size(); ++i) {
+        if ((mode == CGV_DISPLAY) && is_drawn_apart(i)) continue;
+        if (is_culled(i)) continue;
+        if (use_impostors && impostors.add(boxes[i], positions[i], rotation[i][0])) continue;
+
+        // distance from the camera to the center of the box along the direction of view
+        const cgvPoint3D &p = positions[i];
+        float z = -(view[2] * p[X] + view[6] * p[Y] + view[10] * p[Z] + view[14]);
+        float d = (z - (float) znear) * scale;
+        uint32_t depth = (d <= 0) ? 0 : ((d >= max_depth) ? (uint32_t) max_depth : (uint32_t) d);
+
+        queueMaterial material = (mode == CGV_SELECT) ? CGV_MATERIAL_ID :
+                                 (boxes[i].isSelected() ? CGV_MATERIAL_SELECTED : CGV_MATERIAL_UNSELECTED);
+        queue.push(cgvRenderQueue::make_key(mode, material, depth, i));
+    }
+
+    queue.sort();
+}
+
+/**
+ * Render the boxes in the order of the render queue
+ * @tparam mode CGV_DISPLAY or CGV_SELECT
+ * @post In selection mode every box is rendered with its color as identifier. In display mode, the selected boxes
+ * are rendered first, then the non-selected ones in two passes (all the bodies, then all the top pieces), so that
+ * their material is only set once per pass
+ */
+template <RenderMode mode>
+void cgvScene3D::render_queue() {
+    const vector<uint64_t> &keys = queue.get_keys();
+    const uint64_t *first = keys.data(), *last = keys.data() + keys.size();
+
+    if (mode == CGV_SELECT) {
+        for (const uint64_t *k = first; k != last; ++k) {
+            uint32_t i = cgvRenderQueue::get_box(*k);
+            push_box_transform(i);
+            boxes[i].render_as<CGV_SELECT, false>(gl_state);
+            glPopMatrix();
+        }
+        return;
+    }
+
+    // the keys are sorted by material: selected boxes first
+    const uint64_t *unselected = first;
+    while ((unselected != last) && (cgvRenderQueue::get_material(*unselected) == CGV_MATERIAL_SELECTED)) ++unselected;
+
+    for (const uint64_t *k = first; k != unselected; ++k) {
+        uint32_t i = cgvRenderQueue::get_box(*k);
+        push_box_transform(i);
+        boxes[i].render_as<CGV_DISPLAY, true>(gl_state);
+        glPopMatrix();
+    }
+
+    if (unselected == last) return;
+    for (boxPart part: {CGV_BOX_BODY, CGV_BOX_TOP}) {
+        // all the non-selected boxes share the material of each piece
+        boxes[cgvRenderQueue::get_box(*unselected)].apply_material_as<CGV_DISPLAY, false>(part, gl_state);
+        for (const uint64_t *k = unselected; k != last; ++k) {
+            push_box_transform(cgvRenderQueue::get_box(*k));
+            cgvBox::draw_part(part, gl_state);
+            glPopMatrix();
+        }
+    }
+}
+
+/**
+ * Render the boxes in the order of the list of boxes
+ * @tparam mode CGV_DISPLAY or CGV_SELECT
+ */
+template <RenderMode mode>
+void cgvScene3D::render_unsorted() {
+    for (int i = 0; i < boxes.size(); ++i) {
+        if ((mode == CGV_DISPLAY) && is_drawn_apart(i)) continue;
+        if (is_culled(i)) continue;
+        if (use_impostors && impostors.add(boxes[i], positions[i], rotation[i][0])) continue;
+
+        // Apply transformation: translate and rotate
+        push_box_transform(i);
+
+        // Render the box
+        if (mode == CGV_SELECT) {
+            boxes[i].render_as<CGV_SELECT, false>(gl_state);
+        } else if (boxes[i].isSelected()) {
+            boxes[i].render_as<CGV_DISPLAY, true>(gl_state);
+        } else {
+            boxes[i].render_as<CGV_DISPLAY, false>(gl_state);
+        }
+        glPopMatrix();
+    }
+}
+
+/**
+ * Store the modelview matrix and apply the transformation of a box (translation and rotation)
+ * @param i Index of the box
+ * @post The caller must restore the modelview matrix with glPopMatrix
+ */
+void cgvScene3D::push_box_transform(uint32_t i) {
+    glPushMatrix();
+    glTranslatef(positions[i][X], positions[i][Y], positions[i][Z]);
+    glRotatef(rotation[i][0], 0, 1, 0);
+}
+
 /**
  * Method to render the axes
  */
@@ -97,25 +551,80 @@ void cgvScene3D::draw_axes(void) {
     GLfloat blue[] = {0, 0, 1, 1.0};
 
     glBegin(GL_LINES);
-    glMaterialfv(GL_FRONT,GL_EMISSION, red);
+    gl_state.material_emission(GL_FRONT, red);
     glVertex3f(1000, 0, 0);
     glVertex3f(-1000, 0, 0);
 
-    glMaterialfv(GL_FRONT,GL_EMISSION, green);
+    gl_state.material_emission(GL_FRONT, green);
     glVertex3f(0, 1000, 0);
     glVertex3f(0, -1000, 0);
 
-    glMaterialfv(GL_FRONT,GL_EMISSION, blue);
+    gl_state.material_emission(GL_FRONT, blue);
     glVertex3f(0, 0, 1000);
     glVertex3f(0, 0, -1000);
     glEnd();
 }
 
+/**
+ * Rotate the selected boxes
+ * @param x Increment of the rotation around the Y axis (degrees)
+ * @param y Increment of the rotation around the X axis (degrees)
+ * @post The selected boxes are marked as dirty
+ */
 void cgvScene3D::updateRotation(GLint x, GLint y) {
-    for (int i = 0; i < 3; ++i) {
+    for (uint32_t i = 0; i < boxes.size(); ++i) {
         if (boxes[i].isSelected()) {
             rotation[i][0] += x;
             rotation[i][1] += y;
+            mark_dirty(i);
         }
     }
 }
+
+/**
+ * @retval Memory used by each box of the scene without any optional renderer: the box, its position and rotation,
+ * and its state in the list of dirty boxes
+ */
+uint32_t cgvScene3D::get_base_bytes_per_box() {
+    return (uint32_t) (sizeof(cgvBox) + sizeof(cgvPoint3D) + sizeof(array<GLfloat, 2>) + sizeof(uint32_t) + 1);
+}
+
+/**
+ * @retval Memory used by each box of the scene with the renderers and options that are enabled now. It changes when
+ * those options are toggled
+ */
+uint32_t cgvScene3D::get_bytes_per_box() const {
+    uint32_t bytes = get_base_bytes_per_box();
+    if (use_render_queue) bytes += 2 * sizeof(uint64_t); // keys and scratch of the radix sort
+    if (occlusion_culling) bytes += cgvOcclusionCuller::get_bytes_per_box();
+    if (software_culling) bytes += cgvSoftwareOccluder::get_bytes_per_box();
+    if (use_impostors) bytes += cgvImpostors::get_bytes_per_box();
+    if (use_select_proxy) bytes += cgvSelectionProxy::get_bytes_per_box();
+    if (static_batching) bytes += cgvStaticBatch::get_bytes_per_box();
+    if (partial_redraw) bytes += cgvDirtyRegion::get_bytes_per_box();
+    return bytes;
+}
+
+/**
+ * Get the boxes whose rotation, selection or position changed since the last call
+ * @param changed Output list of indices of boxes, without repetitions. It is replaced
+ * @post The list of dirty boxes of the scene is empty. Adding or removing boxes is not reported here, but with a new
+ * value of get_revision()
+ */
+void cgvScene3D::take_dirty_boxes(vector<uint32_t> &changed) {
+    changed.swap(dirty_boxes);
+    dirty_boxes.clear();
+    for (uint32_t i: changed) is_dirty[i] = false;
+}
+
+/**
+ * Add a box to the list of dirty boxes, if it is not already there
+ * @param i Index of the box
+ */
+void cgvScene3D::mark_dirty(uint32_t i) {
+    ++box_changes;
+    if (!is_dirty[i]) {
+        is_dirty[i] = true;
+        dirty_boxes.push_back(i);
+    }
+}
@@ -10,8 +10,20 @@
 #endif
 
 
+#include <array>
 #include <vector>
 #include "cgvBox.h"
+#include "cgvCamera.h"
+#include "cgvGLState.h"
+#include "cgvPoint.h"
+#include "cgvRenderQueue.h"
+#include "cgvOcclusionCuller.h"
+#include "cgvSoftwareOccluder.h"
+#include "cgvImpostors.h"
+#include "cgvSelectionProxy.h"
+#include "cgvStaticBatch.h"
+#include "cgvLayerCache.h"
+#include "cgvDirtyRegion.h"
 
 using namespace std;
 
@@ -21,18 +33,62 @@ using namespace std;
 class cgvScene3D {
 private:
     vector<cgvBox> boxes; ///< List of boxes in the scene
+    vector<cgvPoint3D> positions; ///< Position of each box in the scene
 
     // TODO: Section B: Add the required attributes to be able to transform the selected box.
 
     // Additional attributes
     bool isAnyBoxSelected = false; // Whether any box is selected
-    GLfloat rotation[3][2];
+    vector<array<GLfloat, 2> > rotation; ///< Rotation angles of each box (around Y, around X)
     bool axes = true; ///< It indicates whether the axes are rendered or not
 
+    const cgvCamera *camera = nullptr; ///< Camera whose view is applied when the scene is rendered (optional)
+    cgvGLState gl_state; ///< Shadow of the OpenGL state, to drop redundant changes
+
+    bool use_render_queue = true; ///< true: the boxes are sorted by material and depth before being rendered
+    cgvRenderQueue queue; ///< Pieces of the boxes to be rendered in the current frame
+
+    unsigned long revision = 1; ///< It is incremented every time boxes are added or removed
+    vector<uint32_t> dirty_boxes; ///< Boxes whose rotation, selection or position changed since the last take_dirty_boxes
+    vector<bool> is_dirty; ///< Whether each box is in dirty_boxes
+    unsigned long box_changes = 0; ///< Number of changes of rotation, selection or position of the boxes
+    unsigned long box_moves = 0; ///< Number of changes of position of the boxes
+    unsigned long layer_changes = 0; ///< Number of changes of position of the boxes, or of rotation of the boxes that are not selected
+
+    bool occlusion_culling = false; ///< true: the boxes hidden in the previous frames are not rendered
+    cgvOcclusionCuller occlusion; ///< Visibility of the boxes for occlusion_culling
+
+    bool software_culling = false; ///< true: the boxes hidden by the nearest ones (computed in the CPU) are not rendered
+    cgvSoftwareOccluder software_occlusion; ///< Visibility of the boxes for software_culling, updated in every frame
+
+    bool use_impostors = false; ///< true: the boxes that cover few pixels are replaced by impostors
+    cgvImpostors impostors; ///< Impostors of the current frame
+
+    bool use_select_proxy = true; ///< true: the boxes are rendered in selection mode with their proxies
+    cgvSelectionProxy select_proxy; ///< Proxies of the boxes for selection mode
+
+    bool static_batching = false; ///< true: the boxes that are not rotated are rendered from a merged vertex buffer
+    cgvStaticBatch static_batch; ///< Merged geometry of the static boxes, for display mode
+
+    bool layer_caching = false; ///< true: the static layer is reused while only the selected boxes change
+    cgvLayerCache layer_cache; ///< Static layer: axes and every box but the selected ones
+    bool rendering_static_layer = false; ///< The static layer is being rendered: the selected boxes are skipped
+    vector<uint32_t> selected_boxes; ///< Indices of the selected boxes
+    unsigned long selection_changes = 0; ///< Number of calls to assignSelection that changed the selection
+    unsigned long selection_requests = 0; ///< Number of calls to assignSelection
+
+    bool partial_redraw = false; ///< true: when only the selection or rotation of some boxes changes, only their region is redrawn
+    cgvLayerCache frame_cache; ///< Last frame, where the dirty regions are redrawn
+    cgvDirtyRegion dirty_region; ///< Region of the last frame that must be redrawn
+    bool redrawing_region = false; ///< The dirty region is being redrawn: the boxes outside it are skipped
+
 
 public:
+    static const GLfloat light_position[4]; ///< Point light source, in world coordinates
+
     // Default constructor and destructor
     cgvScene3D();
+    explicit cgvScene3D(unsigned int n_boxes);
 
     ~cgvScene3D() = default;
 
@@ -42,12 +98,114 @@ public:
 
     void assignSelection(GLubyte _c[3]);
 
-    bool get_axes() { return axes; };
+    bool get_axes() const { return axes; };
     void set_axes(bool _axes) { axes = _axes; };
     void updateRotation(GLint x, GLint y);
 
     bool return_isAnyBoxSelected() { return isAnyBoxSelected; };
 
+    unsigned int get_num_boxes() const { return (unsigned int) boxes.size(); };
+
+    void set_camera(const cgvCamera *_camera) { camera = _camera; };
+    bool get_render_queue() const { return use_render_queue; };
+    void set_render_queue(bool _use_render_queue) { use_render_queue = _use_render_queue; };
+    bool get_occlusion_culling() const { return occlusion_culling; };
+    void set_occlusion_culling(bool _occlusion_culling) { occlusion_culling = _occlusion_culling; };
+    const cgvOcclusionCuller &get_occlusion() const { return occlusion; };
+    bool get_software_culling() const { return software_culling; };
+    void set_software_culling(bool _software_culling) { software_culling = _software_culling; };
+    cgvSoftwareOccluder &get_software_occlusion() { return software_occlusion; };
+    bool get_impostors() const { return use_impostors; };
+    void set_impostors(bool _use_impostors) { use_impostors = _use_impostors; };
+    cgvImpostors &get_impostor_renderer() { return impostors; };
+    bool get_select_proxy() const { return use_select_proxy; };
+    void set_select_proxy(bool _use_select_proxy) { use_select_proxy = _use_select_proxy; };
+    bool get_static_batching() const { return static_batching; };
+    void set_static_batching(bool _static_batching) { static_batching = _static_batching; };
+    const cgvStaticBatch &get_static_batch() const { return static_batch; };
+    bool get_layer_caching() const { return layer_caching; };
+    void set_layer_caching(bool _layer_caching) { layer_caching = _layer_caching; };
+    const cgvLayerCache &get_layer_cache() const { return layer_cache; };
+    bool get_partial_redraw() const { return partial_redraw; };
+    void set_partial_redraw(bool _partial_redraw) { partial_redraw = _partial_redraw; };
+    const cgvLayerCache &get_frame_cache() const { return frame_cache; };
+    const cgvDirtyRegion &get_dirty_region() const { return dirty_region; };
+    cgvGLState &get_gl_state() { return gl_state; };
+
+    // read-only access to the boxes, for the renderers that do not use the fixed-function pipeline
+    const vector<cgvBox> &get_boxes() const { return boxes; };
+    const vector<cgvPoint3D> &get_positions() const { return positions; };
+    const vector<array<GLfloat, 2> > &get_rotations() const { return rotation; };
+
+    /**
+     * @retval Number that changes every time boxes are added or removed (never 0)
+     */
+    unsigned long get_revision() const { return revision; };
+    unsigned long get_num_box_changes() const { return box_changes; };
+    unsigned long get_num_box_moves() const { return box_moves; };
+    unsigned long get_num_selection_requests() const { return selection_requests; };
+    static uint32_t get_base_bytes_per_box();
+    uint32_t get_bytes_per_box() const;
+    void take_dirty_boxes(vector<uint32_t> &changed);
+
+    // Methods to build the scene
+    void clear();
+    void reserve(unsigned int n_boxes);
+    void add_box(const cgvBox &box, const cgvPoint3D &position, GLfloat rotation_y = 0);
+    void assign_boxes(uint32_t n_boxes, const cgvBox *_boxes, const cgvPoint3D *_positions,
+                      const array<GLfloat, 2> *_rotations);
+    void append_boxes(uint32_t n_boxes, const cgvBox *_boxes, const cgvPoint3D *_positions,
+                      const array<GLfloat, 2> *_rotations);
+    void remove_boxes(const vector<uint32_t> &removed);
+    void move_box(uint32_t i, const cgvPoint3D &position, const array<GLfloat, 2> &_rotation);
+
+    void get_bounds(cgvPoint3D &min, cgvPoint3D &max) const;
+    void get_morton_order(vector<uint32_t> &order) const;
+
 private:
     void draw_axes();
+
+    // rendering specialized at compile time for each mode
+    template <RenderMode mode>
+    void render_as();
+    template <RenderMode mode>
+    void render_content();
+    void render_selected();
+    cgvLayerCache::layerKey get_layer_key() const;
+    cgvLayerCache::layerKey get_frame_key() const;
+    template <RenderMode mode>
+    void build_queue();
+    template <RenderMode mode>
+    void render_queue();
+    template <RenderMode mode>
+    void render_unsorted();
+
+    void push_box_transform(uint32_t i);
+
+    /**
+     * @param i Index of a box
+     * @retval true if the box is not rendered in this frame because of occlusion culling
+     */
+    bool is_culled(uint32_t i) const {
+        return (occlusion_culling && !occlusion.is_visible(i)) ||
+               (software_culling && camera && software_occlusion.is_occluded(i));
+    };
+
+    /**
+     * @param i Index of a box
+     * @retval true if the box has already been rendered in this frame by the static batch (display mode)
+     */
+    bool is_batched(uint32_t i) const { return static_batching && static_batch.is_static(i); };
+
+    /**
+     * @param i Index of a box
+     * @retval true if the box is not rendered with the rest in display mode: it is in the static batch, or it is
+     * selected and the static layer is being rendered, or it is outside the dirty region that is being redrawn
+     */
+    bool is_drawn_apart(uint32_t i) const {
+        return is_batched(i) || (rendering_static_layer && boxes[i].isSelected()) ||
+               (redrawing_region && !dirty_region.is_in_region(i));
+    };
+
+    void mark_dirty(uint32_t i);
 };
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <unordered_map>
+
+#include "cgvSceneDiff.h"
+#include "cgvScene3D.h"
+#include "cgvSnapshot.h"
+
+/**
+ * Compute the changes from a scene to a snapshot
+ * @param scene The scene
+ * @param snapshot The snapshot, open
+ * @retval true if the snapshot is valid. Otherwise (corrupt boxes or repeated identifiers), the reason is written to
+ * stderr and the diff is empty
+ * @post The boxes are compared in place while the scene and the snapshot have the same identifiers in the same order,
+ * which is the usual case when the snapshot has been edited from a save of the scene; the rest are found by their
+ * identifier
+ */
+bool cgvSceneDiff::compute(const cgvScene3D &scene, const cgvSnapshot &snapshot) {
+	clear();
+	const vector<cgvBox> &boxes = scene.get_boxes();
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	const uint32_t n_boxes = (uint32_t) boxes.size();
+	const uint32_t n_snapshot = (uint32_t) snapshot.get_num_boxes();
+
+	std::vector<uint8_t> matched(n_boxes, 0);
+	std::unordered_map<GLuint, uint32_t> index; // identifier -> box of the scene, built at the first mismatch
+	std::vector<cgvBox> chunk_boxes(CHUNK_SIZE);
+	std::vector<cgvPoint3D> chunk_positions(CHUNK_SIZE);
+	std::vector<array<GLfloat, 2> > chunk_rotations(CHUNK_SIZE);
+	for (uint32_t first = 0; first < n_snapshot; first += CHUNK_SIZE) {
+		const uint32_t n = (n_snapshot - first < CHUNK_SIZE) ? n_snapshot - first : CHUNK_SIZE;
+		if (!snapshot.read_boxes(first, n, chunk_boxes.data(), chunk_positions.data(), chunk_rotations.data())) {
+			clear();
+			return false;
+		}
+
+		for (uint32_t k = 0; k < n; ++k) {
+			const GLuint id = chunk_boxes[k].get_id();
+			uint32_t i = first + k;
+			if ((i >= n_boxes) || (boxes[i].get_id() != id)) {
+				if (index.empty()) {
+					index.reserve(n_boxes);
+					for (uint32_t j = 0; j < n_boxes; ++j) index[boxes[j].get_id()] = j;
+				}
+				auto found = index.find(id);
+				i = (found != index.end()) ? found->second : n_boxes;
+			}
+
+			if (i == n_boxes) {
+				GLubyte color[3];
+				cgvBox::id_to_color(id, color);
+				inserted.push_back(cgvBox(color));
+				inserted_positions.push_back(chunk_positions[k]);
+				inserted_rotations.push_back(chunk_rotations[k]);
+				continue;
+			}
+			if (matched[i]) {
+				fprintf(stderr, "cgvSceneDiff: the identifier %u is repeated in the snapshot\n", id);
+				clear();
+				return false;
+			}
+			matched[i] = 1;
+
+			const cgvPoint3D &p = chunk_positions[k];
+			if ((positions[i][X] != p[X]) || (positions[i][Y] != p[Y]) || (positions[i][Z] != p[Z]) ||
+			    (rotations[i] != chunk_rotations[k])) {
+				modified.push_back(i);
+				modified_positions.push_back(p);
+				modified_rotations.push_back(chunk_rotations[k]);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < n_boxes; ++i) {
+		if (!matched[i]) removed.push_back(i);
+	}
+	return true;
+}
+
+/**
+ * Apply the changes to a scene
+ * @param scene The scene given to compute, without changes since then
+ * @post The modified boxes are moved (they keep their index), the removed boxes are removed, and the inserted ones are
+ * added at the end of the list of boxes
+ */
+void cgvSceneDiff::apply(cgvScene3D &scene) const {
+	// the indices of the modified boxes change once boxes are removed
+	for (size_t m = 0; m < modified.size(); ++m) {
+		scene.move_box(modified[m], modified_positions[m], modified_rotations[m]);
+	}
+	scene.remove_boxes(removed);
+	if (!inserted.empty()) {
+		scene.append_boxes((uint32_t) inserted.size(), inserted.data(), inserted_positions.data(),
+		                   inserted_rotations.data());
+	}
+}
+
+/**
+ * Forget the changes
+ */
+void cgvSceneDiff::clear() {
+	removed.clear();
+	modified.clear();
+	modified_positions.clear();
+	modified_rotations.clear();
+	inserted.clear();
+	inserted_positions.clear();
+	inserted_rotations.clear();
+}
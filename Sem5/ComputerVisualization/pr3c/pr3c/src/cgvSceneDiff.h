@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+#include "cgvBox.h"
+#include "cgvPoint.h"
+
+class cgvScene3D;
+class cgvSnapshot;
+
+/**
+ * cgvSceneDiff holds the changes between the boxes of a scene and the ones of a snapshot, matched by their
+ * identifier (color_as_ID): the boxes of the snapshot that are not in the scene (inserted), the boxes of the scene that
+ * are not in the snapshot (removed), and the boxes of both with a different position or rotation (modified). Applying
+ * it makes the scene equal to the snapshot, except for the selection, which is kept (the inserted boxes are not
+ * selected).
+ * The modified boxes are changed in place, so the renderers only update them (see cgvScene3D::move_box); inserting or
+ * removing boxes changes the list of boxes, so it is done in a single pass.
+ */
+class cgvSceneDiff {
+public:
+	static const uint32_t CHUNK_SIZE = 16384; ///< Boxes read from the snapshot at once
+
+private:
+	std::vector<uint32_t> removed; ///< Indices of the removed boxes in the scene, in increasing order
+	std::vector<uint32_t> modified; ///< Indices of the modified boxes in the scene
+	std::vector<cgvPoint3D> modified_positions; ///< New position of each modified box
+	std::vector<std::array<float, 2> > modified_rotations; ///< New rotation of each modified box
+	std::vector<cgvBox> inserted; ///< Inserted boxes, in the order of the snapshot
+	std::vector<cgvPoint3D> inserted_positions; ///< Position of each inserted box
+	std::vector<std::array<float, 2> > inserted_rotations; ///< Rotation of each inserted box
+
+public:
+	cgvSceneDiff() = default;
+	~cgvSceneDiff() = default;
+
+	bool compute(const cgvScene3D &scene, const cgvSnapshot &snapshot);
+	void apply(cgvScene3D &scene) const;
+	void clear();
+
+	bool is_empty() const { return removed.empty() && modified.empty() && inserted.empty(); };
+	uint32_t get_num_removed() const { return (uint32_t) removed.size(); };
+	uint32_t get_num_modified() const { return (uint32_t) modified.size(); };
+	uint32_t get_num_inserted() const { return (uint32_t) inserted.size(); };
+};
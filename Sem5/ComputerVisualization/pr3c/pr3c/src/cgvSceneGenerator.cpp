@@ -0,0 +1,213 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+
+#include "cgvSceneGenerator.h"
+
+// Separation between the centers of neighbour boxes in the grid layout. The boxes are 1.15 x 1 x 2.05
+#define CGV_GRID_SPACING_X 1.5f
+#define CGV_GRID_SPACING_Y 1.5f
+#define CGV_GRID_SPACING_Z 2.5f
+
+/**
+ * Constructor
+ * @param _layout Layout of the scene
+ * @param _n_boxes Number of boxes of the scene
+ * @param _seed Seed of the random number generator
+ * @pre It is assumed that _n_boxes <= max_boxes()
+ */
+cgvSceneGenerator::cgvSceneGenerator(sceneLayout _layout, unsigned int _n_boxes, uint64_t _seed)
+    : layout(_layout), n_boxes(_n_boxes), seed(_seed) {
+}
+
+/**
+ * Generate the scene
+ * @param scene The scene to be filled
+ * @post The previous content of the scene is removed and n_boxes boxes are added with the identifiers 1..n_boxes
+ */
+void cgvSceneGenerator::generate(cgvScene3D &scene) {
+    state = seed;
+
+    scene.clear();
+    scene.reserve(n_boxes);
+
+    switch (layout) {
+        case CGV_LAYOUT_TOWER:
+            generate_tower(scene);
+            break;
+        case CGV_LAYOUT_GRID:
+            generate_grid(scene);
+            break;
+        case CGV_LAYOUT_CLUSTERS:
+            generate_clusters(scene);
+            break;
+        case CGV_LAYOUT_DENSE_STACK:
+            generate_dense_stack(scene);
+            break;
+    }
+}
+
+/**
+ * Read the options of the generator from the command line: --layout <tower|grid|clusters|dense>, --boxes <n>
+ * and --seed <n>
+ * @param argc Number of parameters of the command line
+ * @param argv Parameters of the command line
+ * @param i Index of the parameter to be read
+ * @return The number of parameters consumed (0 if argv[i] is not an option of the generator, -1 if its value is
+ * missing or not valid)
+ */
+int cgvSceneGenerator::parse_args(int argc, char **argv, int i) {
+    if (strcmp(argv[i], "--layout") && strcmp(argv[i], "--boxes") && strcmp(argv[i], "--seed")) {
+        return 0;
+    }
+    if (i + 1 >= argc) {
+        return -1; // the value of the option is missing
+    }
+
+    char *end = nullptr;
+    if (!strcmp(argv[i], "--layout")) {
+        return parse_layout(argv[i + 1], layout) ? 2 : -1;
+    }
+    if (!strcmp(argv[i], "--boxes")) {
+        unsigned long n = strtoul(argv[i + 1], &end, 10);
+        if ((*argv[i + 1] == '\0') || (*end != '\0') || (n == 0) || (n > max_boxes())) {
+            return -1;
+        }
+        n_boxes = (unsigned int) n;
+        return 2;
+    }
+    unsigned long long value = strtoull(argv[i + 1], &end, 10);
+    if ((*argv[i + 1] == '\0') || (*end != '\0')) {
+        return -1;
+    }
+    seed = value;
+    return 2;
+}
+
+/**
+ * Translate the name of a layout
+ * @param name tower, grid, clusters or dense
+ * @param _layout The corresponding layout
+ * @retval true if the name is valid, false otherwise
+ */
+bool cgvSceneGenerator::parse_layout(const char *name, sceneLayout &_layout) {
+    if (!strcmp(name, "tower")) _layout = CGV_LAYOUT_TOWER;
+    else if (!strcmp(name, "grid")) _layout = CGV_LAYOUT_GRID;
+    else if (!strcmp(name, "clusters")) _layout = CGV_LAYOUT_CLUSTERS;
+    else if (!strcmp(name, "dense")) _layout = CGV_LAYOUT_DENSE_STACK;
+    else return false;
+    return true;
+}
+
+
+// Private methods ---------------------------------------
+
+/**
+ * Boxes stacked along the Y axis, one unit apart
+ */
+void cgvSceneGenerator::generate_tower(cgvScene3D &scene) {
+    for (unsigned int i = 0; i < n_boxes; ++i) {
+        scene.add_box(cgvBox(i + 1), cgvPoint3D(0, (float) i, 0));
+    }
+}
+
+/**
+ * Boxes on a square grid in the XZ plane. When the grid has more than 256 x 256 cells, the boxes are distributed
+ * in several floors, so that the scene is a cube of boxes
+ */
+void cgvSceneGenerator::generate_grid(cgvScene3D &scene) {
+    unsigned int side = (unsigned int) ceil(sqrt((double) n_boxes));
+    unsigned int floors = 1;
+    if (side > 256) {
+        side = (unsigned int) ceil(cbrt((double) n_boxes));
+        floors = (n_boxes + side * side - 1) / (side * side);
+    }
+
+    const float x0 = -0.5f * CGV_GRID_SPACING_X * (side - 1);
+    const float z0 = -0.5f * CGV_GRID_SPACING_Z * (side - 1);
+    const float y0 = -0.5f * CGV_GRID_SPACING_Y * (floors - 1);
+
+    for (unsigned int i = 0; i < n_boxes; ++i) {
+        unsigned int col = i % side;
+        unsigned int row = (i / side) % side;
+        unsigned int floor = i / (side * side);
+        scene.add_box(cgvBox(i + 1), cgvPoint3D(x0 + col * CGV_GRID_SPACING_X,
+                                                 y0 + floor * CGV_GRID_SPACING_Y,
+                                                 z0 + row * CGV_GRID_SPACING_Z));
+    }
+}
+
+/**
+ * Clusters of about 1000 boxes. The centers of the clusters are uniformly distributed in a cube whose volume grows
+ * with the number of boxes; the boxes of a cluster are placed around its center with a bell-shaped distribution
+ */
+void cgvSceneGenerator::generate_clusters(cgvScene3D &scene) {
+    const unsigned int boxes_per_cluster = 1000;
+    const unsigned int n_clusters = (n_boxes + boxes_per_cluster - 1) / boxes_per_cluster;
+    const float half_world = 10.0f * (float) cbrt((double) n_clusters);
+    const float radius = 8.0f;
+
+    for (unsigned int c = 0; c < n_clusters; ++c) {
+        // the order of evaluation of the arguments is unspecified: the values are drawn in a fixed order
+        const float cx = uniform(-half_world, half_world);
+        const float cy = uniform(-half_world, half_world);
+        const float cz = uniform(-half_world, half_world);
+        cgvPoint3D center(cx, cy, cz);
+        unsigned int first = c * boxes_per_cluster;
+        unsigned int last = (first + boxes_per_cluster < n_boxes) ? first + boxes_per_cluster : n_boxes;
+
+        for (unsigned int i = first; i < last; ++i) {
+            // the sum of three uniform variables approximates a normal distribution
+            float d[3];
+            for (float &v: d) {
+                const float u0 = uniform(-1, 1);
+                const float u1 = uniform(-1, 1);
+                const float u2 = uniform(-1, 1);
+                v = (u0 + u1 + u2) * (radius / 3);
+            }
+            scene.add_box(cgvBox(i + 1), cgvPoint3D(center[X] + d[0], center[Y] + d[1], center[Z] + d[2]),
+                          uniform(0, 360));
+        }
+    }
+}
+
+/**
+ * Narrow columns of overlapping boxes: each column has at most 10000 boxes that advance 0.2 units along the Y axis,
+ * so every box intersects the four previous and next ones
+ */
+void cgvSceneGenerator::generate_dense_stack(cgvScene3D &scene) {
+    const unsigned int boxes_per_stack = 10000;
+    const unsigned int n_stacks = (n_boxes + boxes_per_stack - 1) / boxes_per_stack;
+    const unsigned int side = (unsigned int) ceil(sqrt((double) n_stacks));
+
+    for (unsigned int i = 0; i < n_boxes; ++i) {
+        unsigned int stack = i / boxes_per_stack;
+        float x = 4.0f * (stack % side) + uniform(-0.5f, 0.5f);
+        float z = 4.0f * (stack / side) + uniform(-0.5f, 0.5f);
+        float y = 0.2f * (i % boxes_per_stack);
+        scene.add_box(cgvBox(i + 1), cgvPoint3D(x, y, z), uniform(0, 360));
+    }
+}
+
+/**
+ * Random number generator splitmix64. It is used instead of the distributions of <random> because their results
+ * depend on the implementation of the standard library
+ * @return A 64-bit random number
+ */
+uint64_t cgvSceneGenerator::next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @param min Minimum value
+ * @param max Maximum value
+ * @return A random number uniformly distributed in [min, max)
+ */
+float cgvSceneGenerator::uniform(float min, float max) {
+    float t = (float) (next() >> 40) * (1.0f / 16777216.0f); // 24 random bits in [0, 1)
+    return min + t * (max - min);
+}
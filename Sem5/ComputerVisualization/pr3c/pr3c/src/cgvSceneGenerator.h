@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cgvScene3D.h"
+
+/**
+ * Layouts of the scenes that can be generated
+ */
+typedef enum {
+    CGV_LAYOUT_TOWER, ///< Boxes stacked along the Y axis, as in the original scene
+    CGV_LAYOUT_GRID, ///< Boxes on a regular grid in the XZ plane, in several floors if needed
+    CGV_LAYOUT_CLUSTERS, ///< Groups of randomly placed and rotated boxes around random centers
+    CGV_LAYOUT_DENSE_STACK ///< Randomly rotated boxes that overlap in a narrow column
+} sceneLayout;
+
+/**
+ * cgvSceneGenerator builds scenes of an arbitrary number of boxes with a parameterized layout. The scenes are
+ * deterministic: the same parameters (including the seed) always produce the same scene on every platform.
+ * The boxes are identified by the colors 1, 2, ..., n_boxes, so that the color buffer selection technique works.
+ */
+class cgvSceneGenerator {
+    sceneLayout layout = CGV_LAYOUT_TOWER; ///< Layout of the scene
+    unsigned int n_boxes = 3; ///< Number of boxes
+    uint64_t seed = 1; ///< Seed of the random number generator
+
+    uint64_t state = 0; ///< State of the random number generator (splitmix64)
+
+public:
+    cgvSceneGenerator() = default;
+    cgvSceneGenerator(sceneLayout _layout, unsigned int _n_boxes, uint64_t _seed = 1);
+    ~cgvSceneGenerator() = default;
+
+    void generate(cgvScene3D &scene);
+
+    int parse_args(int argc, char **argv, int i);
+    static bool parse_layout(const char *name, sceneLayout &_layout);
+
+    static unsigned int max_boxes() { return 0xFFFFFE; } ///< 0 and 0xFFFFFF (white) are not valid identifiers
+
+    // methods get_ and set_ to access the attributes
+    sceneLayout get_layout() const { return layout; };
+    unsigned int get_num_boxes() const { return n_boxes; };
+    uint64_t get_seed() const { return seed; };
+
+private:
+    void generate_tower(cgvScene3D &scene);
+    void generate_grid(cgvScene3D &scene);
+    void generate_clusters(cgvScene3D &scene);
+    void generate_dense_stack(cgvScene3D &scene);
+
+    uint64_t next();
+    float uniform(float min, float max);
+};
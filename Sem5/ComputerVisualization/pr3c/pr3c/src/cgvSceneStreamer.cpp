@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <chrono>
+
+#include "cgvSceneStreamer.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+/**
+ * Destructor. The loader thread is stopped
+ */
+cgvSceneStreamer::~cgvSceneStreamer() {
+	stop();
+}
+
+/**
+ * Start loading a snapshot in the background
+ * @param path Path of the snapshot
+ * @param scene The scene. Its boxes are removed, and the ones of the snapshot are appended by update()
+ * @param camera Camera that takes the one of the snapshot, if it has one (nullptr: the camera is ignored)
+ * @retval true if the header of the snapshot is valid and the loader thread has started. Otherwise, the reason is
+ * written to stderr and neither the scene nor the camera are changed
+ */
+bool cgvSceneStreamer::start(const std::string &path, cgvScene3D &scene, cgvCamera *camera) {
+	stop();
+	if (!snapshot.open(path)) return false;
+
+	n_total = (uint32_t) snapshot.get_num_boxes();
+	n_loaded = 0;
+	camera_loaded = camera && snapshot.read_camera(*camera);
+	scene.clear();
+	scene.reserve(n_total);
+
+	for (chunk &c: chunks) {
+		c.boxes.resize(CHUNK_SIZE);
+		c.positions.resize(CHUNK_SIZE);
+		c.rotations.resize(CHUNK_SIZE);
+	}
+	head = tail = 0;
+	done = failed = cancelled = false;
+	loading = true;
+	loader = std::thread(&cgvSceneStreamer::run, this);
+	return true;
+}
+
+/**
+ * Append to a scene the chunks filled by the loader thread
+ * @param scene The scene given to start()
+ * @retval true if boxes have been appended to the scene
+ * @post When the last chunk has been appended (or the loader has failed), the loader thread is stopped and
+ * is_loading() is false
+ */
+bool cgvSceneStreamer::update(cgvScene3D &scene) {
+	if (!loading) return false;
+
+	// done is read before tail: if it is set, every chunk has been published
+	const bool finished = done.load(std::memory_order_acquire);
+	const uint32_t filled = tail.load(std::memory_order_acquire);
+	uint32_t appended = head.load(std::memory_order_relaxed);
+	const bool changed = (appended != filled);
+	for (; appended != filled; ++appended) {
+		const chunk &c = chunks[appended % QUEUE_SIZE];
+		scene.append_boxes(c.n_boxes, c.boxes.data(), c.positions.data(), c.rotations.data());
+		n_loaded += c.n_boxes;
+		head.store(appended + 1, std::memory_order_release);
+	}
+
+	if (finished) {
+		stop();
+		if (failed) fprintf(stderr, "cgvSceneStreamer: only %u of %u boxes have been loaded\n", n_loaded, n_total);
+	}
+	return changed;
+}
+
+/**
+ * Stop the loader thread
+ * @post The boxes already appended remain in the scene, and the snapshot is closed
+ */
+void cgvSceneStreamer::stop() {
+	cancelled = true;
+	if (loader.joinable()) loader.join();
+	snapshot.close();
+	loading = false;
+}
+
+/**
+ * Body of the loader thread: fill the chunks in order, waiting while the ring is full
+ */
+void cgvSceneStreamer::run() {
+	for (uint32_t first = 0, filled = 0; (first < n_total) && !cancelled; first += CHUNK_SIZE, ++filled) {
+		while ((filled - head.load(std::memory_order_acquire) == QUEUE_SIZE) && !cancelled) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (cancelled) break;
+
+		chunk &c = chunks[filled % QUEUE_SIZE];
+		c.n_boxes = (n_total - first < CHUNK_SIZE) ? n_total - first : CHUNK_SIZE;
+		if (!snapshot.read_boxes(first, c.n_boxes, c.boxes.data(), c.positions.data(), c.rotations.data())) {
+			failed = true;
+			break;
+		}
+		tail.store(filled + 1, std::memory_order_release);
+	}
+	done.store(true, std::memory_order_release);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cgvBox.h"
+#include "cgvPoint.h"
+#include "cgvSnapshot.h"
+
+class cgvScene3D;
+class cgvCamera;
+
+/**
+ * cgvSceneStreamer loads a snapshot progressively, so that the scene can be rendered while it is being loaded. A
+ * loader thread copies the boxes of the snapshot in chunks of CHUNK_SIZE boxes to a ring of QUEUE_SIZE chunks; the
+ * thread that renders the scene appends the filled chunks to it between frames (update). The ring has a single
+ * producer and a single consumer, and it does not use locks: a chunk is only published (the release store of tail)
+ * once it has been completely written, and it is only reused (the release store of head) once it has been appended.
+ */
+class cgvSceneStreamer {
+public:
+	static const uint32_t CHUNK_SIZE = 16384; ///< Boxes of a chunk
+	static const uint32_t QUEUE_SIZE = 8; ///< Chunks of the ring
+
+private:
+	/**
+	 * Boxes copied from the snapshot
+	 */
+	struct chunk {
+		uint32_t n_boxes = 0; ///< Number of boxes of the chunk
+		std::vector<cgvBox> boxes; ///< Boxes (CHUNK_SIZE)
+		std::vector<cgvPoint3D> positions; ///< Position of each box (CHUNK_SIZE)
+		std::vector<std::array<float, 2> > rotations; ///< Rotation of each box (CHUNK_SIZE)
+	};
+
+	cgvSnapshot snapshot; ///< Snapshot being loaded
+	std::thread loader; ///< Thread that fills the chunks
+	std::array<chunk, QUEUE_SIZE> chunks; ///< Ring of chunks
+	std::atomic<uint32_t> head{0}; ///< Number of chunks appended to the scene (written by the consumer)
+	std::atomic<uint32_t> tail{0}; ///< Number of chunks filled (written by the loader thread)
+	std::atomic<bool> done{false}; ///< The loader thread has filled its last chunk
+	std::atomic<bool> failed{false}; ///< The loader thread has found a corrupt box
+	std::atomic<bool> cancelled{false}; ///< The loader thread must stop
+
+	bool loading = false; ///< A snapshot is being loaded
+	bool camera_loaded = false; ///< The snapshot has a camera, and it has been set
+	uint32_t n_total = 0; ///< Boxes of the snapshot
+	uint32_t n_loaded = 0; ///< Boxes appended to the scene
+
+public:
+	cgvSceneStreamer() = default;
+	~cgvSceneStreamer();
+
+	cgvSceneStreamer(const cgvSceneStreamer&) = delete;
+	cgvSceneStreamer& operator=(const cgvSceneStreamer&) = delete;
+
+	bool start(const std::string &path, cgvScene3D &scene, cgvCamera *camera);
+	bool update(cgvScene3D &scene);
+	void stop();
+
+	bool is_loading() const { return loading; };
+	bool has_failed() const { return failed; };
+	/**
+	 * @retval true if the snapshot of the last start has a camera, and it has been set
+	 */
+	bool has_loaded_camera() const { return camera_loaded; };
+	uint32_t get_num_loaded() const { return n_loaded; };
+	uint32_t get_num_total() const { return n_total; };
+
+private:
+	void run();
+};
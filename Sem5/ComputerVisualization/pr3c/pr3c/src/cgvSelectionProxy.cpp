@@ -0,0 +1,126 @@
+#include <cmath>
+
+#include "cgvSelectionProxy.h"
+#include "cgvScene3D.h"
+
+/**
+ * Default constructor. The triangles of a whole chunk are computed here, as they do not depend on the scene
+ */
+cgvSelectionProxy::cgvSelectionProxy() {
+	GLushort indices[cgvBox::PROXY_INDICES];
+	cgvBox::build_proxy(proxy, indices);
+
+	chunk_indices.resize(CHUNK_SIZE * cgvBox::PROXY_INDICES);
+	for (uint32_t b = 0; b < CHUNK_SIZE; ++b) {
+		for (int k = 0; k < cgvBox::PROXY_INDICES; ++k) {
+			chunk_indices[b * cgvBox::PROXY_INDICES + k] = (GLushort) (b * cgvBox::PROXY_VERTICES + indices[k]);
+		}
+	}
+}
+
+/**
+ * Update the proxies to the current state of a scene
+ * @param scene The scene
+ * @post Every box has its proxy in world coordinates with its current rotation. When boxes have been added or removed,
+ * every proxy is computed again; otherwise only the ones of the boxes that have been rotated or moved, if any box has
+ * changed
+ */
+void cgvSelectionProxy::update(const cgvScene3D &scene) {
+	n_updated = 0;
+	const bool rebuild = (scene.get_revision() != scene_revision);
+	if (!rebuild && (scene.get_num_box_changes() == box_changes)) return;
+
+	const vector<cgvBox> &boxes = scene.get_boxes();
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	const uint32_t n_boxes = (uint32_t) boxes.size();
+
+	if (rebuild) {
+		vertices.resize(n_boxes * cgvBox::PROXY_VERTICES);
+		angles.resize(n_boxes);
+		centers.resize(n_boxes);
+		for (uint32_t i = 0; i < n_boxes; ++i) {
+			GLubyte c[3];
+			cgvBox::id_to_color(boxes[i].get_id(), c);
+			for (int v = 0; v < cgvBox::PROXY_VERTICES; ++v) {
+				vertex &p = vertices[i * cgvBox::PROXY_VERTICES + v];
+				p.color[0] = c[0];
+				p.color[1] = c[1];
+				p.color[2] = c[2];
+				p.color[3] = 255;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < n_boxes; ++i) {
+		const cgvPoint3D &p = positions[i];
+		if (!rebuild && (angles[i] == rotations[i][0]) && (centers[i][X] == p[X]) && (centers[i][Y] == p[Y]) &&
+		    (centers[i][Z] == p[Z])) {
+			continue;
+		}
+		angles[i] = rotations[i][0];
+		centers[i] = p;
+		++n_updated;
+
+		// the same transformation of cgvScene3D::push_box_transform: rotation around Y, then translation
+		const float angle = rotations[i][0] * 3.14159265358979f / 180;
+		const float c = std::cos(angle), s = std::sin(angle);
+		for (int v = 0; v < cgvBox::PROXY_VERTICES; ++v) {
+			GLfloat *p = vertices[i * cgvBox::PROXY_VERTICES + v].position;
+			p[0] = positions[i][X] + c * proxy[v][0] + s * proxy[v][2];
+			p[1] = positions[i][Y] + proxy[v][1];
+			p[2] = positions[i][Z] - s * proxy[v][0] + c * proxy[v][2];
+		}
+	}
+
+	scene_revision = scene.get_revision();
+	box_changes = scene.get_num_box_changes();
+}
+
+/**
+ * Draw the proxies of every box
+ * @pre update() has been called for the current state of the scene
+ * @post The OpenGL state (and so the one shadowed by cgvGLState) is not changed
+ */
+void cgvSelectionProxy::draw() {
+	const uint32_t n_boxes = (uint32_t) angles.size();
+	begin_draw();
+	for (uint32_t first = 0; first < n_boxes; first += CHUNK_SIZE) {
+		const uint32_t n = (first + CHUNK_SIZE < n_boxes) ? CHUNK_SIZE : n_boxes - first;
+		draw_chunk(first / CHUNK_SIZE, chunk_indices.data(), (GLsizei) (n * cgvBox::PROXY_INDICES));
+	}
+	end_draw();
+}
+
+/**
+ * Store the state changed by draw_chunk and enable the vertex and color arrays
+ */
+void cgvSelectionProxy::begin_draw() {
+	glPushAttrib(GL_CURRENT_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+}
+
+/**
+ * Draw some proxies of a chunk
+ * @param chunk Index of the chunk
+ * @param indices Triangles of the proxies, relative to the first vertex of the chunk
+ * @param count Number of indices
+ */
+void cgvSelectionProxy::draw_chunk(uint32_t chunk, const GLushort *indices, GLsizei count) {
+	if (count == 0) return;
+	const vertex *first = &vertices[chunk * CHUNK_SIZE * cgvBox::PROXY_VERTICES];
+	glVertexPointer(3, GL_FLOAT, sizeof(vertex), first->position);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(vertex), first->color);
+	glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, indices);
+}
+
+/**
+ * Restore the state changed by begin_draw and draw_chunk
+ */
+void cgvSelectionProxy::end_draw() {
+	glPopClientAttrib();
+	glPopAttrib();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "cgvBox.h"
+#include "cgvPoint.h"
+
+class cgvScene3D;
+
+/**
+ * cgvSelectionProxy renders the boxes of a scene in selection mode (color as identifier) with their proxies: a single
+ * closed surface per box, with the outline of both pieces (see cgvBox::build_proxy). The proxies are stored in world
+ * coordinates with the color of the box, and they are only computed again when the box is added, rotated or moved,
+ * so every CHUNK_SIZE boxes are drawn with a single call, without changes of the modelview matrix or of the color.
+ * As the proxy covers the same pixels as the box, the color read at any pixel is the same one as with the boxes.
+ */
+class cgvSelectionProxy {
+public:
+	static const uint32_t CHUNK_SIZE = 65536 / cgvBox::PROXY_VERTICES; ///< Boxes drawn by each call (16-bit indices)
+
+private:
+	/**
+	 * Vertex of a proxy
+	 */
+	struct vertex {
+		GLfloat position[3]; ///< World coordinates
+		GLubyte color[4]; ///< color_as_ID of the box
+	};
+
+	std::vector<vertex> vertices; ///< Proxies of every box, PROXY_VERTICES each
+	std::vector<GLfloat> angles; ///< Rotation of each box when its proxy was computed
+	std::vector<cgvPoint3D> centers; ///< Position of each box when its proxy was computed
+	std::vector<GLushort> chunk_indices; ///< Triangles of the proxies of a whole chunk
+	std::vector<GLushort> visible_indices; ///< Triangles of the proxies of the boxes of a chunk that are not culled
+	GLfloat proxy[cgvBox::PROXY_VERTICES][3]; ///< Proxy in the coordinates of the box
+
+	unsigned long scene_revision = 0; ///< Revision of the scene of the proxies
+	unsigned long box_changes = 0; ///< Number of changes of the boxes of the scene when the proxies were updated
+	unsigned long n_updated = 0; ///< Proxies computed by the last update
+
+public:
+	cgvSelectionProxy();
+	~cgvSelectionProxy() = default;
+
+	void update(const cgvScene3D &scene);
+	void draw();
+	template <class culledFunction>
+	void draw_visible(culledFunction is_culled);
+
+	unsigned long get_num_updated() const { return n_updated; };
+	/**
+	 * @retval Memory of the proxy of a box, with the state it was computed with
+	 */
+	static uint32_t get_bytes_per_box() {
+		return (uint32_t) (cgvBox::PROXY_VERTICES * sizeof(vertex) + sizeof(GLfloat) + sizeof(cgvPoint3D));
+	};
+
+private:
+	void begin_draw();
+	void draw_chunk(uint32_t chunk, const GLushort *indices, GLsizei count);
+	void end_draw();
+};
+
+
+/**
+ * Draw the proxies of the boxes that are not culled
+ * @tparam culledFunction Type of is_culled, bool(uint32_t)
+ * @param is_culled Function that returns true for the index of a box that must not be drawn
+ * @pre update() has been called for the current state of the scene
+ * @post The OpenGL state (and so the one shadowed by cgvGLState) is not changed
+ */
+template <class culledFunction>
+void cgvSelectionProxy::draw_visible(culledFunction is_culled) {
+	const uint32_t n_boxes = (uint32_t) angles.size();
+	begin_draw();
+	for (uint32_t first = 0; first < n_boxes; first += CHUNK_SIZE) {
+		const uint32_t last = (first + CHUNK_SIZE < n_boxes) ? first + CHUNK_SIZE : n_boxes;
+		visible_indices.clear();
+		for (uint32_t i = first; i < last; ++i) {
+			if (is_culled(i)) continue;
+			const GLushort *box = &chunk_indices[(i - first) * cgvBox::PROXY_INDICES];
+			visible_indices.insert(visible_indices.end(), box, box + cgvBox::PROXY_INDICES);
+		}
+		draw_chunk(first / CHUNK_SIZE, visible_indices.data(), (GLsizei) visible_indices.size());
+	}
+	end_draw();
+}
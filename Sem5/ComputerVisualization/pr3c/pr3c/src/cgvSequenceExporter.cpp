@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef CGV_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "cgvSequenceExporter.h"
+
+/**
+ * Destructor. The frames not written yet are written
+ * @pre The context where start() was called must be current
+ */
+cgvSequenceExporter::~cgvSequenceExporter() {
+	finish();
+}
+
+/**
+ * Start a sequence of images
+ * @param _pattern Names of the files: a printf pattern with a conversion of the number of the frame (e.g.
+ * "frames/turntable_%04u.png"), whose extension (.png or .ppm) is the format of the images. Empty: no files are
+ * written, only the hashes of the images are computed
+ * @param _width Width of the frames
+ * @param _height Height of the frames
+ * @param _n_threads Number of threads that encode the images (0: one less than the hardware supports, at least one)
+ * @retval true if the sequence has started, false if the pattern is not valid (the reason is written to stderr)
+ * @pre An OpenGL context is current
+ */
+bool cgvSequenceExporter::start(const std::string &_pattern, uint32_t _width, uint32_t _height, unsigned int _n_threads) {
+	finish();
+	if (_pattern.empty()) {
+		format = CGV_IMAGE_HASH;
+	} else if (!parse_pattern(_pattern, format)) {
+		return false;
+	}
+	if ((_width == 0) || (_height == 0)) return false;
+	pattern = _pattern;
+	width = _width;
+	height = _height;
+	readback.create(width, height);
+
+	frames.clear();
+	free_frames.clear();
+	for (uint32_t f = 0; f < QUEUE_SIZE; ++f) {
+		frames.emplace_back(new frame());
+		frames.back()->pixels.resize((size_t) width * height * 4);
+		free_frames.push_back(frames.back().get());
+	}
+	closing = false;
+	hashes.clear();
+	n_captured = n_stalls = 0;
+	n_written = n_failed = 0;
+	n_bytes = 0;
+
+	n_threads = _n_threads;
+	if (n_threads == 0) {
+		n_threads = (std::thread::hardware_concurrency() > 1) ? std::thread::hardware_concurrency() - 1 : 1;
+	}
+	for (unsigned int t = 0; t < n_threads; ++t) workers.emplace_back(&cgvSequenceExporter::run, this);
+	return true;
+}
+
+/**
+ * Read back the frame that has just been rendered, and hand over to the workers the frames read back before that
+ * are ready
+ * @param number Number of the frame in the sequence (the name of its file)
+ * @pre The frame is in the current read buffer
+ * @post The thread only waits when all the pixel buffers are in flight, or when all the frames in the CPU are waiting
+ * to be encoded
+ */
+void cgvSequenceExporter::capture(uint32_t number) {
+	if (!is_exporting()) return;
+	++n_captured;
+	if (format == CGV_IMAGE_HASH) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (number >= hashes.size()) hashes.resize((size_t) number + 1, 0);
+	}
+	if (!readback.is_valid()) {
+		frame *f = take_free_frame();
+		f->number = number;
+		glReadPixels(0, 0, (GLsizei) width, (GLsizei) height, GL_RGBA, GL_UNSIGNED_BYTE, f->pixels.data());
+		push_ready_frame(f);
+		return;
+	}
+
+	while (hand_over_oldest(false)) {
+	}
+	if (readback.is_full()) hand_over_oldest(true);
+	readback.read(width, height, number);
+}
+
+/**
+ * Write all the frames captured and stop the workers
+ * @retval true if all the files have been written. Otherwise, the files that failed have been written to stderr
+ * @pre The context where start() was called is current
+ */
+bool cgvSequenceExporter::finish() {
+	if (!is_exporting()) return n_failed == 0;
+	while (hand_over_oldest(true)) {
+	}
+	readback.destroy();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+	frame_ready.notify_all();
+	for (std::thread &worker : workers) worker.join();
+	workers.clear();
+	return n_failed == 0;
+}
+
+/**
+ * Find the format of the images of a pattern of names of files
+ * @param _pattern Names of the files: a printf pattern with one conversion %u or %d (with flags and width, e.g. %05u)
+ * and the extension .png or .ppm
+ * @param _format Format of the images
+ * @retval true if the pattern is valid. Otherwise, the reason is written to stderr
+ */
+bool cgvSequenceExporter::parse_pattern(const std::string &_pattern, imageFormat &_format) {
+	int n_conversions = 0;
+	bool valid = true;
+	for (size_t c = 0; valid && (c < _pattern.size()); ++c) {
+		if (_pattern[c] != '%') continue;
+		size_t end = _pattern.find_first_not_of("0123456789", c + 1);
+		if ((end == c + 1) && (end < _pattern.size()) && (_pattern[end] == '%')) {
+			c = end; // %%
+		} else if ((end != std::string::npos) && ((_pattern[end] == 'u') || (_pattern[end] == 'd'))) {
+			++n_conversions;
+			c = end;
+		} else {
+			valid = false;
+		}
+	}
+	if (!valid || (n_conversions != 1)) {
+		fprintf(stderr, "cgvSequenceExporter: the pattern %s must have one conversion of the number of the frame, "
+		                "as %%05u\n", _pattern.c_str());
+		return false;
+	}
+
+	const std::string extension = (_pattern.size() > 4) ? _pattern.substr(_pattern.size() - 4) : "";
+	if (extension == ".ppm") {
+		_format = CGV_IMAGE_PPM;
+		return true;
+	}
+	if (extension == ".png") {
+#ifdef CGV_HAVE_ZLIB
+		_format = CGV_IMAGE_PNG;
+		return true;
+#else
+		fprintf(stderr, "cgvSequenceExporter: the PNG images require zlib, %s can not be written\n", _pattern.c_str());
+		return false;
+#endif
+	}
+	fprintf(stderr, "cgvSequenceExporter: unknown format of %s (.png or .ppm)\n", _pattern.c_str());
+	return false;
+}
+
+/**
+ * Encode a frame as an image file
+ * @param _format Format of the image
+ * @param _width Width of the frame
+ * @param _height Height of the frame
+ * @param pixels RGBA pixels of the frame, rows from bottom to top
+ * @param rows Memory for the rows of the image, reused between calls
+ * @param file Content of the file
+ * @post The images have RGB pixels, rows from top to bottom. The rows of a PNG image use the filter Sub, which suits
+ * the large areas of the same color of the renders
+ */
+void cgvSequenceExporter::encode(imageFormat _format, uint32_t _width, uint32_t _height, const uint8_t *pixels,
+                                 std::vector<uint8_t> &rows, std::vector<uint8_t> &file) {
+	const size_t row_size = (size_t) _width * 3;
+	if (_format == CGV_IMAGE_PPM) {
+		char header[64];
+		const int header_size = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", _width, _height);
+		file.resize(header_size + row_size * _height);
+		memcpy(file.data(), header, header_size);
+		for (uint32_t y = 0; y < _height; ++y) {
+			const uint8_t *source = pixels + (size_t) (_height - 1 - y) * _width * 4;
+			uint8_t *target = file.data() + header_size + y * row_size;
+			for (uint32_t x = 0; x < _width; ++x) {
+				target[3 * x] = source[4 * x];
+				target[3 * x + 1] = source[4 * x + 1];
+				target[3 * x + 2] = source[4 * x + 2];
+			}
+		}
+		return;
+	}
+
+#ifdef CGV_HAVE_ZLIB
+	// each row starts with its filter (1: Sub, the difference with the pixel on its left)
+	rows.resize((row_size + 1) * _height);
+	for (uint32_t y = 0; y < _height; ++y) {
+		const uint8_t *source = pixels + (size_t) (_height - 1 - y) * _width * 4;
+		uint8_t *target = rows.data() + y * (row_size + 1);
+		target[0] = 1;
+		++target;
+		for (uint32_t x = 0; x < _width; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				target[3 * x + c] = (uint8_t) (source[4 * x + c] - ((x > 0) ? source[4 * (x - 1) + c] : 0));
+			}
+		}
+	}
+
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	uLongf compressed = compressBound((uLong) rows.size());
+	file.resize(sizeof(signature) + 25 + 12 + compressed + 12);
+	uint8_t *data = file.data() + sizeof(signature) + 25 + 8;
+	if (compress2(data, &compressed, rows.data(), (uLong) rows.size(), Z_BEST_SPEED) != Z_OK) {
+		file.clear();
+		return;
+	}
+	file.resize(sizeof(signature) + 25 + 12 + compressed + 12);
+
+	// chunks: length (big-endian), type, data and CRC of the type and the data
+	auto put32 = [](uint8_t *p, uint32_t value) {
+		p[0] = (uint8_t) (value >> 24);
+		p[1] = (uint8_t) (value >> 16);
+		p[2] = (uint8_t) (value >> 8);
+		p[3] = (uint8_t) value;
+	};
+	auto chunk = [&](uint8_t *p, const char *type, uint32_t length) {
+		put32(p, length);
+		memcpy(p + 4, type, 4);
+		put32(p + 8 + length, (uint32_t) crc32(0, p + 4, length + 4));
+	};
+	uint8_t *p = file.data();
+	memcpy(p, signature, sizeof(signature));
+	p += sizeof(signature);
+	put32(p + 8, _width);
+	put32(p + 12, _height);
+	p[16] = 8; // bits per channel
+	p[17] = 2; // RGB
+	p[18] = p[19] = p[20] = 0; // compression, filter and interlace methods
+	chunk(p, "IHDR", 13);
+	p += 25;
+	chunk(p, "IDAT", (uint32_t) compressed);
+	p += 12 + compressed;
+	chunk(p, "IEND", 0);
+#endif
+}
+
+/**
+ * FNV-1a hash of an image: the RGB pixels, rows from top to bottom, as they are written to the files
+ * @param _width Width of the frame
+ * @param _height Height of the frame
+ * @param pixels RGBA pixels of the frame, rows from bottom to top
+ * @retval The hash
+ */
+uint64_t cgvSequenceExporter::hash(uint32_t _width, uint32_t _height, const uint8_t *pixels) {
+	uint64_t h = 14695981039346656037ull;
+	for (uint32_t y = 0; y < _height; ++y) {
+		const uint8_t *row = pixels + (size_t) (_height - 1 - y) * _width * 4;
+		for (uint32_t x = 0; x < 4 * _width; x += 4) {
+			h = (h ^ row[x]) * 1099511628211ull;
+			h = (h ^ row[x + 1]) * 1099511628211ull;
+			h = (h ^ row[x + 2]) * 1099511628211ull;
+		}
+	}
+	return h;
+}
+
+/**
+ * Take a frame that can be filled, waiting for a worker to write one if there are none
+ * @retval The frame
+ */
+cgvSequenceExporter::frame *cgvSequenceExporter::take_free_frame() {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (free_frames.empty()) {
+		++n_stalls;
+		frame_freed.wait(lock, [this] { return !free_frames.empty(); });
+	}
+	frame *f = free_frames.back();
+	free_frames.pop_back();
+	return f;
+}
+
+/**
+ * Hand over a frame to the workers
+ * @param f The frame, filled
+ */
+void cgvSequenceExporter::push_ready_frame(frame *f) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready_frames.push_back(f);
+	}
+	frame_ready.notify_one();
+}
+
+/**
+ * Copy the oldest frame in flight of the pixel buffers to a frame in the CPU, and hand it over to the workers
+ * @param wait true to wait for the frame to be read back
+ * @retval true if a frame has been handed over
+ */
+bool cgvSequenceExporter::hand_over_oldest(bool wait) {
+	uint32_t frame_width, frame_height;
+	uint64_t number;
+	if (readback.is_empty()) return false;
+	const uint8_t *pixels = readback.map_oldest(wait, frame_width, frame_height, number);
+	if (!pixels) return false;
+
+	frame *f = take_free_frame();
+	f->number = (uint32_t) number;
+	memcpy(f->pixels.data(), pixels, readback.get_stride() * frame_height);
+	readback.unmap_oldest();
+	push_ready_frame(f);
+	return true;
+}
+
+/**
+ * Body of the workers: encode and write the frames handed over, until the exporter finishes
+ */
+void cgvSequenceExporter::run() {
+	for (;;) {
+		frame *f;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frame_ready.wait(lock, [this] { return !ready_frames.empty() || closing; });
+			if (ready_frames.empty()) return;
+			f = ready_frames.front();
+			ready_frames.pop_front();
+		}
+
+		if (format == CGV_IMAGE_HASH) {
+			const uint64_t h = hash(width, height, f->pixels.data());
+			++n_written;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				hashes[f->number] = h;
+				free_frames.push_back(f);
+			}
+			frame_freed.notify_one();
+			continue;
+		}
+
+		encode(format, width, height, f->pixels.data(), f->rows, f->file);
+		char name[4096];
+		snprintf(name, sizeof(name), pattern.c_str(), f->number);
+		FILE *output = f->file.empty() ? nullptr : fopen(name, "wb");
+		bool written = output && (fwrite(f->file.data(), 1, f->file.size(), output) == f->file.size());
+		if (output && (fclose(output) != 0)) written = false;
+		if (written) {
+			++n_written;
+			n_bytes += f->file.size();
+		} else {
+			fprintf(stderr, "cgvSequenceExporter: unable to write %s\n", name);
+			++n_failed;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free_frames.push_back(f);
+		}
+		frame_freed.notify_one();
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cgvPixelReadback.h"
+
+/**
+ * Formats of the exported images
+ */
+typedef enum {
+	CGV_IMAGE_PPM, ///< Binary portable pixmap (P6), without compression
+	CGV_IMAGE_PNG, ///< PNG, compressed with zlib (CGV_HAVE_ZLIB)
+	CGV_IMAGE_HASH ///< No file: only the hash of the image (cgvSequenceExporter::hash)
+} imageFormat;
+
+/**
+ * cgvSequenceExporter writes the rendered frames to a sequence of image files in a pipeline, so that the frames are
+ * rendered while the previous ones are read back and encoded:
+ * - the render thread reads each frame back without waiting for it (cgvPixelReadback), and copies the frames that
+ *   have been read to one of QUEUE_SIZE frames in the CPU;
+ * - the worker threads convert the frames to RGB from top to bottom, encode them and write them to their files (or
+ *   only compute their hash, without a pattern).
+ * The frames in the CPU are a bounded queue: when all of them are waiting to be encoded, the render thread waits for a
+ * worker to finish one (a stall), so the memory does not grow when the encoding is slower than the rendering.
+ */
+class cgvSequenceExporter {
+public:
+	static const uint32_t QUEUE_SIZE = 8; ///< Frames that can be waiting to be encoded
+
+private:
+	/**
+	 * Frame read back, and its image
+	 */
+	struct frame {
+		uint32_t number = 0; ///< Number of the frame in the sequence
+		std::vector<uint8_t> pixels; ///< RGBA pixels, rows from bottom to top
+		std::vector<uint8_t> rows; ///< Rows of the image being encoded
+		std::vector<uint8_t> file; ///< Content of the file
+	};
+
+	std::string pattern; ///< printf pattern of the names of the files, with the number of the frame
+	imageFormat format = CGV_IMAGE_PPM; ///< Format of the images
+	uint32_t width = 0, height = 0; ///< Size of the frames
+	cgvPixelReadback readback; ///< Pixel buffers where the frames are read back (not valid: they are read at once)
+
+	std::vector<std::unique_ptr<frame> > frames; ///< Frames in the CPU (QUEUE_SIZE)
+	std::mutex mutex; ///< Guards free_frames, ready_frames, closing and hashes
+	std::condition_variable frame_freed; ///< A frame has been written
+	std::condition_variable frame_ready; ///< A frame is waiting to be encoded, or the workers must finish
+	std::vector<frame *> free_frames; ///< Frames that can be filled
+	std::deque<frame *> ready_frames; ///< Frames waiting to be encoded, in order
+	bool closing = false; ///< The workers must finish once ready_frames is empty
+	std::vector<uint64_t> hashes; ///< Hash of the image of each number of frame (CGV_IMAGE_HASH)
+	std::vector<std::thread> workers; ///< Threads that encode the frames
+	unsigned int n_threads = 0; ///< Number of workers of the last sequence
+
+	unsigned long n_captured = 0; ///< Frames captured
+	unsigned long n_stalls = 0; ///< Times that the render thread waited for a free frame
+	std::atomic<unsigned long> n_written{0}; ///< Files written
+	std::atomic<unsigned long> n_failed{0}; ///< Files that could not be written
+	std::atomic<uint64_t> n_bytes{0}; ///< Bytes written
+
+public:
+	cgvSequenceExporter() = default;
+	~cgvSequenceExporter();
+
+	cgvSequenceExporter(const cgvSequenceExporter&) = delete;
+	cgvSequenceExporter& operator=(const cgvSequenceExporter&) = delete;
+
+	bool start(const std::string &_pattern, uint32_t _width, uint32_t _height, unsigned int _n_threads = 0);
+	void capture(uint32_t number);
+	bool finish();
+
+	static bool parse_pattern(const std::string &_pattern, imageFormat &_format);
+	static void encode(imageFormat _format, uint32_t _width, uint32_t _height, const uint8_t *pixels,
+	                   std::vector<uint8_t> &rows, std::vector<uint8_t> &file);
+	static uint64_t hash(uint32_t _width, uint32_t _height, const uint8_t *pixels);
+
+	bool is_exporting() const { return !workers.empty(); };
+	unsigned int get_num_threads() const { return n_threads; };
+	unsigned long get_num_captured() const { return n_captured; };
+	unsigned long get_num_stalls() const { return n_stalls; };
+	unsigned long get_num_written() const { return n_written; };
+	unsigned long get_num_failed() const { return n_failed; };
+	uint64_t get_num_bytes() const { return n_bytes; };
+	const std::vector<uint64_t> &get_hashes() const { return hashes; };
+
+private:
+	frame *take_free_frame();
+	void push_ready_frame(frame *f);
+	bool hand_over_oldest(bool wait);
+	void run();
+};
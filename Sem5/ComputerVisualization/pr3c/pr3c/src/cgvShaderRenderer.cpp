@@ -0,0 +1,502 @@
+#include <stddef.h>
+#include <stdio.h>
+
+#include "cgvShaderRenderer.h"
+
+#ifdef CGV_HAVE_CORE_PROFILE
+
+// Boxes. The lighting is computed per vertex as the fixed-function pipeline does: emission + global ambient (0.2) *
+// ambient of the material (0.2) + diffuse of the material (0.8) * diffuse of the light (1) * cos(angle)
+static const char *box_vertex_shader = R"(#version 330 core
+layout(location = 0) in vec3 vertex;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in float part;
+layout(location = 3) in vec4 instance; // position of the box (xyz) and rotation around Y in degrees (w)
+layout(location = 4) in vec4 instance_id; // color as identifier (rgb) and selected (a)
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 light_eye; // position of the light in eye coordinates
+uniform bool select_mode;
+uniform vec3 emission[3]; // body, top piece, selected box
+
+out vec3 color;
+
+void main() {
+	float a = radians(instance.w);
+	mat3 rotation = mat3(cos(a), 0, -sin(a), 0, 1, 0, sin(a), 0, cos(a));
+	vec4 eye = view * vec4(instance.xyz + rotation * vertex, 1);
+	gl_Position = projection * eye;
+
+	if (select_mode) {
+		color = instance_id.rgb;
+		return;
+	}
+	vec3 e = (instance_id.a > 0.5) ? emission[2] : emission[int(part)];
+	vec3 n = normalize(mat3(view) * (rotation * normal));
+	vec3 l = normalize(light_eye - eye.xyz);
+	color = clamp(e + vec3(0.04) + 0.8 * max(dot(n, l), 0.0), 0.0, 1.0);
+}
+)";
+
+static const char *color_fragment_shader = R"(#version 330 core
+in vec3 color;
+out vec4 frag_color;
+
+void main() {
+	frag_color = vec4(color, 1);
+}
+)";
+
+// Axes: emission of each axis + global ambient
+static const char *axes_vertex_shader = R"(#version 330 core
+layout(location = 0) in vec3 vertex;
+layout(location = 1) in vec3 emission;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 color;
+
+void main() {
+	gl_Position = projection * view * vec4(vertex, 1);
+	color = clamp(emission + vec3(0.04), 0.0, 1.0);
+}
+)";
+
+// Culling: one invocation per box. The instances are read as words, 5 per cgvBoxInstance: they are copied bit by bit,
+// as the packed color_as_ID and selected word is not a valid float (denormal, NaN or infinite)
+static const char *cull_compute_shader = R"(#version 430 core
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) readonly buffer Instances { uint instances[]; };
+layout(std430, binding = 1) writeonly buffer Visible { uint visible[]; };
+layout(std430, binding = 2) buffer Command {
+	uint count;
+	uint instance_count;
+	uint first_index;
+	int base_vertex;
+	uint base_instance;
+};
+
+uniform vec4 planes[6]; // planes of the view volume, the inside is positive
+uniform uint n_instances;
+uniform float radius; // radius of the bounding sphere of a box
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= n_instances) return;
+
+	vec3 center = uintBitsToFloat(uvec3(instances[5u * i], instances[5u * i + 1u], instances[5u * i + 2u]));
+	for (int p = 0; p < 6; ++p) {
+		if (dot(planes[p].xyz, center) + planes[p].w < -radius) return;
+	}
+
+	uint j = atomicAdd(instance_count, 1u);
+	for (uint k = 0u; k < 5u; ++k) visible[5u * j + k] = instances[5u * i + k];
+}
+)";
+
+// Layout of the indirect draw command (glMultiDrawElementsIndirect)
+struct drawElementsCommand {
+	GLuint count, instance_count, first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+#endif
+
+/**
+ * Destructor. The OpenGL objects are released
+ * @pre The context where init() was called must be current
+ */
+cgvShaderRenderer::~cgvShaderRenderer() {
+	destroy();
+}
+
+/**
+ * Build the programs and create the buffers of the renderer
+ * @param cache Cache of program binaries. nullptr: the shaders are always compiled
+ * @retval true if the renderer can be used, false otherwise (the reason is written to stderr)
+ * @pre An OpenGL 3.3 (or later) context is current
+ */
+bool cgvShaderRenderer::init(cgvProgramCache *cache) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	destroy();
+
+	const cgvProgramSource sources[2] = {
+		{ "the program of the boxes", box_vertex_shader, color_fragment_shader },
+		{ "the program of the axes", axes_vertex_shader, color_fragment_shader }
+	};
+	GLuint programs[2];
+	cgvProgramCache no_cache("");
+	if (!(cache ? cache : &no_cache)->build(sources, 2, programs)) return false;
+	box_program = programs[0];
+	axes_program = programs[1];
+
+	box_view = glGetUniformLocation(box_program, "view");
+	box_projection = glGetUniformLocation(box_program, "projection");
+	box_light = glGetUniformLocation(box_program, "light_eye");
+	box_select = glGetUniformLocation(box_program, "select_mode");
+	box_emission = glGetUniformLocation(box_program, "emission");
+	axes_view = glGetUniformLocation(axes_program, "view");
+	axes_projection = glGetUniformLocation(axes_program, "projection");
+
+	// the materials do not change
+	GLfloat emission[CGV_NUM_BOX_PARTS + 1][3];
+	for (int part = 0; part <= CGV_NUM_BOX_PARTS; ++part) {
+		for (int c = 0; c < 3; ++c) emission[part][c] = cgvBox::get_emission(part)[c];
+	}
+	glUseProgram(box_program);
+	glUniform3fv(box_emission, CGV_NUM_BOX_PARTS + 1, emission[0]);
+	glUseProgram(0);
+
+	// geometry of one box
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	cgvBox::build_mesh(vertices, indices);
+	n_indices = (GLsizei) indices.size();
+
+	glGenVertexArrays(1, &box_vao);
+	glBindVertexArray(box_vao);
+
+	glGenBuffers(1, &box_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, box_vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (const GLvoid *) 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (const GLvoid *) (3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (const GLvoid *) (6 * sizeof(GLfloat)));
+
+	glGenBuffers(1, &box_ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, box_ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	// one instance per box, read from the segment of the ring of each frame (see update_instances)
+	glEnableVertexAttribArray(3);
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribDivisor(4, 1);
+
+	// axes: the same lines of cgvScene3D::draw_axes
+	const GLfloat axes[6][6] = {
+		{ 1000, 0, 0, 1, 0, 0 }, { -1000, 0, 0, 1, 0, 0 },
+		{ 0, 1000, 0, 0, 1, 0 }, { 0, -1000, 0, 0, 1, 0 },
+		{ 0, 0, 1000, 0, 0, 1 }, { 0, 0, -1000, 0, 0, 1 }
+	};
+	glGenVertexArrays(1, &axes_vao);
+	glBindVertexArray(axes_vao);
+	glGenBuffers(1, &axes_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, axes_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(axes), axes, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (const GLvoid *) 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (const GLvoid *) (3 * sizeof(GLfloat)));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// optional: without culling in the GPU every box is drawn
+	if (!init_culling(cache ? *cache : no_cache)) {
+		fprintf(stderr, "cgvShaderRenderer: the boxes cannot be culled in the GPU (OpenGL %s)\n",
+		        (const char *) glGetString(GL_VERSION));
+	}
+
+	if (glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "cgvShaderRenderer: unable to create the buffers (OpenGL %s)\n",
+		        (const char *) glGetString(GL_VERSION));
+		destroy();
+		return false;
+	}
+	return true;
+#else
+	fprintf(stderr, "cgvShaderRenderer: this build does not support the core profile renderer\n");
+	return false;
+#endif
+}
+
+/**
+ * Release the OpenGL objects of the renderer
+ * @post is_valid() == false
+ */
+void cgvShaderRenderer::destroy() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	GLuint buffers[3] = { box_vbo, box_ebo, axes_vbo };
+	GLuint arrays[2] = { box_vao, axes_vao };
+	if (box_vbo || box_ebo || axes_vbo) glDeleteBuffers(3, buffers);
+	if (box_vao || axes_vao) glDeleteVertexArrays(2, arrays);
+	if (box_program) glDeleteProgram(box_program);
+	if (axes_program) glDeleteProgram(axes_program);
+	if (cull_program) glDeleteProgram(cull_program);
+	if (culled_vao) glDeleteVertexArrays(1, &culled_vao);
+	GLuint cull_buffers[2] = { visible_buffer, command_buffer };
+	if (visible_buffer || command_buffer) glDeleteBuffers(2, cull_buffers);
+#endif
+	box_program = axes_program = cull_program = 0;
+	culled_vao = visible_buffer = command_buffer = 0;
+	visible_capacity = 0;
+	gpu_culling = false;
+	box_vao = box_vbo = box_ebo = axes_vao = axes_vbo = 0;
+	n_indices = 0;
+	ring.destroy();
+	uploaded_revision = 0;
+	n_instances = 0;
+}
+
+/**
+ * Render the scene with the view and projection of a camera
+ * @param scene Scene to be rendered
+ * @param camera Camera whose view and projection are applied
+ * @param mode CGV_DISPLAY (lighting, axes and selected boxes in yellow) or CGV_SELECT (color as identifier, no axes)
+ * @pre is_valid() and the context where init() was called is current. The viewport, the depth test and the clearing
+ * of the buffers are left to the caller
+ * @post The list of dirty boxes of the scene is taken
+ */
+void cgvShaderRenderer::render(cgvScene3D &scene, const cgvCamera &camera, RenderMode mode) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	float view[16], projection[16];
+	camera.get_view_matrix(view);
+	camera.get_projection_matrix(projection);
+
+	if ((mode == CGV_DISPLAY) && scene.get_axes()) {
+		glUseProgram(axes_program);
+		glUniformMatrix4fv(axes_view, 1, GL_FALSE, view);
+		glUniformMatrix4fv(axes_projection, 1, GL_FALSE, projection);
+		glBindVertexArray(axes_vao);
+		glDrawArrays(GL_LINES, 0, 6);
+	}
+
+	if (scene.get_num_boxes() > 0) {
+		// the light remains still in world coordinates, as in cgvScene3D::render
+		const GLfloat *l = cgvScene3D::light_position;
+		GLfloat light_eye[3];
+		for (int r = 0; r < 3; ++r) {
+			light_eye[r] = view[r] * l[0] + view[4 + r] * l[1] + view[8 + r] * l[2] + view[12 + r] * l[3];
+		}
+
+		glBindVertexArray(box_vao);
+		if (update_instances(scene)) {
+			if (gpu_culling) cull_instances(camera);
+
+			glUseProgram(box_program);
+			glUniformMatrix4fv(box_view, 1, GL_FALSE, view);
+			glUniformMatrix4fv(box_projection, 1, GL_FALSE, projection);
+			glUniform3fv(box_light, 1, light_eye);
+			glUniform1i(box_select, mode == CGV_SELECT);
+
+			if (gpu_culling) {
+				// the number of instances is only known by the GPU
+				glBindVertexArray(culled_vao);
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid *) 0, 1, 0);
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			} else {
+				glBindVertexArray(box_vao);
+				glDrawElementsInstanced(GL_TRIANGLES, n_indices, GL_UNSIGNED_INT, (const GLvoid *) 0, n_instances);
+			}
+			ring.end_segment();
+		}
+	}
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+#endif
+}
+
+/**
+ * Write the boxes that changed in the segment of the ring of the current frame, and point the instance attributes
+ * of the vertex array object of the boxes to that segment
+ * @param scene Scene whose boxes are written
+ * @retval true if the instances can be drawn, false if the ring cannot be created (the reason is written to stderr)
+ * @pre The vertex array object of the boxes is bound
+ * @post If boxes have been added or removed, every segment is written completely the next time it is used. Otherwise
+ * only the boxes that changed since the last use of the segment are written. The caller must call ring.end_segment()
+ * after the draw call
+ */
+bool cgvShaderRenderer::update_instances(cgvScene3D &scene) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	const size_t n_boxes = scene.get_num_boxes();
+
+	if (scene.get_revision() != uploaded_revision) {
+		if (n_boxes * sizeof(cgvBoxInstance) > ring.get_segment_size()) {
+			// the storage of the ring cannot grow: a bigger one is created, with room to grow
+			size_t capacity = (ring.get_segment_size() / sizeof(cgvBoxInstance)) * 2;
+			if (capacity < n_boxes) capacity = n_boxes;
+			if (!ring.create(capacity * sizeof(cgvBoxInstance))) return false;
+		}
+		for (int s = 0; s < cgvBufferRing::MAX_SEGMENTS; ++s) {
+			pending[s].clear();
+			pending_all[s] = true;
+		}
+		uploaded_revision = scene.get_revision();
+		n_instances = (GLsizei) n_boxes;
+	}
+
+	// the boxes that changed must be written in every segment
+	scene.take_dirty_boxes(changed);
+	for (int s = 0; s < ring.get_num_segments(); ++s) {
+		if (!pending_all[s]) pending[s].insert(pending[s].end(), changed.begin(), changed.end());
+	}
+
+	const int segment = ring.get_current_segment();
+	cgvBoxInstance *instances = (cgvBoxInstance *) ring.begin_segment();
+	if (pending_all[segment] || (pending[segment].size() >= n_boxes)) {
+		for (uint32_t i = 0; i < n_boxes; ++i) write_instance(scene, i, instances[i]);
+		ring.written(0, n_boxes * sizeof(cgvBoxInstance));
+		instances_written = n_boxes;
+	} else {
+		for (uint32_t i: pending[segment]) {
+			write_instance(scene, i, instances[i]);
+			ring.written(i * sizeof(cgvBoxInstance), sizeof(cgvBoxInstance));
+		}
+		instances_written = pending[segment].size();
+	}
+	pending[segment].clear();
+	pending_all[segment] = false;
+	ring.flush();
+
+	const GLintptr offset = ring.get_segment_offset();
+	glBindBuffer(GL_ARRAY_BUFFER, ring.get_buffer());
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(cgvBoxInstance),
+	                      (const GLvoid *) (offset + offsetof(cgvBoxInstance, position)));
+	glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(cgvBoxInstance),
+	                      (const GLvoid *) (offset + offsetof(cgvBoxInstance, color_as_ID)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Build the program and the vertex array object used to cull the boxes in the GPU
+ * @param cache Cache of program binaries
+ * @retval true if the context supports it (OpenGL 4.3: compute shaders, shader storage buffers and indirect draws)
+ */
+bool cgvShaderRenderer::init_culling(cgvProgramCache &cache) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (!cgvGLState::supports(4, 3, "GL_ARB_compute_shader") ||
+	    !cgvGLState::supports(4, 3, "GL_ARB_shader_storage_buffer_object") ||
+	    !cgvGLState::supports(4, 3, "GL_ARB_multi_draw_indirect")) {
+		return false;
+	}
+
+	cgvProgramSource source = { "the program of the culling", nullptr, nullptr, cull_compute_shader };
+	if (!cache.build(&source, 1, &cull_program)) return false;
+	cull_planes = glGetUniformLocation(cull_program, "planes");
+	cull_n_instances = glGetUniformLocation(cull_program, "n_instances");
+	cull_radius = glGetUniformLocation(cull_program, "radius");
+
+	// the same geometry of box_vao, with the instances of the visible boxes
+	glGenBuffers(1, &visible_buffer);
+	glGenVertexArrays(1, &culled_vao);
+	glBindVertexArray(culled_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, box_vbo);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (const GLvoid *) 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (const GLvoid *) (3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (const GLvoid *) (6 * sizeof(GLfloat)));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, box_ebo);
+
+	glBindBuffer(GL_ARRAY_BUFFER, visible_buffer);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(cgvBoxInstance),
+	                      (const GLvoid *) offsetof(cgvBoxInstance, position));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(cgvBoxInstance),
+	                      (const GLvoid *) offsetof(cgvBoxInstance, color_as_ID));
+	glVertexAttribDivisor(4, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	drawElementsCommand command = { (GLuint) n_indices, 0, 0, 0, 0 };
+	glGenBuffers(1, &command_buffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Write the visible boxes of the current segment of the ring in the buffer of visible instances, and their number
+ * in the indirect draw command
+ * @param camera Camera whose view volume is used
+ * @pre update_instances() has been called in this frame
+ * @post The draw command and the visible instances can be used once the commands issued here finish. The work of
+ * the CPU does not depend on the number of boxes
+ */
+void cgvShaderRenderer::cull_instances(const cgvCamera &camera) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if ((size_t) n_instances > visible_capacity) {
+		visible_capacity = ring.get_segment_size() / sizeof(cgvBoxInstance);
+		glBindBuffer(GL_ARRAY_BUFFER, visible_buffer);
+		glBufferData(GL_ARRAY_BUFFER, visible_capacity * sizeof(cgvBoxInstance), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	float planes[6][4];
+	camera.get_frustum_planes(planes);
+
+	// instance_count = 0, without waiting for the previous frames
+	const GLuint zero = 0;
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+	glClearBufferSubData(GL_DRAW_INDIRECT_BUFFER, GL_R32UI, offsetof(drawElementsCommand, instance_count),
+	                     sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glUseProgram(cull_program);
+	glUniform4fv(cull_planes, 6, planes[0]);
+	glUniform1ui(cull_n_instances, (GLuint) n_instances);
+	glUniform1f(cull_radius, cgvBox::bounding_radius());
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, ring.get_buffer(), ring.get_segment_offset(),
+	                  n_instances * sizeof(cgvBoxInstance));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visible_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, command_buffer);
+	glDispatchCompute((n_instances + 255) / 256, 1, 1);
+
+	// the results are read as vertex attributes and as the command of the draw call
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+#endif
+}
+
+/**
+ * Read the number of boxes that were visible in the last frame rendered with culling in the GPU
+ * @return The number of visible boxes
+ * @post The CPU waits for the GPU: it is only meant for statistics
+ */
+GLuint cgvShaderRenderer::read_num_visible() const {
+	drawElementsCommand command = { 0, 0, 0, 0, 0 };
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (command_buffer) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+		glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+#endif
+	return command.instance_count;
+}
+
+/**
+ * Copy the position, rotation, identifier and selection of a box
+ * @param scene Scene of the box
+ * @param i Index of the box
+ * @param instance Output data of the box
+ */
+void cgvShaderRenderer::write_instance(const cgvScene3D &scene, uint32_t i, cgvBoxInstance &instance) {
+	const cgvBox &box = scene.get_boxes()[i];
+	const cgvPoint3D &position = scene.get_positions()[i];
+
+	for (int c = X; c <= Z; ++c) instance.position[c] = position[c];
+	instance.angle = scene.get_rotations()[i][0];
+	cgvBox::id_to_color(box.get_id(), instance.color_as_ID);
+	instance.selected = box.isSelected() ? 255 : 0;
+}
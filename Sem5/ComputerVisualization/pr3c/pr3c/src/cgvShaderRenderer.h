@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+#include "cgvBufferRing.h"
+#include "cgvProgramCache.h"
+
+/**
+ * OpenGL pipelines that can render the scene
+ */
+typedef enum {
+	CGV_RENDERER_FIXED_FUNCTION, ///< Compatibility profile: cgvScene3D::render with glMaterial, lights and matrix stacks
+	CGV_RENDERER_CORE_PROFILE ///< OpenGL 3.3 core profile: cgvShaderRenderer
+} rendererBackend;
+
+/**
+ * Data of a box that changes from one instance to another when the boxes are rendered by cgvShaderRenderer
+ */
+struct cgvBoxInstance {
+	GLfloat position[3]; ///< Position of the center of the box
+	GLfloat angle; ///< Rotation around the Y axis (degrees)
+	GLubyte color_as_ID[3]; ///< RGB color used as an identifier
+	GLubyte selected; ///< 255 if the box is selected, 0 otherwise
+};
+
+/**
+ * cgvShaderRenderer renders a cgvScene3D with an OpenGL 3.3 core profile context: one instanced draw call for all the
+ * boxes and another one for the axes. The shaders reproduce the lighting of the fixed-function pipeline (emission,
+ * default ambient and diffuse material, point light source computed per vertex), the yellow selected boxes and the
+ * rendering with the color as identifier in selection mode. It also works with Mesa llvmpipe.
+ * The instances are written in a cgvBufferRing: a segment is only rewritten for the boxes that changed since the last
+ * time the same segment was used.
+ * With OpenGL 4.3 the boxes can also be culled in the GPU: a compute shader tests the bounding sphere of every box
+ * against the view volume and writes the visible ones in another buffer, together with the command of an indirect
+ * draw call. The work of the CPU per frame does not depend on the number of boxes.
+ */
+class cgvShaderRenderer {
+	GLuint box_program = 0; ///< Program to render the boxes
+	GLuint axes_program = 0; ///< Program to render the axes
+
+	GLuint box_vao = 0; ///< Vertex array object of the boxes
+	GLuint box_vbo = 0; ///< Vertices of one box (both pieces)
+	GLuint box_ebo = 0; ///< Indices of the triangles of one box
+	GLsizei n_indices = 0; ///< Number of indices of one box
+
+	cgvBufferRing ring; ///< One cgvBoxInstance per box in each segment
+	unsigned long uploaded_revision = 0; ///< Revision of the scene whose boxes are in the ring
+	GLsizei n_instances = 0; ///< Number of boxes in the ring
+	vector<uint32_t> changed; ///< Boxes that changed since the last frame
+	vector<uint32_t> pending[cgvBufferRing::MAX_SEGMENTS]; ///< Boxes that changed since each segment was written
+	bool pending_all[cgvBufferRing::MAX_SEGMENTS] = {}; ///< The whole segment must be written
+	unsigned long instances_written = 0; ///< Number of boxes written in the ring in the last frame
+
+	GLuint axes_vao = 0; ///< Vertex array object of the axes
+	GLuint axes_vbo = 0; ///< Vertices and colors of the axes
+
+	// culling in the GPU
+	GLuint cull_program = 0; ///< Compute program that culls the boxes (0 if the context does not support it)
+	GLuint culled_vao = 0; ///< Vertex array object of the boxes that read the visible instances
+	GLuint visible_buffer = 0; ///< Instances of the visible boxes, written by cull_program
+	GLuint command_buffer = 0; ///< Indirect draw command, with the number of visible boxes
+	size_t visible_capacity = 0; ///< Number of instances that fit in visible_buffer
+	bool gpu_culling = false; ///< true: the boxes are culled in the GPU
+
+	// locations of the uniforms of the box program
+	GLint box_view = -1, box_projection = -1, box_light = -1, box_select = -1, box_emission = -1;
+	// locations of the uniforms of the axes program
+	GLint axes_view = -1, axes_projection = -1;
+	// locations of the uniforms of the culling program
+	GLint cull_planes = -1, cull_n_instances = -1, cull_radius = -1;
+
+public:
+	cgvShaderRenderer() = default;
+	~cgvShaderRenderer();
+
+	cgvShaderRenderer(const cgvShaderRenderer&) = delete;
+	cgvShaderRenderer& operator=(const cgvShaderRenderer&) = delete;
+
+	bool init(cgvProgramCache *cache = nullptr);
+	void destroy();
+
+	bool is_valid() const { return box_program != 0; };
+
+	void render(cgvScene3D &scene, const cgvCamera &camera, RenderMode mode);
+
+	bool supports_gpu_culling() const { return cull_program != 0; };
+	bool get_gpu_culling() const { return gpu_culling; };
+	void set_gpu_culling(bool _gpu_culling) { gpu_culling = _gpu_culling && supports_gpu_culling(); };
+	GLuint read_num_visible() const;
+
+	const cgvBufferRing &get_ring() const { return ring; };
+	unsigned long get_instances_written() const { return instances_written; };
+	/**
+	 * @retval Memory of a box: its instance in each segment of the ring and in the visible instances, and its
+	 * indices in the lists of changed boxes
+	 */
+	static uint32_t get_bytes_per_box() {
+		return (uint32_t) ((cgvBufferRing::MAX_SEGMENTS + 1) * (sizeof(cgvBoxInstance) + sizeof(uint32_t)));
+	};
+
+private:
+	bool update_instances(cgvScene3D &scene);
+	bool init_culling(cgvProgramCache &cache);
+	void cull_instances(const cgvCamera &camera);
+	static void write_instance(const cgvScene3D &scene, uint32_t i, cgvBoxInstance &instance);
+};
@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <string.h>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "cgvSnapshot.h"
+#include "cgvMappedFile.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+static const char snapshot_magic[8] = {'C', 'G', 'V', 'S', 'N', 'A', 'P', 0}; ///< First bytes of a snapshot
+
+/**
+ * Identifiers of the columns of a snapshot, in the order of the table of columns
+ */
+enum snapshotColumnId : uint32_t {
+	CGV_COLUMN_BOXES = 1,
+	CGV_COLUMN_POSITIONS = 2,
+	CGV_COLUMN_ROTATIONS = 3,
+	CGV_NUM_COLUMNS = 3
+};
+
+/**
+ * Entry of the table of columns
+ */
+struct cgvSnapshotColumn {
+	uint32_t id; ///< snapshotColumnId
+	uint32_t element_size; ///< Bytes of the column per box
+	uint64_t offset; ///< Position of the column from the beginning of the file
+};
+
+/**
+ * Header of a snapshot, at the beginning of the file
+ */
+struct cgvSnapshotHeader {
+	char magic[8]; ///< snapshot_magic
+	uint32_t version; ///< cgvSnapshot::VERSION
+	uint32_t header_size; ///< sizeof(cgvSnapshotHeader)
+	uint64_t file_size; ///< Size of the whole file
+	uint32_t n_boxes; ///< Number of boxes
+	uint32_t n_columns; ///< CGV_NUM_COLUMNS
+	cgvSnapshotColumn columns[CGV_NUM_COLUMNS]; ///< Table of columns
+	uint32_t camera_type; ///< 0: no camera, 1 + cameraType
+	uint32_t reserved; ///< 0
+	double projection[6]; ///< Parallel: xwmin, xwmax, ywmin, ywmax, znear, zfar. Perspective: fovy, aspect, znear, zfar
+	float view[9]; ///< Point of view, reference point and up vector
+	float reserved_view; ///< 0
+};
+
+static_assert(sizeof(cgvSnapshotHeader) == 176, "the header of a snapshot must not have padding");
+static_assert(std::is_trivially_copyable<cgvBox>::value && (sizeof(cgvBox) == 4), "boxes cannot be copied in bulk");
+static_assert(std::is_trivially_copyable<cgvPoint3D>::value && (sizeof(cgvPoint3D) == 3 * sizeof(float)),
+              "positions cannot be copied in bulk");
+static_assert(sizeof(array<GLfloat, 2>) == 2 * sizeof(float), "rotations cannot be copied in bulk");
+
+/**
+ * @param offset Position in the file
+ * @retval The first position aligned to cgvSnapshot::COLUMN_ALIGNMENT from offset
+ */
+static uint64_t align_column(uint64_t offset) {
+	return (offset + cgvSnapshot::COLUMN_ALIGNMENT - 1) / cgvSnapshot::COLUMN_ALIGNMENT * cgvSnapshot::COLUMN_ALIGNMENT;
+}
+
+/**
+ * Check the header of a snapshot and the bounds of its columns
+ * @param data Content of the file
+ * @param size Size of the file
+ * @param header Output header
+ * @retval nullptr if the snapshot is valid, otherwise the reason
+ */
+static const char *validate_header(const uint8_t *data, size_t size, cgvSnapshotHeader &header) {
+	if (size < sizeof(header)) return "the file is too short";
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0) return "unknown format";
+	if (header.version != cgvSnapshot::VERSION) return "unsupported version";
+	if ((header.header_size != sizeof(header)) || (header.n_columns != CGV_NUM_COLUMNS)) return "corrupt header";
+	if (header.file_size != size) return "the file is truncated";
+	if (header.n_boxes >= (1u << 24)) return "too many boxes";
+	if (header.camera_type > 1 + CGV_PERSPECTIVE) return "unknown camera type";
+
+	const uint32_t element_sizes[CGV_NUM_COLUMNS] = {sizeof(cgvBox), sizeof(cgvPoint3D), sizeof(array<GLfloat, 2>)};
+	for (uint32_t c = 0; c < CGV_NUM_COLUMNS; ++c) {
+		const cgvSnapshotColumn &column = header.columns[c];
+		if ((column.id != c + 1) || (column.element_size != element_sizes[c])) return "unknown column layout";
+		if ((column.offset % cgvSnapshot::COLUMN_ALIGNMENT != 0) || (column.offset < sizeof(header)) ||
+		    (column.offset > size) || ((size - column.offset) / column.element_size < header.n_boxes)) {
+			return "a column is out of the file";
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Default constructor. No snapshot is open
+ */
+cgvSnapshot::cgvSnapshot() = default;
+
+/**
+ * Destructor. The open snapshot is closed
+ */
+cgvSnapshot::~cgvSnapshot() = default;
+
+/**
+ * Write a scene to a snapshot
+ * @param path Path of the file. It is replaced only when the whole snapshot has been written
+ * @param scene The scene
+ * @param camera Camera stored with the scene (nullptr: none)
+ * @retval true if the snapshot has been written. Otherwise, the reason is written to stderr
+ */
+bool cgvSnapshot::save(const std::string &path, const cgvScene3D &scene, const cgvCamera *camera) {
+	if (!cgvMappedFile::is_little_endian()) {
+		fprintf(stderr, "cgvSnapshot: the snapshots can only be written in little-endian hosts\n");
+		return false;
+	}
+
+	cgvSnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+	header.version = VERSION;
+	header.header_size = sizeof(header);
+	header.n_boxes = scene.get_num_boxes();
+	header.n_columns = CGV_NUM_COLUMNS;
+
+	const void *columns[CGV_NUM_COLUMNS] = {scene.get_boxes().data(), scene.get_positions().data(),
+	                                        scene.get_rotations().data()};
+	const uint32_t element_sizes[CGV_NUM_COLUMNS] = {sizeof(cgvBox), sizeof(cgvPoint3D), sizeof(array<GLfloat, 2>)};
+	uint64_t offset = sizeof(header);
+	for (uint32_t c = 0; c < CGV_NUM_COLUMNS; ++c) {
+		offset = align_column(offset);
+		header.columns[c] = {c + 1, element_sizes[c], offset};
+		offset += (uint64_t) element_sizes[c] * header.n_boxes;
+	}
+	header.file_size = offset;
+
+	if (camera) {
+		header.camera_type = 1 + (camera->isParallel() ? CGV_PARALLEL : CGV_PERSPECTIVE);
+		if (camera->isParallel()) {
+			camera->getParallelParameters(header.projection[0], header.projection[1], header.projection[2],
+			                              header.projection[3], header.projection[4], header.projection[5]);
+		} else {
+			camera->getPerspParameters(header.projection[0], header.projection[1], header.projection[2],
+			                           header.projection[3]);
+		}
+		cgvPoint3D view[3];
+		camera->getCameraParameters(view[0], view[1], view[2]);
+		for (int v = 0; v < 3; ++v) {
+			for (int i = X; i <= Z; ++i) header.view[3 * v + i] = view[v][i];
+		}
+	}
+
+#ifdef _WIN32
+	const std::string temporary = path + "." + std::to_string(_getpid());
+#else
+	const std::string temporary = path + "." + std::to_string(getpid());
+#endif
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file) {
+		fprintf(stderr, "cgvSnapshot: unable to write %s\n", temporary.c_str());
+		return false;
+	}
+
+	const char padding[COLUMN_ALIGNMENT] = {0};
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	uint64_t written = sizeof(header);
+	for (uint32_t c = 0; ok && (c < CGV_NUM_COLUMNS); ++c) {
+		const size_t bytes = (size_t) header.columns[c].element_size * header.n_boxes;
+		ok = (fwrite(padding, 1, (size_t) (header.columns[c].offset - written), file) ==
+		      header.columns[c].offset - written) && ((bytes == 0) || (fwrite(columns[c], bytes, 1, file) == 1));
+		written = header.columns[c].offset + bytes;
+	}
+	ok = (fclose(file) == 0) && ok;
+
+#ifdef _WIN32
+	if (ok) remove(path.c_str()); // rename does not replace existing files
+#endif
+	if (!ok || (rename(temporary.c_str(), path.c_str()) != 0)) {
+		remove(temporary.c_str());
+		fprintf(stderr, "cgvSnapshot: unable to write %s\n", path.c_str());
+		return false;
+	}
+	n_boxes = header.n_boxes;
+	n_bytes = (unsigned long) header.file_size;
+	return true;
+}
+
+/**
+ * Replace a scene with the one of a snapshot
+ * @param path Path of the file
+ * @param scene The scene
+ * @param camera Camera that takes the one of the snapshot, if it has one (nullptr: the camera is ignored)
+ * @retval true if the snapshot is valid and has been loaded. Otherwise, the reason is written to stderr and neither
+ * the scene nor the camera are changed
+ */
+bool cgvSnapshot::load(const std::string &path, cgvScene3D &scene, cgvCamera *camera) {
+	camera_loaded = false;
+	if (!open(path)) return false;
+
+	// the selection is a bool in memory: any other value than 0 or 1 is not valid
+	const uint8_t *boxes = file->get_data() + header->columns[0].offset;
+	for (uint32_t i = 0; i < header->n_boxes; ++i) {
+		if (boxes[sizeof(cgvBox) * i + offsetof(cgvBox, selected)] > 1) {
+			fprintf(stderr, "cgvSnapshot: %s is not a valid snapshot (corrupt box %u)\n", path.c_str(), i);
+			close();
+			return false;
+		}
+	}
+
+	scene.assign_boxes(header->n_boxes, (const cgvBox *) boxes,
+	                   (const cgvPoint3D *) (file->get_data() + header->columns[1].offset),
+	                   (const array<GLfloat, 2> *) (file->get_data() + header->columns[2].offset));
+	if (camera) camera_loaded = read_camera(*camera);
+	close();
+	return true;
+}
+
+/**
+ * Open a snapshot to read its boxes in parts (read_boxes)
+ * @param path Path of the file
+ * @retval true if the header of the snapshot is valid. Otherwise, the reason is written to stderr
+ * @post The file is mapped in memory until close() or the next open(). get_num_boxes() is its number of boxes
+ */
+bool cgvSnapshot::open(const std::string &path) {
+	close();
+	if (!cgvMappedFile::is_little_endian()) {
+		fprintf(stderr, "cgvSnapshot: the snapshots can only be read in little-endian hosts\n");
+		return false;
+	}
+
+	std::unique_ptr<cgvMappedFile> _file(new cgvMappedFile());
+	if (!_file->open(path)) {
+		fprintf(stderr, "cgvSnapshot: unable to read %s\n", path.c_str());
+		return false;
+	}
+	std::unique_ptr<cgvSnapshotHeader> _header(new cgvSnapshotHeader());
+	const char *error = validate_header(_file->get_data(), _file->get_size(), *_header);
+	if (error) {
+		fprintf(stderr, "cgvSnapshot: %s is not a valid snapshot (%s)\n", path.c_str(), error);
+		return false;
+	}
+
+	file = std::move(_file);
+	header = std::move(_header);
+	n_boxes = header->n_boxes;
+	n_bytes = (unsigned long) header->file_size;
+	return true;
+}
+
+/**
+ * Close the open snapshot
+ * @post The file is no longer mapped in memory
+ */
+void cgvSnapshot::close() {
+	file.reset();
+	header.reset();
+}
+
+/**
+ * Copy consecutive boxes of the open snapshot. It can be called from any thread while the snapshot is open
+ * @param first Index of the first box
+ * @param n Number of boxes
+ * @param boxes Output boxes (n)
+ * @param positions Output positions (n)
+ * @param rotations Output rotations (n)
+ * @retval true if the boxes are valid. Otherwise, the reason is written to stderr
+ * @pre A snapshot is open, and first + n <= get_num_boxes()
+ */
+bool cgvSnapshot::read_boxes(uint32_t first, uint32_t n, cgvBox *boxes, cgvPoint3D *positions,
+                             std::array<float, 2> *rotations) const {
+	const uint8_t *data = file->get_data();
+	const uint8_t *box_data = data + header->columns[0].offset + sizeof(cgvBox) * first;
+	for (uint32_t i = 0; i < n; ++i) {
+		if (box_data[sizeof(cgvBox) * i + offsetof(cgvBox, selected)] > 1) {
+			fprintf(stderr, "cgvSnapshot: corrupt box %u in the snapshot\n", first + i);
+			return false;
+		}
+	}
+	memcpy(boxes, box_data, sizeof(cgvBox) * n);
+	memcpy(positions, data + header->columns[1].offset + sizeof(cgvPoint3D) * first, sizeof(cgvPoint3D) * n);
+	memcpy(rotations, data + header->columns[2].offset + sizeof(array<GLfloat, 2>) * first,
+	       sizeof(array<GLfloat, 2>) * n);
+	return true;
+}
+
+/**
+ * Set a camera with the one of the open snapshot
+ * @param camera The camera
+ * @retval true if the snapshot has a camera. Otherwise, the camera is not changed
+ * @pre A snapshot is open
+ */
+bool cgvSnapshot::read_camera(cgvCamera &camera) const {
+	if (!header->camera_type) return false;
+	const double *p = header->projection;
+	const float *v = header->view;
+	camera.setCameraParameters(cgvPoint3D(v[0], v[1], v[2]), cgvPoint3D(v[3], v[4], v[5]), cgvPoint3D(v[6], v[7], v[8]));
+	if (header->camera_type == 1 + CGV_PARALLEL) {
+		camera.setParallelParameters(p[1], p[3], p[4], p[5]);
+	} else {
+		camera.setPerspParameters(p[0], p[1], p[2], p[3]);
+	}
+	return true;
+}
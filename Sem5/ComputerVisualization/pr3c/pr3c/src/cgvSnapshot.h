@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <memory>
+#include <string>
+
+class cgvScene3D;
+class cgvCamera;
+class cgvBox;
+class cgvPoint3D;
+class cgvMappedFile;
+struct cgvSnapshotHeader;
+
+/**
+ * cgvSnapshot saves and loads scenes in a binary file whose columns have the layout of the arrays of cgvScene3D
+ * (boxes, positions and rotations), so that loading a scene is a validation of the header and a bulk copy of each
+ * column, without parsing the boxes one by one. The file is mapped in memory (read into memory on Windows).
+ * A snapshot can also be opened to read its boxes in parts (open, read_boxes and close).
+ *
+ * Layout of the file (little-endian, version 1):
+ * - header: magic "CGVSNAP", version, size of the header and of the file, number of boxes, the table of columns
+ *   (identifier, size of an element, offset) and the camera (optional)
+ * - columns, each one aligned to COLUMN_ALIGNMENT bytes: boxes (RGB identifier and selection, 4 bytes), positions
+ *   (3 floats) and rotations (2 floats: around Y and around X)
+ */
+class cgvSnapshot {
+public:
+	static const uint32_t VERSION = 1; ///< Version of the format written by save
+	static const uint32_t COLUMN_ALIGNMENT = 64; ///< Alignment of the offset of each column in the file
+
+private:
+	unsigned long n_boxes = 0; ///< Number of boxes of the last load or save
+	unsigned long n_bytes = 0; ///< Size of the file of the last load or save
+	bool camera_loaded = false; ///< The last load has set the camera
+	std::unique_ptr<cgvMappedFile> file; ///< Content of the open snapshot
+	std::unique_ptr<cgvSnapshotHeader> header; ///< Header of the open snapshot
+
+public:
+	cgvSnapshot();
+	~cgvSnapshot();
+
+	bool save(const std::string &path, const cgvScene3D &scene, const cgvCamera *camera);
+	bool load(const std::string &path, cgvScene3D &scene, cgvCamera *camera);
+
+	bool open(const std::string &path);
+	void close();
+	bool read_boxes(uint32_t first, uint32_t n, cgvBox *boxes, cgvPoint3D *positions,
+	                std::array<float, 2> *rotations) const;
+	bool read_camera(cgvCamera &camera) const;
+
+	/**
+	 * @retval true if the file of the last load contained a camera, and it has been set
+	 */
+	bool has_loaded_camera() const { return camera_loaded; };
+	/**
+	 * @retval Number of boxes of the last load or save, or of the open snapshot
+	 */
+	unsigned long get_num_boxes() const { return n_boxes; };
+	unsigned long get_num_bytes() const { return n_bytes; };
+};
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "cgvSoftwareOccluder.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+// Half of the size of the body of a box: the occluders are only the solid part of the boxes
+static const float body_half[3] = {0.55f, 0.5f, 1.0f};
+
+// Half of the size of the bounding box of the body and the top piece of a box, used in the tests
+static const float bounds_half[3] = {0.585f, 0.51f, 1.035f};
+
+// Corners of each face of a box (bit 0: +X, bit 1: +Y, bit 2: +Z), counterclockwise seen from outside
+static const int box_faces[6][4] = {
+	{0, 4, 6, 2}, {1, 3, 7, 5}, // -X, +X
+	{0, 1, 5, 4}, {2, 6, 7, 3}, // -Y, +Y
+	{0, 2, 3, 1}, {4, 5, 7, 6}  // -Z, +Z
+};
+
+/**
+ * Compute the clip coordinates of the corners of a box
+ * @param m Projection matrix multiplied by the view matrix, column-major order
+ * @param position Center of the box
+ * @param angle Rotation of the box around the Y axis, in degrees
+ * @param half Half of the size of the box along each axis, before the rotation
+ * @param corners Output clip coordinates (x, y, z, w) of the 8 corners, in the order of box_faces
+ */
+static void project_box(const float m[16], const cgvPoint3D &position, float angle, const float half[3],
+                        float corners[8][4]) {
+	const float radians = angle * 3.14159265358979f / 180;
+	const float c = cosf(radians), s = sinf(radians);
+
+	// the same rotation as glRotatef(angle, 0, 1, 0): the columns are the axes of the box
+	const float axes[3][3] = {{c * half[0], 0, -s * half[0]}, {0, half[1], 0}, {s * half[2], 0, c * half[2]}};
+
+	float center[4], clip_axes[3][4];
+	for (int r = 0; r < 4; ++r) {
+		center[r] = m[r] * position[X] + m[4 + r] * position[Y] + m[8 + r] * position[Z] + m[12 + r];
+		for (int a = 0; a < 3; ++a) {
+			clip_axes[a][r] = m[r] * axes[a][0] + m[4 + r] * axes[a][1] + m[8 + r] * axes[a][2];
+		}
+	}
+	for (int k = 0; k < 8; ++k) {
+		for (int r = 0; r < 4; ++r) {
+			corners[k][r] = center[r] + ((k & 1) ? clip_axes[0][r] : -clip_axes[0][r]) +
+			                ((k & 2) ? clip_axes[1][r] : -clip_axes[1][r]) +
+			                ((k & 4) ? clip_axes[2][r] : -clip_axes[2][r]);
+		}
+	}
+}
+
+
+// Public methods ----------------------------------------
+
+/**
+ * Constructor. It uses as many threads as the hardware supports
+ */
+cgvSoftwareOccluder::cgvSoftwareOccluder() {
+	set_num_threads(std::thread::hardware_concurrency());
+}
+
+/**
+ * Destructor. The workers are finished
+ */
+cgvSoftwareOccluder::~cgvSoftwareOccluder() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+	task_ready.notify_all();
+	for (std::thread &worker : workers) worker.join();
+}
+
+/**
+ * Decide which boxes of a scene are hidden in a view
+ * @param scene The scene to be rendered
+ * @param camera The camera of the view
+ * @post is_occluded() returns true for the boxes hidden by the occluders and for the boxes outside of the view
+ * volume. The number of each of them is available in get_num_occluded() and get_num_outside()
+ */
+void cgvSoftwareOccluder::cull(const cgvScene3D &scene, const cgvCamera &camera) {
+	const uint32_t n_boxes = scene.get_num_boxes();
+	occluded.assign(n_boxes, 0);
+	depth.resize(WIDTH * HEIGHT);
+	tile_max.resize((WIDTH / TILE_WIDTH) * (HEIGHT / TILE_HEIGHT));
+
+	float view[16], projection[16], m[16], planes[6][4];
+	camera.get_view_matrix(view);
+	camera.get_projection_matrix(projection);
+	camera.get_frustum_planes(planes);
+	for (int c = 0; c < 4; ++c) {
+		for (int r = 0; r < 4; ++r) {
+			m[c * 4 + r] = projection[r] * view[c * 4] + projection[4 + r] * view[c * 4 + 1] +
+			               projection[8 + r] * view[c * 4 + 2] + projection[12 + r] * view[c * 4 + 3];
+		}
+	}
+
+	select_occluders(scene, view, m, planes);
+
+	// corners of the occluders in the depth buffer. The ones that cross the near plane are dropped
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	occluder_corners.resize(occluders.size() * 8 * 3);
+	size_t n_occluders = 0;
+	for (uint32_t b : occluders) {
+		float corners[8][4];
+		project_box(m, positions[b], rotations[b][0], body_half, corners);
+
+		bool valid = true;
+		float *screen = &occluder_corners[n_occluders * 8 * 3];
+		for (int k = 0; (k < 8) && valid; ++k) {
+			valid = (corners[k][3] > 1e-6f) && (corners[k][2] >= -corners[k][3]);
+			screen[k * 3 + 0] = (corners[k][0] / corners[k][3] + 1) * 0.5f * WIDTH;
+			screen[k * 3 + 1] = (corners[k][1] / corners[k][3] + 1) * 0.5f * HEIGHT;
+			screen[k * 3 + 2] = corners[k][2] / corners[k][3];
+		}
+		if (valid) occluders[n_occluders++] = b;
+	}
+	occluders.resize(n_occluders);
+	occluder_corners.resize(n_occluders * 8 * 3);
+
+	// each thread rasterizes a band of rows of tiles
+	const int tile_rows = HEIGHT / TILE_HEIGHT;
+	const unsigned int raster_threads = std::min(n_threads, (unsigned int) tile_rows);
+	run_parallel(raster_threads, [&](unsigned int t) {
+		rasterize(tile_rows * t / raster_threads * TILE_HEIGHT, tile_rows * (t + 1) / raster_threads * TILE_HEIGHT);
+	});
+
+	// each thread tests a range of boxes. Small scenes are not worth a thread
+	const unsigned int test_threads = std::max(1u, std::min(n_threads, n_boxes / 4096));
+	std::vector<unsigned long> thread_occluded(test_threads), thread_outside(test_threads);
+	run_parallel(test_threads, [&](unsigned int t) {
+		thread_occluded[t] = test_boxes(scene, m, (uint32_t) ((uint64_t) n_boxes * t / test_threads),
+		                                (uint32_t) ((uint64_t) n_boxes * (t + 1) / test_threads), thread_outside[t]);
+	});
+
+	n_occluded = 0;
+	n_outside = 0;
+	for (unsigned int t = 0; t < test_threads; ++t) {
+		n_occluded += thread_occluded[t];
+		n_outside += thread_outside[t];
+	}
+}
+
+
+// Private methods ---------------------------------------
+
+/**
+ * Run a task in several threads, and wait until all of them finish
+ * @param _n_threads Number of threads. The calling thread runs the task with index 0, and the workers the rest
+ * @param _task Function called with the index of each thread
+ * @post The workers that were missing have been started. They are kept for the next tasks
+ */
+void cgvSoftwareOccluder::run_parallel(unsigned int _n_threads, const std::function<void(unsigned int)> &_task) {
+	if (_n_threads <= 1) {
+		_task(0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (workers.size() + 1 < _n_threads) {
+			workers.emplace_back(&cgvSoftwareOccluder::work, this, (unsigned int) workers.size() + 1, generation);
+		}
+		task = &_task;
+		task_threads = _n_threads;
+		n_running = _n_threads - 1;
+		++generation;
+	}
+	task_ready.notify_all();
+	_task(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	task_done.wait(lock, [this] { return n_running == 0; });
+	task = nullptr;
+}
+
+/**
+ * Loop of a worker: it runs its part of each task, until the occluder is destroyed
+ * @param index Index of the part of the tasks run by the worker
+ * @param seen Number of tasks started before the worker
+ */
+void cgvSoftwareOccluder::work(unsigned int index, unsigned long seen) {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		task_ready.wait(lock, [&] { return closing || (generation != seen); });
+		if (closing) return;
+		seen = generation;
+		if (index >= task_threads) continue; // this task has fewer parts
+
+		const std::function<void(unsigned int)> &current = *task;
+		lock.unlock();
+		current(index);
+		lock.lock();
+		if (--n_running == 0) task_done.notify_one();
+	}
+}
+
+/**
+ * Choose the occluders of the frame: in each cell of the screen, the OCCLUDERS_PER_CELL boxes nearest to the camera
+ * whose centers are in the cell. If there are more than max_occluders, the nearest ones are kept
+ * @param scene The scene
+ * @param view View matrix of the camera
+ * @param m Projection matrix multiplied by the view matrix
+ * @param planes Planes of the view volume of the camera
+ * @post occluders contains the chosen boxes, in any order
+ */
+void cgvSoftwareOccluder::select_occluders(const cgvScene3D &scene, const float view[16], const float m[16],
+                                           const float planes[6][4]) {
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const uint32_t n_boxes = (uint32_t) positions.size();
+	const float radius = cgvBox::bounding_radius();
+	occluders.clear();
+	if (max_occluders == 0) return;
+
+	// key of each candidate: distance to the camera (the bits of a positive float sort as integers) and index.
+	// Each thread keeps the nearest candidates of each cell, in increasing order
+	const int columns = WIDTH / OCCLUDER_CELL, rows = HEIGHT / OCCLUDER_CELL;
+	const unsigned int select_threads = std::max(1u, std::min(n_threads, n_boxes / 4096));
+	std::vector<std::vector<uint64_t> > candidates(select_threads);
+	run_parallel(select_threads, [&](unsigned int t) {
+		std::vector<uint64_t> &keys = candidates[t];
+		keys.assign(columns * rows * OCCLUDERS_PER_CELL, UINT64_MAX);
+		const uint32_t last = (uint32_t) ((uint64_t) n_boxes * (t + 1) / select_threads);
+		for (uint32_t b = (uint32_t) ((uint64_t) n_boxes * t / select_threads); b < last; ++b) {
+			const cgvPoint3D &p = positions[b];
+			bool inside = true;
+			for (int i = 0; (i < 6) && inside; ++i) {
+				inside = planes[i][0] * p[X] + planes[i][1] * p[Y] + planes[i][2] * p[Z] + planes[i][3] >= -radius;
+			}
+			if (!inside) continue;
+
+			float distance = -(view[2] * p[X] + view[6] * p[Y] + view[10] * p[Z] + view[14]);
+			if (distance <= 0) continue;
+			const float w = m[3] * p[X] + m[7] * p[Y] + m[11] * p[Z] + m[15];
+			if (w <= 1e-6f) continue;
+			const float x = (m[0] * p[X] + m[4] * p[Y] + m[8] * p[Z] + m[12]) / w;
+			const float y = (m[1] * p[X] + m[5] * p[Y] + m[9] * p[Z] + m[13]) / w;
+			const int column = std::min(columns - 1, std::max(0, (int) ((x + 1) * 0.5f * columns)));
+			const int row = std::min(rows - 1, std::max(0, (int) ((y + 1) * 0.5f * rows)));
+
+			uint32_t bits;
+			memcpy(&bits, &distance, sizeof(bits));
+			uint64_t key = ((uint64_t) bits << 32) | b;
+			uint64_t *cell = &keys[(row * columns + column) * OCCLUDERS_PER_CELL];
+			for (int k = 0; (k < OCCLUDERS_PER_CELL) && (key < UINT64_MAX); ++k) {
+				if (key < cell[k]) std::swap(key, cell[k]);
+			}
+		}
+	});
+
+	std::vector<uint64_t> &keys = candidates[0];
+	for (unsigned int t = 1; t < select_threads; ++t) {
+		for (size_t c = 0; c < keys.size(); c += OCCLUDERS_PER_CELL) {
+			for (int i = 0; i < OCCLUDERS_PER_CELL; ++i) {
+				uint64_t key = candidates[t][c + i];
+				for (int k = 0; (k < OCCLUDERS_PER_CELL) && (key < UINT64_MAX); ++k) {
+					if (key < keys[c + k]) std::swap(key, keys[c + k]);
+				}
+			}
+		}
+	}
+	keys.erase(std::remove(keys.begin(), keys.end(), UINT64_MAX), keys.end());
+	if (keys.size() > max_occluders) {
+		std::nth_element(keys.begin(), keys.begin() + max_occluders, keys.end());
+		keys.resize(max_occluders);
+	}
+	for (uint64_t key : keys) occluders.push_back((uint32_t) key);
+}
+
+/**
+ * Rasterize the occluders in a band of rows of the depth buffer
+ * @param first_row First row of the band, multiple of TILE_HEIGHT
+ * @param last_row Row after the last one of the band, multiple of TILE_HEIGHT
+ * @post The depth and the tiles of the band are up to date
+ */
+void cgvSoftwareOccluder::rasterize(int first_row, int last_row) {
+	std::fill(depth.begin() + first_row * WIDTH, depth.begin() + last_row * WIDTH, FLT_MAX);
+
+	for (size_t o = 0; o < occluders.size(); ++o) {
+		const float *corners = &occluder_corners[o * 8 * 3];
+
+		float y_min = corners[1], y_max = corners[1];
+		for (int k = 1; k < 8; ++k) {
+			y_min = std::min(y_min, corners[k * 3 + 1]);
+			y_max = std::max(y_max, corners[k * 3 + 1]);
+		}
+		if ((y_max < first_row) || (y_min > last_row)) continue;
+
+		rasterize_box(corners, first_row, last_row);
+	}
+
+	// farthest depth of each tile
+	for (int ty = first_row / TILE_HEIGHT; ty < last_row / TILE_HEIGHT; ++ty) {
+		for (int tx = 0; tx < WIDTH / TILE_WIDTH; ++tx) {
+			float farthest = 0;
+			for (int y = ty * TILE_HEIGHT; y < (ty + 1) * TILE_HEIGHT; ++y) {
+				const float *row = &depth[y * WIDTH + tx * TILE_WIDTH];
+				for (int x = 0; x < TILE_WIDTH; ++x) farthest = std::max(farthest, row[x]);
+			}
+			tile_max[ty * (WIDTH / TILE_WIDTH) + tx] = farthest;
+		}
+	}
+}
+
+/**
+ * Rasterize an occluder in a band of rows of the depth buffer, keeping the nearest depth of each pixel
+ * @param corners Coordinates (x, y, depth) of the 8 corners of the occluder in the depth buffer
+ * @param first_row First row of the band
+ * @param last_row Row after the last one of the band
+ * @post Only the pixels completely inside the silhouette of the box are updated, with the farthest depth of the box
+ * in the pixel, so that the depth buffer never hides something that is visible
+ */
+void cgvSoftwareOccluder::rasterize_box(const float *corners, int first_row, int last_row) {
+	// planes of the faces that look at the camera: z = z0 + dz_dx * x + dz_dy * y. The surface of a convex object
+	// seen in a pixel is the farthest of those planes
+	float planes[3][3];
+	int n_planes = 0;
+	for (const int *face : box_faces) {
+		const float *a = corners + face[0] * 3, *b = corners + face[1] * 3, *c = corners + face[2] * 3;
+		const float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+		if ((area <= 1e-6f) || (n_planes == 3)) continue;
+
+		const float dz_dx = ((b[2] - a[2]) * (c[1] - a[1]) - (c[2] - a[2]) * (b[1] - a[1])) / area;
+		const float dz_dy = ((c[2] - a[2]) * (b[0] - a[0]) - (b[2] - a[2]) * (c[0] - a[0])) / area;
+		planes[n_planes][0] = a[2] - dz_dx * a[0] - dz_dy * a[1] + 0.5f * (fabsf(dz_dx) + fabsf(dz_dy));
+		planes[n_planes][1] = dz_dx;
+		planes[n_planes][2] = dz_dy;
+		++n_planes;
+	}
+	if (n_planes == 0) return;
+
+	// silhouette: convex hull of the corners, counterclockwise (monotone chain)
+	array<float, 2> points[8], hull[16];
+	for (int k = 0; k < 8; ++k) points[k] = {{corners[k * 3], corners[k * 3 + 1]}};
+	std::sort(points, points + 8);
+	auto turn = [](const array<float, 2> &o, const array<float, 2> &a, const array<float, 2> &b) {
+		return (a[0] - o[0]) * (b[1] - o[1]) - (a[1] - o[1]) * (b[0] - o[0]);
+	};
+	int n_hull = 0;
+	for (int k = 0; k < 8; ++k) {
+		while ((n_hull >= 2) && (turn(hull[n_hull - 2], hull[n_hull - 1], points[k]) <= 0)) --n_hull;
+		hull[n_hull++] = points[k];
+	}
+	for (int k = 6, lower = n_hull + 1; k >= 0; --k) {
+		while ((n_hull >= lower) && (turn(hull[n_hull - 2], hull[n_hull - 1], points[k]) <= 0)) --n_hull;
+		hull[n_hull++] = points[k];
+	}
+	--n_hull; // the last point is the first one
+
+	// edges of the silhouette, shifted so that they are only positive in the pixels completely inside
+	float edges[8][3];
+	float x_min = hull[0][0], x_max = hull[0][0], y_min = hull[0][1], y_max = hull[0][1];
+	for (int e = 0; e < n_hull; ++e) {
+		const array<float, 2> &p = hull[e], &q = hull[(e + 1) % n_hull];
+		edges[e][0] = -(q[1] - p[1]);
+		edges[e][1] = q[0] - p[0];
+		edges[e][2] = -(edges[e][0] * p[0] + edges[e][1] * p[1]) - 0.5f * (fabsf(edges[e][0]) + fabsf(edges[e][1]));
+		x_min = std::min(x_min, p[0]);
+		x_max = std::max(x_max, p[0]);
+		y_min = std::min(y_min, p[1]);
+		y_max = std::max(y_max, p[1]);
+	}
+
+	// pixels completely inside the bounding box of the silhouette
+	const int x0 = std::max(0, (int) ceilf(x_min)), x1 = std::min(WIDTH - 1, (int) floorf(x_max) - 1);
+	const int y0 = std::max(first_row, (int) ceilf(y_min)), y1 = std::min(last_row - 1, (int) floorf(y_max) - 1);
+
+	for (int y = y0; y <= y1; ++y) {
+		float *row = &depth[y * WIDTH];
+		const float cy = y + 0.5f;
+		for (int x = x0; x <= x1; ++x) {
+			const float cx = x + 0.5f;
+			bool inside = true;
+			for (int e = 0; e < n_hull; ++e) inside &= edges[e][0] * cx + edges[e][1] * cy + edges[e][2] >= 0;
+			if (!inside) continue;
+
+			float z = planes[0][0] + planes[0][1] * cx + planes[0][2] * cy;
+			for (int i = 1; i < n_planes; ++i) z = std::max(z, planes[i][0] + planes[i][1] * cx + planes[i][2] * cy);
+			row[x] = std::min(row[x], z);
+		}
+	}
+}
+
+/**
+ * Test a range of boxes against the depth buffer
+ * @param scene The scene
+ * @param m Projection matrix multiplied by the view matrix
+ * @param first First box of the range
+ * @param last Box after the last one of the range
+ * @param outside Output number of boxes of the range outside of the view volume
+ * @return Number of boxes of the range hidden by the occluders
+ */
+unsigned long cgvSoftwareOccluder::test_boxes(const cgvScene3D &scene, const float m[16], uint32_t first,
+                                              uint32_t last, unsigned long &outside) {
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	unsigned long hidden = 0;
+	outside = 0;
+
+	for (uint32_t b = first; b < last; ++b) {
+		float corners[8][4];
+		project_box(m, positions[b], rotations[b][0], bounds_half, corners);
+
+		float x_min = FLT_MAX, y_min = FLT_MAX, z_min = FLT_MAX, x_max = -FLT_MAX, y_max = -FLT_MAX, z_max = -FLT_MAX;
+		bool behind = false;
+		for (int k = 0; k < 8; ++k) {
+			if (corners[k][3] <= 1e-6f) {
+				behind = true; // the box crosses the plane of the camera: it is not tested
+				break;
+			}
+			const float x = corners[k][0] / corners[k][3], y = corners[k][1] / corners[k][3];
+			const float z = corners[k][2] / corners[k][3];
+			x_min = std::min(x_min, x);
+			x_max = std::max(x_max, x);
+			y_min = std::min(y_min, y);
+			y_max = std::max(y_max, y);
+			z_min = std::min(z_min, z);
+			z_max = std::max(z_max, z);
+		}
+		if (behind) continue;
+
+		if ((x_max < -1) || (x_min > 1) || (y_max < -1) || (y_min > 1) || (z_max < -1) || (z_min > 1)) {
+			occluded[b] = 1;
+			++outside;
+		} else if (test_rectangle((x_min + 1) * 0.5f * WIDTH, (y_min + 1) * 0.5f * HEIGHT, (x_max + 1) * 0.5f * WIDTH,
+		                          (y_max + 1) * 0.5f * HEIGHT, z_min)) {
+			occluded[b] = 1;
+			++hidden;
+		}
+	}
+	return hidden;
+}
+
+/**
+ * Test whether a rectangle of the screen is behind the occluders
+ * @param x_min Left side, in columns of the depth buffer
+ * @param y_min Bottom side, in rows of the depth buffer
+ * @param x_max Right side
+ * @param y_max Top side
+ * @param z_min Nearest depth of the object in the rectangle
+ * @retval true if every pixel touched by the rectangle is nearer than z_min
+ */
+bool cgvSoftwareOccluder::test_rectangle(float x_min, float y_min, float x_max, float y_max, float z_min) const {
+	const int x0 = std::max(0, (int) floorf(x_min)), x1 = std::min(WIDTH - 1, (int) floorf(x_max));
+	const int y0 = std::max(0, (int) floorf(y_min)), y1 = std::min(HEIGHT - 1, (int) floorf(y_max));
+
+	for (int ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ++ty) {
+		for (int tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; ++tx) {
+			if (tile_max[ty * (WIDTH / TILE_WIDTH) + tx] < z_min) continue; // the whole tile is in front
+
+			const int px0 = std::max(x0, tx * TILE_WIDTH), px1 = std::min(x1, (tx + 1) * TILE_WIDTH - 1);
+			const int py0 = std::max(y0, ty * TILE_HEIGHT), py1 = std::min(y1, (ty + 1) * TILE_HEIGHT - 1);
+			for (int y = py0; y <= py1; ++y) {
+				const float *row = &depth[y * WIDTH];
+				bool covered = true;
+				for (int x = px0; x <= px1; ++x) covered &= row[x] < z_min;
+				if (!covered) return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class cgvScene3D;
+class cgvCamera;
+
+/**
+ * cgvSoftwareOccluder decides on the CPU which boxes of a scene are hidden by other boxes, without any OpenGL query.
+ * The OCCLUDERS_PER_CELL boxes nearest to the camera in each cell of OCCLUDER_CELL x OCCLUDER_CELL pixels (the
+ * occluders) are rasterized into a low resolution depth buffer, and the bounding box of every box is tested against
+ * it: a box is occluded if its nearest point is behind the occluders in every pixel that its bounding box covers.
+ * The occluders only cover the pixels completely inside them, with their farthest depth in the pixel, so that a
+ * visible box is never culled. The depth buffer is divided into tiles of TILE_WIDTH x TILE_HEIGHT pixels with
+ * the farthest depth of each tile, so that most tests only read one value per tile.
+ * The rasterization is split in bands of rows and the tests in ranges of boxes, one per thread. The threads are
+ * started by the first frame that needs them, and they wait for the work of the next frames.
+ */
+class cgvSoftwareOccluder {
+public:
+	static const int WIDTH = 512; ///< Columns of the depth buffer
+	static const int HEIGHT = 512; ///< Rows of the depth buffer
+	static const int TILE_WIDTH = 8; ///< Columns of a tile (one row of a tile fits in a SIMD register)
+	static const int TILE_HEIGHT = 8; ///< Rows of a tile
+	static const int OCCLUDER_CELL = 4; ///< Columns and rows of the cells of the screen where occluders are chosen
+	static const int OCCLUDERS_PER_CELL = 4; ///< Occluders chosen in each cell, to fill the gaps between the nearest
+	static const unsigned int DEFAULT_MAX_OCCLUDERS = 16384; ///< Default number of occluders of each frame
+
+private:
+	std::vector<float> depth; ///< Normalized device depth of the nearest occluder in each pixel, row by row
+	std::vector<float> tile_max; ///< Farthest depth of each tile
+	std::vector<uint8_t> occluded; ///< 1 for each box that is not rendered in this frame
+	std::vector<uint32_t> occluders; ///< Boxes rasterized in this frame
+	std::vector<float> occluder_corners; ///< Screen coordinates (x, y, depth) of the 8 corners of each occluder
+
+	unsigned int max_occluders = DEFAULT_MAX_OCCLUDERS; ///< Maximum number of occluders of each frame
+	unsigned int n_threads; ///< Threads used in each frame, including the caller
+
+	// threads that run each part of a frame with the caller (run_parallel)
+	std::vector<std::thread> workers; ///< Worker i runs the part i + 1 of each task
+	std::mutex mutex; ///< Guards task, task_threads, generation, n_running and closing
+	std::condition_variable task_ready; ///< A task has been started, or the workers must finish
+	std::condition_variable task_done; ///< Every worker has finished its part of the task
+	const std::function<void(unsigned int)> *task = nullptr; ///< Task being run, called with the index of each part
+	unsigned int task_threads = 0; ///< Parts of the task being run, including the one of the caller
+	unsigned long generation = 0; ///< Number of tasks started
+	unsigned int n_running = 0; ///< Workers that have not finished their part of the task
+	bool closing = false; ///< The workers must finish
+
+	unsigned long n_occluded = 0; ///< Boxes hidden by the occluders in the last frame
+	unsigned long n_outside = 0; ///< Boxes outside of the view volume in the last frame
+
+public:
+	cgvSoftwareOccluder();
+	~cgvSoftwareOccluder();
+
+	cgvSoftwareOccluder(const cgvSoftwareOccluder&) = delete;
+	cgvSoftwareOccluder& operator=(const cgvSoftwareOccluder&) = delete;
+
+	void cull(const cgvScene3D &scene, const cgvCamera &camera);
+
+	/**
+	 * @param box Index of a box
+	 * @retval true if the box was hidden or outside of the view volume in the last call to cull()
+	 */
+	bool is_occluded(uint32_t box) const { return (box < occluded.size()) && occluded[box]; };
+
+	unsigned int get_max_occluders() const { return max_occluders; };
+	void set_max_occluders(unsigned int _max_occluders) { max_occluders = _max_occluders; };
+	unsigned int get_num_threads() const { return n_threads; };
+	void set_num_threads(unsigned int _n_threads) { n_threads = (_n_threads > 0) ? _n_threads : 1; };
+	unsigned int get_num_workers() const { return (unsigned int) workers.size(); };
+
+	unsigned long get_num_occluders() const { return (unsigned long) occluders.size(); };
+	unsigned long get_num_occluded() const { return n_occluded; };
+	unsigned long get_num_outside() const { return n_outside; };
+	/**
+	 * @retval Memory of the result of a box (the occluders and the depth buffer do not depend on the number of boxes)
+	 */
+	static uint32_t get_bytes_per_box() { return (uint32_t) sizeof(uint8_t); };
+	const std::vector<float> &get_depth() const { return depth; };
+
+private:
+	void run_parallel(unsigned int _n_threads, const std::function<void(unsigned int)> &_task);
+	void work(unsigned int index, unsigned long seen);
+	void select_occluders(const cgvScene3D &scene, const float view[16], const float m[16], const float planes[6][4]);
+	void rasterize(int first_row, int last_row);
+	void rasterize_box(const float *corners, int first_row, int last_row);
+	unsigned long test_boxes(const cgvScene3D &scene, const float m[16], uint32_t first, uint32_t last,
+	                         unsigned long &outside);
+	bool test_rectangle(float x_min, float y_min, float x_max, float y_max, float z_min) const;
+};
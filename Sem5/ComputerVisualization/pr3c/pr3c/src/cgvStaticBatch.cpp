@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <cmath>
+#include <cstddef>
+
+#include "cgvStaticBatch.h"
+#include "cgvScene3D.h"
+#include "cgvCamera.h"
+
+/**
+ * Default constructor. The geometry of a box is computed here, as it does not depend on the scene
+ */
+cgvStaticBatch::cgvStaticBatch() {
+	std::vector<GLfloat> mesh;
+	std::vector<GLuint> indices;
+	cgvBox::build_mesh(mesh, indices);
+
+	// the vertices of build_mesh are the quads of both pieces, in order
+	for (int v = 0; v < BOX_VERTICES; ++v) {
+		const GLfloat *m = &mesh[7 * v];
+		for (int c = 0; c < 3; ++c) {
+			box_vertices[v].position[c] = m[c];
+			box_vertices[v].normal[c] = (GLshort) m[3 + c];
+		}
+		box_vertices[v].normal[3] = 0;
+		box_vertices[v].emission[0] = (GLubyte) m[6];
+	}
+}
+
+/**
+ * Destructor. The buffers are released
+ * @pre The context where they were created must be current
+ */
+cgvStaticBatch::~cgvStaticBatch() {
+	destroy();
+}
+
+/**
+ * Update the batch to the current state of a scene
+ * @param scene The scene
+ * @post When boxes have been added or removed, every box becomes static and the buffers are created again. Otherwise,
+ * the boxes rotated or moved since the last update become dynamic, the static boxes whose selection changed are
+ * written again, and the dynamic boxes that have not been rotated or moved for REMERGE_FRAMES updates become static
+ */
+void cgvStaticBatch::update(const cgvScene3D &scene) {
+	n_written = 0;
+	++frame;
+	if (init_failed) return;
+	if (scene.get_revision() != scene_revision) {
+		build(scene);
+		return;
+	}
+
+	const vector<cgvBox> &boxes = scene.get_boxes();
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	if (scene.get_num_box_changes() != box_changes) {
+		box_changes = scene.get_num_box_changes();
+		for (uint32_t i = 0; i < boxes.size(); ++i) {
+			const cgvPoint3D &p = positions[i], &q = box_positions[i];
+			if ((angles[i] != rotations[i][0]) || (p[X] != q[X]) || (p[Y] != q[Y]) || (p[Z] != q[Z])) {
+				angles[i] = rotations[i][0];
+				box_positions[i] = p;
+				last_rotation[i] = frame;
+				if (box_static[i]) {
+					box_static[i] = 0;
+					dynamic_boxes.push_back(i);
+					++n_moves;
+					write_box(scene, i, true);
+				}
+			} else if (box_static[i] && (boxes[i].isSelected() != (bool) box_selected[i])) {
+				write_box(scene, i, false);
+			}
+		}
+	}
+
+	for (size_t k = 0; k < dynamic_boxes.size();) {
+		const uint32_t i = dynamic_boxes[k];
+		if (frame - last_rotation[i] < REMERGE_FRAMES) {
+			++k;
+			continue;
+		}
+		box_static[i] = 1;
+		++n_moves;
+		write_box(scene, i, false);
+		dynamic_boxes[k] = dynamic_boxes.back();
+		dynamic_boxes.pop_back();
+	}
+}
+
+/**
+ * Draw the static boxes
+ * @param camera Camera of the frame, to skip the chunks outside its view volume (nullptr: every chunk is drawn)
+ * @pre update() has been called for the current state of the scene, in display mode with lighting
+ * @post The OpenGL state (and so the one shadowed by cgvGLState) is not changed
+ */
+void cgvStaticBatch::draw(const cgvCamera *camera) {
+	n_drawn = 0;
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (buffers.empty()) return;
+
+	float planes[6][4];
+	if (camera) camera->get_frustum_planes(planes);
+
+	glPushAttrib(GL_LIGHTING_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glColorMaterial(GL_FRONT, GL_EMISSION);
+	glEnable(GL_COLOR_MATERIAL);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	const uint32_t n_boxes = (uint32_t) box_static.size();
+	for (uint32_t c = 0; c < buffers.size(); ++c) {
+		if (camera) {
+			// the chunk is outside if its bounding box is outside any plane (its nearest corner to the plane)
+			bool outside = false;
+			for (int p = 0; (p < 6) && !outside; ++p) {
+				float d = planes[p][3];
+				for (int i = X; i <= Z; ++i) d += planes[p][i] * ((planes[p][i] > 0) ? chunk_max[c][i] : chunk_min[c][i]);
+				outside = (d < 0);
+			}
+			if (outside) continue;
+		}
+		++n_drawn;
+
+		const uint32_t n = (n_boxes - c * CHUNK_SIZE < CHUNK_SIZE) ? n_boxes - c * CHUNK_SIZE : CHUNK_SIZE;
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[c]);
+		glVertexPointer(3, GL_FLOAT, sizeof(vertex), (const GLvoid *) offsetof(vertex, position));
+		glNormalPointer(GL_SHORT, sizeof(vertex), (const GLvoid *) offsetof(vertex, normal));
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(vertex), (const GLvoid *) offsetof(vertex, emission));
+		glDrawArrays(GL_QUADS, 0, (GLsizei) (n * BOX_VERTICES));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glPopClientAttrib();
+	glPopAttrib();
+#endif
+}
+
+/**
+ * Release the buffers
+ * @post Every box is dynamic until the next update
+ */
+void cgvStaticBatch::destroy() {
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (!buffers.empty()) glDeleteBuffers((GLsizei) buffers.size(), buffers.data());
+#endif
+	buffers.clear();
+	chunk_min.clear();
+	chunk_max.clear();
+	box_slot.clear();
+	box_static.clear();
+	box_selected.clear();
+	angles.clear();
+	last_rotation.clear();
+	dynamic_boxes.clear();
+	scene_revision = 0;
+}
+
+/**
+ * Create the buffers with every box of a scene
+ * @param scene The scene
+ * @post Every box is static. If the buffers cannot be created, the reason is written to stderr and the batch is not
+ * used again
+ */
+void cgvStaticBatch::build(const cgvScene3D &scene) {
+	destroy();
+#ifdef CGV_HAVE_CORE_PROFILE
+	if (!supported) {
+		if (!cgvGLState::supports(1, 5, "GL_ARB_vertex_buffer_object")) {
+			fprintf(stderr, "cgvStaticBatch: vertex buffers are not supported, the boxes are not batched\n");
+			init_failed = true;
+			return;
+		}
+		supported = true;
+	}
+
+	const vector<cgvPoint3D> &positions = scene.get_positions();
+	const vector<array<GLfloat, 2> > &rotations = scene.get_rotations();
+	const uint32_t n_boxes = scene.get_num_boxes();
+	box_static.assign(n_boxes, 1);
+	box_selected.resize(n_boxes);
+	angles.resize(n_boxes);
+	box_positions.assign(positions.begin(), positions.end());
+	last_rotation.assign(n_boxes, 0);
+
+	std::vector<uint32_t> order;
+	scene.get_morton_order(order);
+	box_slot.resize(n_boxes);
+
+	const float radius = cgvBox::bounding_radius();
+	const uint32_t n_chunks = (n_boxes + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	buffers.resize(n_chunks);
+	chunk_min.resize(n_chunks);
+	chunk_max.resize(n_chunks);
+	glGenBuffers((GLsizei) buffers.size(), buffers.data());
+	for (uint32_t c = 0; c < n_chunks; ++c) {
+		const uint32_t first = c * CHUNK_SIZE;
+		const uint32_t n = (n_boxes - first < CHUNK_SIZE) ? n_boxes - first : CHUNK_SIZE;
+		cgvPoint3D min = positions[order[first]], max = min;
+		chunk.resize(n * BOX_VERTICES);
+		for (uint32_t slot = first; slot < first + n; ++slot) {
+			const uint32_t i = order[slot];
+			box_slot[i] = slot;
+			angles[i] = rotations[i][0];
+			box_selected[i] = scene.get_boxes()[i].isSelected();
+			transform_box(scene, i, &chunk[(slot - first) * BOX_VERTICES]);
+			for (int k = X; k <= Z; ++k) {
+				if (positions[i][k] < min[k]) min[k] = positions[i][k];
+				if (positions[i][k] > max[k]) max[k] = positions[i][k];
+			}
+		}
+		chunk_min[c].set(min[X] - radius, min[Y] - radius, min[Z] - radius);
+		chunk_max[c].set(max[X] + radius, max[Y] + radius, max[Z] + radius);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[c]);
+		glBufferData(GL_ARRAY_BUFFER, chunk.size() * sizeof(vertex), chunk.data(), GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	n_written = n_boxes;
+	std::vector<vertex>().swap(chunk);
+
+	if (glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "cgvStaticBatch: unable to create the buffers of %u boxes, the boxes are not batched\n", n_boxes);
+		destroy();
+		init_failed = true;
+		return;
+	}
+#endif
+	scene_revision = scene.get_revision();
+	box_changes = scene.get_num_box_changes();
+}
+
+/**
+ * Write the vertices of a box to its buffer
+ * @param scene The scene
+ * @param i Index of the box
+ * @param collapsed true to collapse every vertex to the center of the box, so that nothing is rasterized
+ * @post If the box is not collapsed, the bounding box of its chunk contains it (the box could have been moved)
+ */
+void cgvStaticBatch::write_box(const cgvScene3D &scene, uint32_t i, bool collapsed) {
+#ifdef CGV_HAVE_CORE_PROFILE
+	vertex v[BOX_VERTICES];
+	transform_box(scene, i, v);
+	if (collapsed) {
+		const cgvPoint3D &p = scene.get_positions()[i];
+		for (vertex &u: v) {
+			u.position[0] = p[X];
+			u.position[1] = p[Y];
+			u.position[2] = p[Z];
+		}
+	}
+	box_selected[i] = scene.get_boxes()[i].isSelected();
+	const uint32_t c = box_slot[i] / CHUNK_SIZE;
+	if (!collapsed) {
+		const cgvPoint3D &p = scene.get_positions()[i];
+		const float radius = cgvBox::bounding_radius();
+		for (int k = X; k <= Z; ++k) {
+			if (p[k] - radius < chunk_min[c][k]) chunk_min[c][k] = p[k] - radius;
+			if (p[k] + radius > chunk_max[c][k]) chunk_max[c][k] = p[k] + radius;
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[c]);
+	glBufferSubData(GL_ARRAY_BUFFER, (box_slot[i] % CHUNK_SIZE) * sizeof(v), sizeof(v), v);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	++n_written;
+#endif
+}
+
+/**
+ * Compute the vertices of a box in world coordinates, with the emission of its pieces
+ * @param scene The scene
+ * @param i Index of the box
+ * @param out Output vertices (BOX_VERTICES)
+ */
+void cgvStaticBatch::transform_box(const cgvScene3D &scene, uint32_t i, vertex *out) const {
+	const cgvPoint3D &p = scene.get_positions()[i];
+	const bool selected = scene.get_boxes()[i].isSelected();
+
+	// the same transformation of cgvScene3D::push_box_transform: rotation around Y, then translation
+	const float angle = scene.get_rotations()[i][0] * 3.14159265358979f / 180;
+	const float c = std::cos(angle), s = std::sin(angle);
+	for (int v = 0; v < BOX_VERTICES; ++v) {
+		const vertex &b = box_vertices[v];
+		vertex &o = out[v];
+		o.position[0] = p[X] + c * b.position[0] + s * b.position[2];
+		o.position[1] = p[Y] + b.position[1];
+		o.position[2] = p[Z] - s * b.position[0] + c * b.position[2];
+		o.normal[0] = (GLshort) std::lround(32767 * (c * b.normal[0] + s * b.normal[2]));
+		o.normal[1] = (GLshort) (32767 * b.normal[1]);
+		o.normal[2] = (GLshort) std::lround(32767 * (-s * b.normal[0] + c * b.normal[2]));
+		o.normal[3] = 0;
+
+		const GLfloat *emission = cgvBox::get_emission(selected ? (int) CGV_NUM_BOX_PARTS : (int) b.emission[0]);
+		for (int k = 0; k < 4; ++k) o.emission[k] = (GLubyte) std::lround(255 * emission[k]);
+	}
+}
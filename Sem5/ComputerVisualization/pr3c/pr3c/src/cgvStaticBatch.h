@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "cgvBox.h"
+#include "cgvPoint.h"
+
+class cgvScene3D;
+class cgvCamera;
+
+/**
+ * cgvStaticBatch renders the static boxes of a scene (the ones that have not been rotated since they were added) in
+ * display mode with a few calls: their geometry is transformed to world coordinates once and stored in vertex buffers
+ * of CHUNK_SIZE nearby boxes (in Morton order), with the emission of each piece as the color of its vertices
+ * (GL_COLOR_MATERIAL). The chunks outside the view volume of the camera are not drawn.
+ * A box that is rotated or moved becomes dynamic: its vertices in the buffer are collapsed to a point, and the scene
+ * renders it as usual. When it has not been rotated or moved for REMERGE_FRAMES frames, it is written back to the
+ * buffer. A change of selection only rewrites the vertices of the box.
+ */
+class cgvStaticBatch {
+public:
+	static const uint32_t CHUNK_SIZE = 1024; ///< Boxes of each vertex buffer
+	static const int BOX_VERTICES = 48; ///< Vertices of a box: 12 quads (both pieces)
+	static const unsigned int REMERGE_FRAMES = 60; ///< Frames without rotations before a dynamic box becomes static
+
+private:
+	/**
+	 * Vertex of the batch
+	 */
+	struct vertex {
+		GLfloat position[3]; ///< World coordinates
+		GLshort normal[4]; ///< Normal in world coordinates (the fourth component is padding)
+		GLubyte emission[4]; ///< Emission of the piece
+	};
+
+	std::vector<GLuint> buffers; ///< Vertex buffer of each chunk
+	std::vector<cgvPoint3D> chunk_min, chunk_max; ///< Axis-aligned bounding box of each chunk
+	std::vector<uint32_t> box_slot; ///< Position of each box in the buffers (Morton order)
+	vertex box_vertices[BOX_VERTICES]; ///< Vertices of a box, in its coordinates (emission: 0 body, 1 top piece)
+	std::vector<vertex> chunk; ///< Vertices of the chunk that is being written
+
+	std::vector<uint8_t> box_static; ///< Whether each box is drawn by the batch
+	std::vector<uint8_t> box_selected; ///< Selection state of each box when its vertices were written
+	std::vector<GLfloat> angles; ///< Rotation of each box when its vertices were written
+	std::vector<cgvPoint3D> box_positions; ///< Position of each box when its vertices were written
+	std::vector<uint32_t> dynamic_boxes; ///< Boxes that are not drawn by the batch
+	std::vector<unsigned long> last_rotation; ///< Update of the last rotation or move of each box
+
+	unsigned long scene_revision = 0; ///< Revision of the scene of the buffers
+	unsigned long box_changes = 0; ///< Number of changes of the boxes of the scene in the last update
+	unsigned long frame = 0; ///< Number of updates
+	bool supported = false; ///< Vertex buffers can be used
+	bool init_failed = false; ///< They could not be created: every box is dynamic
+
+	unsigned long n_written = 0; ///< Boxes written to the buffers by the last update
+	unsigned long n_moves = 0; ///< Number of times that a box has left the batch or returned to it
+	unsigned long n_drawn = 0; ///< Chunks drawn by the last draw
+
+public:
+	cgvStaticBatch();
+	~cgvStaticBatch();
+
+	cgvStaticBatch(const cgvStaticBatch&) = delete;
+	cgvStaticBatch& operator=(const cgvStaticBatch&) = delete;
+
+	void update(const cgvScene3D &scene);
+	void draw(const cgvCamera *camera);
+	void destroy();
+
+	/**
+	 * @param i Index of a box
+	 * @retval true if the box is drawn by draw()
+	 */
+	bool is_static(uint32_t i) const { return (i < box_static.size()) && box_static[i]; };
+
+	unsigned long get_num_static() const { return (unsigned long) (box_static.size() - dynamic_boxes.size()); };
+	unsigned long get_num_dynamic() const { return (unsigned long) dynamic_boxes.size(); };
+	unsigned long get_num_written() const { return n_written; };
+	unsigned long get_num_moves() const { return n_moves; };
+	unsigned long get_num_drawn_chunks() const { return n_drawn; };
+	/**
+	 * @retval Memory of a box in the batch: its vertices in the buffers and the state they were written with
+	 */
+	static uint32_t get_bytes_per_box() {
+		return (uint32_t) (BOX_VERTICES * sizeof(vertex) + 2 * sizeof(uint32_t) + 2 * sizeof(uint8_t) + sizeof(GLfloat) +
+		                   sizeof(cgvPoint3D) + sizeof(unsigned long));
+	};
+	unsigned long get_num_chunks() const { return (unsigned long) buffers.size(); };
+
+private:
+	void build(const cgvScene3D &scene);
+	void write_box(const cgvScene3D &scene, uint32_t i, bool collapsed);
+	void transform_box(const cgvScene3D &scene, uint32_t i, vertex *out) const;
+};
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "cgvUpdateReceiver.h"
+#include "cgvScene3D.h"
+#include "cgvMappedFile.h"
+
+/**
+ * Destructor. The thread is stopped
+ */
+cgvUpdateReceiver::~cgvUpdateReceiver() {
+	stop();
+}
+
+/**
+ * Start reading updates
+ * @param _source "-" (standard input), "unix:<path>" (Unix domain socket) or the path of a FIFO or a file
+ * @retval true if the input has been opened and the thread has started. Otherwise, the reason is written to stderr
+ */
+bool cgvUpdateReceiver::start(const std::string &_source) {
+	stop();
+#ifdef _WIN32
+	fprintf(stderr, "cgvUpdateReceiver: the updates can not be received in Windows (%s)\n", _source.c_str());
+	return false;
+#else
+	if (!cgvMappedFile::is_little_endian()) {
+		fprintf(stderr, "cgvUpdateReceiver: the updates can only be received in little-endian hosts\n");
+		return false;
+	}
+
+	const char *error = nullptr;
+	if (_source == "-") {
+		fd = STDIN_FILENO;
+		close_input = false;
+	} else if (_source.compare(0, 5, "unix:") == 0) {
+		const std::string path = _source.substr(5);
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		struct stat status;
+		if (path.empty() || (path.size() >= sizeof(address.sun_path))) {
+			error = "non-valid path of the socket";
+		} else if ((stat(path.c_str(), &status) == 0) && !S_ISSOCK(status.st_mode)) {
+			error = "the path exists and it is not a socket";
+		} else {
+			// the socket of a previous execution is replaced
+			unlink(path.c_str());
+			strcpy(address.sun_path, path.c_str());
+			socket_path = path;
+			listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if ((listener < 0) || (bind(listener, (const sockaddr *) &address, sizeof(address)) != 0) ||
+			    (listen(listener, 1) != 0)) {
+				error = strerror(errno);
+			}
+		}
+	} else {
+		// a FIFO is opened for writing too (Linux), so that it does not reach its end when a writer closes it
+		struct stat status;
+		const bool fifo = (stat(_source.c_str(), &status) == 0) && S_ISFIFO(status.st_mode);
+		fd = ::open(_source.c_str(), (fifo ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+		if (fd < 0) error = strerror(errno);
+	}
+	if (!error && (pipe(wake) != 0)) error = strerror(errno);
+	if (error) {
+		fprintf(stderr, "cgvUpdateReceiver: unable to read updates from %s (%s)\n", _source.c_str(), error);
+		stop();
+		return false;
+	}
+
+	source = _source;
+	receiving = true;
+	reader = std::thread(&cgvUpdateReceiver::run, this);
+	return true;
+#endif
+}
+
+/**
+ * Stop reading updates
+ * @post The thread has finished and the input is closed. The updates already received can still be applied
+ */
+void cgvUpdateReceiver::stop() {
+#ifndef _WIN32
+	if (reader.joinable()) {
+		const char byte = 0;
+		if (write(wake[1], &byte, 1) != 1) fprintf(stderr, "cgvUpdateReceiver: unable to stop the thread\n");
+		reader.join();
+	}
+	if ((fd >= 0) && close_input) close(fd);
+	if (listener >= 0) {
+		close(listener);
+		unlink(socket_path.c_str());
+	}
+	socket_path.clear();
+	for (int &end: wake) {
+		if (end >= 0) close(end);
+		end = -1;
+	}
+#endif
+	fd = listener = -1;
+	close_input = true;
+	receiving = false;
+}
+
+/**
+ * Apply the updates received since the last call to a scene
+ * @param scene The scene
+ * @retval Number of boxes changed
+ * @post The boxes are moved in place (cgvScene3D::move_box), so the renderers only update them. The updates of boxes
+ * that are not in the scene are discarded
+ */
+uint32_t cgvUpdateReceiver::apply(cgvScene3D &scene) {
+	n_applied = 0;
+	if (n_pending == 0) return 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		batch.swap(pending);
+		pending.clear();
+		pending_slot.clear();
+		n_pending = 0;
+	}
+
+	const vector<cgvBox> &boxes = scene.get_boxes();
+	if (scene.get_revision() != index_revision) {
+		index_revision = scene.get_revision();
+		GLuint max_id = 0;
+		for (const cgvBox &box: boxes) max_id = (box.get_id() > max_id) ? box.get_id() : max_id;
+		box_index.assign(boxes.empty() ? 0 : max_id + 1, UINT32_MAX);
+		for (uint32_t i = 0; i < boxes.size(); ++i) box_index[boxes[i].get_id()] = i;
+	}
+
+	for (const cgvTransformUpdate &update: batch) {
+		const uint32_t i = (update.id < box_index.size()) ? box_index[update.id] : UINT32_MAX;
+		if (i == UINT32_MAX) {
+			++n_unknown;
+			continue;
+		}
+		scene.move_box(i, cgvPoint3D(update.position[0], update.position[1], update.position[2]),
+		               {update.rotation[0], update.rotation[1]});
+		++n_applied;
+	}
+	return (uint32_t) n_applied;
+}
+
+/**
+ * Body of the thread: read the input in blocks until it ends or the receiver is stopped
+ * @post With a socket, the next client is waited for when one disconnects
+ */
+void cgvUpdateReceiver::run() {
+#ifndef _WIN32
+	std::vector<char> buffer(READ_SIZE);
+	size_t filled = 0; // bytes of a record that is not complete yet
+	for (;;) {
+		pollfd events[2] = {{wake[0], POLLIN, 0}, {(fd >= 0) ? fd : listener, POLLIN, 0}};
+		if ((poll(events, 2, -1) < 0) && (errno != EINTR)) break;
+		if (events[0].revents) break;
+		if (!events[1].revents) continue;
+
+		if (fd < 0) {
+			fd = accept(listener, nullptr, nullptr);
+			filled = 0;
+			continue;
+		}
+		const ssize_t length = read(fd, buffer.data() + filled, READ_SIZE - filled);
+		if ((length < 0) && ((errno == EINTR) || (errno == EAGAIN))) continue;
+		if (length <= 0) {
+			if (filled > 0) fprintf(stderr, "cgvUpdateReceiver: the last update of %s is incomplete\n", source.c_str());
+			if (length < 0) fprintf(stderr, "cgvUpdateReceiver: unable to read %s (%s)\n", source.c_str(), strerror(errno));
+			if (listener < 0) break;
+			close(fd);
+			fd = -1; // the next client of the socket
+			continue;
+		}
+
+		filled += (size_t) length;
+		const size_t n = filled / sizeof(cgvTransformUpdate);
+		receive((const cgvTransformUpdate *) buffer.data(), n);
+		filled -= n * sizeof(cgvTransformUpdate);
+		memmove(buffer.data(), buffer.data() + n * sizeof(cgvTransformUpdate), filled);
+	}
+#endif
+	receiving = false;
+}
+
+/**
+ * Keep the latest update of each box of a block
+ * @param updates Updates, in the order they were received
+ * @param n Number of updates
+ */
+void cgvUpdateReceiver::receive(const cgvTransformUpdate *updates, size_t n) {
+	unsigned long rejected = 0, collapsed = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t k = 0; k < n; ++k) {
+			const cgvTransformUpdate &update = updates[k];
+			if (!std::isfinite(update.position[0]) || !std::isfinite(update.position[1]) ||
+			    !std::isfinite(update.position[2]) || !std::isfinite(update.rotation[0]) ||
+			    !std::isfinite(update.rotation[1])) {
+				++rejected;
+				continue;
+			}
+			auto slot = pending_slot.emplace(update.id, (uint32_t) pending.size());
+			if (slot.second) {
+				pending.push_back(update);
+			} else {
+				pending[slot.first->second] = update;
+				++collapsed;
+			}
+		}
+		n_pending = (uint32_t) pending.size();
+	}
+	n_received += n;
+	n_rejected += rejected;
+	n_collapsed += collapsed;
+}
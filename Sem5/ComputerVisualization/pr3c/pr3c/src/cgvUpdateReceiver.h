@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class cgvScene3D;
+
+/**
+ * Update of the transformation of a box, as it is received (24 bytes, little-endian)
+ */
+struct cgvTransformUpdate {
+	uint32_t id; ///< Identifier of the box (color_as_ID, 0xRRGGBB)
+	float position[3]; ///< New position of the center of the box
+	float rotation[2]; ///< New rotation (degrees) of the box around Y and around X
+};
+
+static_assert(sizeof(cgvTransformUpdate) == 24, "the updates are received without padding");
+
+/**
+ * cgvUpdateReceiver reads updates of the transformation of the boxes from an external program, in a thread, so that
+ * the render loop never waits for them. The input is a stream of cgvTransformUpdate records, without header, from:
+ * - "-": the standard input
+ * - "unix:<path>": a Unix domain socket created at path, where the clients connect one after another
+ * - any other path: a FIFO (kept open between writers) or a file (read once)
+ *
+ * The thread keeps only the latest update of each box since the last frame; the render thread takes them once per
+ * frame (apply), so the lock is only held to add a block of READ_SIZE bytes of updates or to swap the batches.
+ */
+class cgvUpdateReceiver {
+public:
+	static const size_t READ_SIZE = 65536; ///< Bytes read from the input at once
+
+private:
+	std::string source; ///< Input of the updates
+	int fd = -1; ///< Input being read (-1: waiting for a client of the socket)
+	int listener = -1; ///< Listening socket, with "unix:"
+	std::string socket_path; ///< Path of the listening socket
+	int wake[2] = {-1, -1}; ///< Pipe that interrupts the wait of the thread when the receiver is stopped
+	bool close_input = true; ///< fd must be closed (it is not the standard input)
+	std::thread reader; ///< Thread that reads the input
+	std::atomic<bool> receiving{false}; ///< The thread is reading (or waiting for) the input
+
+	std::mutex mutex; ///< Guards pending and pending_slot
+	std::vector<cgvTransformUpdate> pending; ///< Latest update of each box received since the last apply
+	std::unordered_map<uint32_t, uint32_t> pending_slot; ///< Index in pending of the update of each identifier
+	std::atomic<uint32_t> n_pending{0}; ///< Size of pending
+
+	std::vector<cgvTransformUpdate> batch; ///< Updates being applied to the scene
+	std::vector<uint32_t> box_index; ///< Index in the scene of each identifier (UINT32_MAX: none)
+	unsigned long index_revision = 0; ///< Revision of the scene of box_index
+
+	std::atomic<unsigned long> n_received{0}; ///< Updates received since start
+	std::atomic<unsigned long> n_collapsed{0}; ///< Updates replaced by a later one of the same box before being applied
+	std::atomic<unsigned long> n_rejected{0}; ///< Updates with a position or rotation that is not finite
+	unsigned long n_applied = 0; ///< Boxes changed by the last apply
+	unsigned long n_unknown = 0; ///< Updates of identifiers that are not in the scene, since start
+
+public:
+	cgvUpdateReceiver() = default;
+	~cgvUpdateReceiver();
+
+	cgvUpdateReceiver(const cgvUpdateReceiver&) = delete;
+	cgvUpdateReceiver& operator=(const cgvUpdateReceiver&) = delete;
+
+	bool start(const std::string &_source);
+	void stop();
+	uint32_t apply(cgvScene3D &scene);
+
+	/**
+	 * @retval true while the input is being read, or waited for
+	 */
+	bool is_receiving() const { return receiving; };
+	bool has_pending() const { return n_pending > 0; };
+	const std::string &get_source() const { return source; };
+	unsigned long get_num_received() const { return n_received; };
+	unsigned long get_num_collapsed() const { return n_collapsed; };
+	unsigned long get_num_rejected() const { return n_rejected; };
+	unsigned long get_num_applied() const { return n_applied; };
+	unsigned long get_num_unknown() const { return n_unknown; };
+
+private:
+	void run();
+	void receive(const cgvTransformUpdate *updates, size_t n);
+};
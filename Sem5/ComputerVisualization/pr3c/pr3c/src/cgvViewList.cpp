@@ -0,0 +1,75 @@
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+
+#include "cgvViewList.h"
+
+/**
+ * Read the views of a views file
+ * @param path Path of the file
+ * @retval true if all the lines are valid and there is at least one view. Otherwise, the reason is written to stderr
+ * and the list is empty
+ */
+bool cgvViewList::load(const std::string &path) {
+	views.clear();
+	FILE *file = fopen(path.c_str(), "r");
+	if (!file) {
+		fprintf(stderr, "cgvViewList: unable to open %s\n", path.c_str());
+		return false;
+	}
+
+	char line[1024];
+	unsigned int number = 0;
+	bool valid = true;
+	while (valid && fgets(line, sizeof(line), file)) {
+		++number;
+		char type[16] = "";
+		double v[13];
+		char end[2];
+		const int n = sscanf(line, " %15s %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %1s", type, &v[0], &v[1],
+		                     &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11], &v[12], end);
+		if ((n <= 0) || (type[0] == '#')) continue;
+
+		bool finite = true;
+		for (int i = 0; i + 1 < n; ++i) finite = finite && std::isfinite(v[i]);
+		valid = (n == 14) && finite && (v[11] > 0) && (v[12] > v[11]) && (v[9] > 0) && (v[10] > 0);
+		if (valid && !strcmp(type, "parallel")) {
+			views.emplace_back(cgvPoint3D(v[0], v[1], v[2]), cgvPoint3D(v[3], v[4], v[5]), cgvPoint3D(v[6], v[7], v[8]));
+			views.back().setParallelParameters(v[9], v[10], v[11], v[12]);
+		} else if (valid && !strcmp(type, "perspective") && (v[9] < 180)) {
+			views.emplace_back(cgvPoint3D(v[0], v[1], v[2]), cgvPoint3D(v[3], v[4], v[5]), cgvPoint3D(v[6], v[7], v[8]));
+			views.back().setPerspParameters(v[9], v[10], v[11], v[12]);
+		} else {
+			valid = false;
+		}
+	}
+	fclose(file);
+
+	if (!valid) {
+		fprintf(stderr, "cgvViewList: the line %u of %s is not a valid view\n", number, path.c_str());
+		views.clear();
+		return false;
+	}
+	if (views.empty()) {
+		fprintf(stderr, "cgvViewList: %s has no views\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Replace the views with a turntable: the camera turns around the vertical axis that goes through its reference point
+ * @param camera Camera of the first view. The other ones have the same projection
+ * @param n_views Number of views of a whole turn
+ */
+void cgvViewList::turntable(const cgvCamera &camera, uint32_t n_views) {
+	views.assign(n_views, camera);
+	cgvPoint3D PV, rp, up;
+	camera.getCameraParameters(PV, rp, up);
+	const double x = PV[X] - rp[X], z = PV[Z] - rp[Z];
+	for (uint32_t i = 0; i < n_views; ++i) {
+		const double angle = 2 * 3.14159265358979323846 * i / n_views;
+		views[i].setCameraParameters(cgvPoint3D(rp[X] + x * cos(angle) + z * sin(angle), PV[Y],
+		                                        rp[Z] - x * sin(angle) + z * cos(angle)), rp, up);
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include "cgvCamera.h"
+
+/**
+ * cgvViewList holds the cameras of the views of a scene that are rendered one after another without a window: read
+ * from a text file, or around a camera (a turntable). The views file has one camera per line, and the lines that are
+ * empty or that start with # are ignored:
+ *
+ *     parallel    <PV x y z> <rp x y z> <up x y z> <half width> <half height> <near> <far>
+ *     perspective <PV x y z> <rp x y z> <up x y z> <fovy> <aspect> <near> <far>
+ */
+class cgvViewList {
+	std::vector<cgvCamera> views; ///< Camera of each view
+
+public:
+	cgvViewList() = default;
+	~cgvViewList() = default;
+
+	bool load(const std::string &path);
+	void turntable(const cgvCamera &camera, uint32_t n_views);
+
+	const std::vector<cgvCamera> &get_views() const { return views; };
+	uint32_t get_num_views() const { return (uint32_t) views.size(); };
+};
@@ -1,21 +1,36 @@
 #include <cstdlib>
 
 #include "cgvInterface.h"
+#include "cgvGlutAdapter.h"
 
 
 int main (int argc, char** argv) {
+	cgvInterface ui; // scene, camera and rendering state of the window
+
+	// read the options of the scene generator (e.g. --layout grid --boxes 10000 --seed 7)
+	if (!ui.parse_args(argc, argv)) {
+		return(EXIT_FAILURE);
+	}
+
+	// export a turntable of the scene without opening a window (e.g. --export frames/turntable_%04u.png)
+	if (ui.is_exporting()) {
+		return(ui.export_sequence() ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
 	// initialize the display window
-	cgvInterface::getInstance().configure_environment(argc,argv,
+	if (!cgvGlutAdapter::configure_environment(ui, argc,argv,
 	                           500,500, // window size
 														 100,100, // window position
 														 "Computer Graphics and Visualization. Practice 3c." // title of the window
-														 );
+														 )) {
+		return(EXIT_FAILURE);
+	}
 
 	// define the callbacks to manage the events. 
-	cgvInterface::getInstance().init_callbacks();
+	cgvGlutAdapter::init_callbacks(ui);
 
 	// initialize the loop of the OpenGL visualization
-	cgvInterface::getInstance().init_rendering_loop();
+	cgvGlutAdapter::init_rendering_loop();
 
 	return(0);
 }